@@ -6,12 +6,16 @@
 
 #include "mdaconvert.h"
 #include "mdaio.h"
+#include "mdazio.h"
 
 #include <QFile>
 #include <QFileInfo>
 #include <QTime>
 #include <mda.h>
 #include <stdio.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "mlcommon.h"
 
@@ -26,6 +30,8 @@ struct working_data {
             fclose(outf);
         if (buf)
             free(buf);
+        if (mdaz)
+            delete mdaz;
     }
 
     MDAIO_HEADER HH_in;
@@ -33,9 +39,11 @@ struct working_data {
     FILE* inf = 0;
     FILE* outf = 0;
     void* buf = 0;
+    MdazWriter* mdaz = 0; //for output format mdaz
 };
 
 bool copy_data(working_data& D, bigint N);
+void drop_cached_pages(working_data& D);
 bigint get_num_bytes_per_entry(bigint dtype);
 bool convert_ncs(const mdaconvert_opts& opts);
 bool convert_nrd(const mdaconvert_opts& opts);
@@ -246,6 +254,13 @@ bool mdaconvert(const mdaconvert_opts& opts_in)
             return false;
         }
     }
+    else if (opts.output_format == "mdaz") {
+        D.mdaz = new MdazWriter;
+        if (!D.mdaz->begin(D.outf, &D.HH_out)) {
+            qWarning() << "Error writing output header";
+            return false;
+        }
+    }
 
     //check input file size
     if (opts.check_input_file_size) {
@@ -273,6 +288,14 @@ bool mdaconvert(const mdaconvert_opts& opts_in)
             ret = false;
             break;
         }
+        if (opts.direct_io)
+            drop_cached_pages(D);
+    }
+    if ((ret) && (D.mdaz)) {
+        if (!D.mdaz->finish()) {
+            qWarning() << "Error writing mdaz block index";
+            ret = false;
+        }
     }
 
     if (!ret) {
@@ -283,6 +306,18 @@ bool mdaconvert(const mdaconvert_opts& opts_in)
     return false;
 }
 
+void drop_cached_pages(working_data& D)
+{
+    //The conversion goes through stdio, so instead of bypassing the cache, write back what was converted so far
+    //and drop it (and the input consumed so far) from the page cache
+    fflush(D.outf);
+#ifndef _WIN32
+    fsync(fileno(D.outf));
+#endif
+    mda_drop_cache(fileno(D.inf), 0, ftello(D.inf));
+    mda_drop_cache(fileno(D.outf), 0, ftello(D.outf));
+}
+
 bool copy_data(working_data& D, bigint N)
 {
     if (!N)
@@ -292,6 +327,8 @@ bool copy_data(working_data& D, bigint N)
         D.buf = 0;
     }
     bigint buf_size = N * D.HH_out.num_bytes_per_entry;
+    if (D.mdaz)
+        buf_size = N * sizeof(double); //the writer converts to the output type
     D.buf = malloc(buf_size);
     if (!D.buf) {
         qWarning() << QString("Error in malloc of size %1 ").arg(buf_size);
@@ -300,7 +337,19 @@ bool copy_data(working_data& D, bigint N)
 
     void* buf = D.buf;
     bigint num_read = 0;
-    if (D.HH_out.data_type == MDAIO_TYPE_BYTE) {
+    if (D.mdaz) {
+        num_read = mda_read_float64((double*)buf, &D.HH_in, N, D.inf);
+        if (num_read != N) {
+            qWarning() << "Error reading data" << num_read << N;
+            return false;
+        }
+        if (!D.mdaz->writeFloat64((double*)buf, N)) {
+            qWarning() << "Error writing data";
+            return false;
+        }
+        return true;
+    }
+    else if (D.HH_out.data_type == MDAIO_TYPE_BYTE) {
         num_read = mda_read_byte((unsigned char*)buf, &D.HH_in, N, D.inf);
     }
     else if (D.HH_out.data_type == MDAIO_TYPE_UINT16) {
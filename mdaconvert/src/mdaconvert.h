@@ -25,6 +25,7 @@ struct mdaconvert_opts {
     QList<bigint> dims;
 
     bool check_input_file_size = true;
+    bool direct_io = false; //keep the streamed input and output out of the page cache
 };
 bool mdaconvert(const mdaconvert_opts& opts);
 
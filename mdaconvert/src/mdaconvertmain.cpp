@@ -61,6 +61,8 @@ int main(int argc, char* argv[])
 
     if (params.named_parameters.contains("allow-subset"))
         opts.check_input_file_size = false;
+    if (params.named_parameters.contains("direct_io"))
+        opts.direct_io = true;
 
     if (opts.output_path.isEmpty()) {
         //if (opts.input_path.endsWith(".mda")) {
@@ -131,6 +133,8 @@ QString get_default_format(QString path)
     QString suf = get_suffix(path);
     if (suf == "mda")
         return "mda";
+    else if (suf == "mdaz")
+        return "mdaz";
     else if (suf == "csv")
         return "csv";
     else if (suf.toLower() == "nrd") {
@@ -151,6 +155,8 @@ void print_usage()
     printf("mdaconvert input.dat output.mda --dtype=int16 --input_format=raw_timeseries --num_channels=32\n");
     printf("mdaconvert input.file output.file --input_format=dat --input_dtype=float64 --output_format=mda --output_dtype=float32\n");
     printf("mdaconvert input.csv output.mda --input_num_header_rows=1 --input_num_header_cols=0\n");
+    printf("mdaconvert input.mda output.mdaz\n");
+    printf("mdaconvert input.dat output.mda --dtype=int16 --dims=32x100000000 --direct_io\n");
     printf("mdaconvert input.ncs output.mda\n");
     printf("mdaconvert input.nrd output.mda --num_channels=32\n");
     printf("mdaconvert extract_time_chunk input.mda output.mda --t1=0 --t2=1e6\n");
@@ -5,9 +5,17 @@
 #include <QReadWriteLock>
 #include <QVariant>
 #include <QHash>
+#include <QVector>
+#include <atomic>
+#include <chrono>
 
 #include "mlcommon.h"
 
+#define ICOUNTER_NUM_SLOTS 16 //threads are spread over this many cache lines, see IThreadCounter
+#define ICOUNTER_CACHE_LINE_BYTES 64
+#define ILATENCY_NUM_BUCKETS 32
+#define COUNTER_PUBLISH_INTERVAL_MSEC 250 //how often the applications let counters that do not signal on add() emit valueChanged()
+
 class ICounterBase : public QObject {
     Q_OBJECT
 public:
@@ -24,6 +32,7 @@ public:
     virtual QString label() const;
     virtual QVariant genericValue() const = 0;
     virtual QVariant add(const QVariant&) = 0;
+    virtual void publish(); //emit valueChanged() for counters that do not signal on every add(), see CounterManager::setPublishInterval()
     template <typename T>
     T value() const { return genericValue().value<T>(); }
 signals:
@@ -117,8 +126,101 @@ template <typename T>
 using ICounter = ICounterImpl<T, std::is_integral<T>::value>;
 
 using IIntCounter = ICounter<int>;
+using IInt64Counter = ICounter<int64_t>;
 using IDoubleCounter = ICounter<double>;
 
+///The per-thread slots of IThreadCounter and ILatencyCounter are allocated on cache line boundaries (plain new only respects alignas from C++17)
+struct ICounterSlotAllocation {
+    static void* operator new[](size_t size);
+    static void operator delete[](void* ptr);
+};
+
+/*!
+ * A 64-bit integer counter for hot paths such as the bytes read and allocated. add() is a relaxed
+ * increment of a cache line mostly private to the calling thread and emits nothing; value() sums the
+ * slots. valueChanged() is only emitted by publish(), which the CounterManager calls on a timer.
+ */
+class IThreadCounter : public ICounterBase {
+    Q_OBJECT
+public:
+    IThreadCounter(const QString& name, QObject* parent = 0);
+    ~IThreadCounter();
+    Type type() const { return Integer; }
+    QVariant add(const QVariant& inc);
+    void add(int64_t inc)
+    {
+        if (inc)
+            m_slots[threadSlot()].value.fetch_add(inc, std::memory_order_relaxed);
+    }
+    int64_t value() const;
+    QVariant genericValue() const;
+    void publish();
+
+    static int threadSlot();
+
+private:
+    struct alignas(ICOUNTER_CACHE_LINE_BYTES) Slot : ICounterSlotAllocation {
+        std::atomic<int64_t> value{ 0 };
+    };
+    Slot* m_slots; //ICOUNTER_NUM_SLOTS
+    std::atomic<int64_t> m_published{ 0 };
+};
+
+/*!
+ * A histogram of call latencies (e.g. of reads and writes), recorded per thread like IThreadCounter.
+ * Bucket 0 counts calls under 1 microsecond and bucket b>0 those from 2^(b-1) up to 2^b microseconds,
+ * the last bucket also taking anything longer.
+ */
+class ILatencyCounter : public ICounterBase {
+    Q_OBJECT
+public:
+    ILatencyCounter(const QString& name, QObject* parent = 0);
+    ~ILatencyCounter();
+    Type type() const { return Variant; }
+    QVariant add(const QVariant& nanoseconds);
+    void record(int64_t nanoseconds);
+    ///The number of calls recorded
+    int64_t count() const;
+    int64_t totalNanoseconds() const;
+    ///The number of calls in each of the ILATENCY_NUM_BUCKETS buckets
+    QVector<int64_t> histogram() const;
+    ///The upper limit of bucket b in microseconds
+    static int64_t bucketLimit(int b);
+    ///An upper bound in microseconds on the latency of fraction p (between 0 and 1) of the calls
+    int64_t percentile(double p) const;
+    QVariant genericValue() const;
+    QString label() const;
+    void publish();
+
+private:
+    struct alignas(ICOUNTER_CACHE_LINE_BYTES) Slot : ICounterSlotAllocation {
+        std::atomic<int64_t> buckets[ILATENCY_NUM_BUCKETS];
+        std::atomic<int64_t> total_nanoseconds;
+    };
+    Slot* m_slots; //ICOUNTER_NUM_SLOTS
+    std::atomic<int64_t> m_published{ 0 };
+};
+
+/// Records the time from construction to destruction in an ILatencyCounter, if there is one
+class ILatencyTimer {
+public:
+    ILatencyTimer(ILatencyCounter* counter)
+        : m_counter(counter)
+    {
+        if (m_counter)
+            m_start = std::chrono::steady_clock::now();
+    }
+    ~ILatencyTimer()
+    {
+        if (m_counter)
+            m_counter->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+private:
+    ILatencyCounter* m_counter;
+    std::chrono::steady_clock::time_point m_start;
+};
+
 class CounterGroup : public QObject {
     Q_OBJECT
 public:
@@ -136,6 +238,8 @@ private:
     QString m_name;
 };
 
+class QTimer;
+
 class ICounterManager : public QObject {
     Q_OBJECT
 public:
@@ -167,6 +271,11 @@ public:
     void addGroup(CounterGroup* group);
     void removeGroup(CounterGroup* group);
 
+    ///Call publish() on all counters, so that those which do not signal on every add() emit valueChanged()
+    void publishCounters();
+    ///Call publishCounters() every msec milliseconds (0 to stop). Requires an event loop in the calling thread
+    void setPublishInterval(int msec);
+
 private:
     QHash<QString, ICounterBase*> m_counters;
     QStringList m_counterNames;
@@ -175,6 +284,8 @@ private:
     QHash<QString, CounterGroup*> m_groups;
     QStringList m_groupNames;
     mutable QReadWriteLock m_groupsLock;
+
+    QTimer* m_publishTimer = nullptr;
 };
 
 class CounterProxy : public ICounterBase {
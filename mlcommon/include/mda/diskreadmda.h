@@ -14,6 +14,9 @@ class DiskReadMdaPrivate;
  * \class DiskReadMda
  * @brief Read-only access to a .mda file, especially useful for huge arrays that cannot be practically loaded into memory.
  *
+ * readChunk() may be called concurrently from several threads on the same object (reads are positional, so
+ * there is no shared file offset). value() and the setters are not thread-safe.
+ *
  * See also Mda
  */
 class DiskReadMda {
@@ -23,8 +26,8 @@ public:
     DiskReadMda(const DiskReadMda& other); ///Copy constructor
     DiskReadMda(const Mda& X); ///Constructor based on an in-memory array. This enables passing an Mda into a function that expects a DiskReadMda.
     DiskReadMda(const QJsonObject& prv_object);
-    DiskReadMda(int concat_dimension, const QList<DiskReadMda>& arrays); //concatenation of arrays. For now concat_dimension must be 2
-    DiskReadMda(int concat_dimension, const QStringList& array_paths); //concatenation of arrays. For now concat_dimension must be 2
+    DiskReadMda(int concat_dimension, const QList<DiskReadMda>& arrays); //concatenation of arrays along dimension 1 (channels), 2 (timepoints) or 3 (e.g. clips), without copying
+    DiskReadMda(int concat_dimension, const QStringList& array_paths); //concatenation of arrays along dimension 1, 2 or 3
     virtual ~DiskReadMda();
     void operator=(const DiskReadMda& other);
 
@@ -34,6 +37,20 @@ public:
     void setConcatPaths(int concat_dimension, const QStringList& paths);
     void setConcatDirectory(int concat_dimension, const QString& dir_path);
 
+    ///Serve chunks from a read-only memory mapping of the file instead of stdio. When the file data type matches, readChunk returns views into the mapping without copying
+    void setMemoryMapped(bool val);
+    bool isMemoryMapped() const;
+    ///Read through a second descriptor that bypasses the page cache (O_DIRECT), with large aligned requests, so that a single pass over a huge file
+    ///does not evict everyone else's cached data. If the filesystem refuses, regular reads are used and dropped from the cache. Not used for memory mapped reads
+    void setDirectIO(bool val);
+    bool isDirectIO() const;
+    ///Size in bytes of the block cache behind value(). Blocks are evicted least recently used first. The default holds 8 blocks
+    void setValueCacheSize(bigint num_bytes);
+    bigint valueCacheSize() const;
+    ///Number of value() calls served from a cached block, and number that had to read a block
+    bigint valueCacheHits() const;
+    bigint valueCacheMisses() const;
+
     QString makePath() const; //not capturing the reshaping
     QJsonObject toPrvObject() const;
 
@@ -58,6 +75,10 @@ public:
     bool readChunk(Mda& X, bigint i1, bigint i2, bigint size1, bigint size2) const;
     ///Retrieve a chunk of the vectorized data of size N1xN2xN3 starting at position (i1,i2,i3)
     bool readChunk(Mda& X, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const;
+    ///Retrieve the rows listed in channels (0-based, out-of-range entries give zeros) for the columns i2..i2+size2-1. Only the needed channels are converted and copied
+    bool readChunk(Mda& X, const QList<int>& channels, bigint i2, bigint size2) const;
+    ///Same as above, for the slices i3..i3+size3-1 of a 3D array (e.g. a subset of channels of a set of clips)
+    bool readChunk(Mda& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3) const;
 
     ///A slow method to retrieve the value at location i of the vectorized array for example value(3+4*N1())==value(3,4). Consider using readChunk() instead
     double value(bigint i) const;
@@ -0,0 +1,64 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef DISKREADMDA16_H
+#define DISKREADMDA16_H
+
+#include "mda16.h"
+#include "mdaio.h"
+
+///True if paths is not empty and every path is a regular .mda file with int16 entries, so it may be read with DiskReadMda16 without loss
+bool mda_is_int16(const QStringList& paths);
+
+class DiskReadMda16Private;
+/**
+ * \class DiskReadMda16
+ * @brief Read-only access to a .mda file of int16 entries, read into an Mda16 without widening to float
+ *
+ * The int16 companion of DiskReadMda32 for quantized timeseries. When the file is int16 (see mda_is_int16) the entries are copied
+ * as they are; other data types are rounded and saturated. Out-of-range parts of a chunk are zero-padded, as with DiskReadMda32.
+ * Supports a single file or a concatenation of 2D arrays along the second dimension (timepoints). For memory mapping, direct I/O,
+ * streams and the channel-major cache use DiskReadMda32.
+ *
+ * readChunk() may be called concurrently from several threads on the same object.
+ */
+class DiskReadMda16 {
+public:
+    friend class DiskReadMda16Private;
+    DiskReadMda16(const QString& path = "");
+    DiskReadMda16(int concat_dimension, const QStringList& array_paths); //concatenation along dimension 2 (timepoints)
+    DiskReadMda16(const DiskReadMda16& other);
+    virtual ~DiskReadMda16();
+    void operator=(const DiskReadMda16& other);
+
+    void setPath(const QString& file_path);
+    void setConcatPaths(int concat_dimension, const QStringList& paths);
+
+    ///The dimensions of the array
+    bigint N1() const;
+    bigint N2() const;
+    bigint N3() const;
+    bigint N(int dim) const; // dim is 1-based indexing
+    bigint totalSize() const; //product of N1..N6
+
+    ///Retrieve a chunk of the vectorized data of size 1xN starting at position i
+    bool readChunk(Mda16& X, bigint i, bigint size) const;
+    ///Retrieve a chunk of the vectorized data of size N1xN2 starting at position (i1,i2)
+    bool readChunk(Mda16& X, bigint i1, bigint i2, bigint size1, bigint size2) const;
+    ///Retrieve a chunk of the vectorized data of size N1xN2xN3 starting at position (i1,i2,i3)
+    bool readChunk(Mda16& X, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const;
+    ///Retrieve the rows listed in channels (0-based, out-of-range entries give zeros) for the columns i2..i2+size2-1
+    bool readChunk(Mda16& X, const QList<int>& channels, bigint i2, bigint size2) const;
+
+    ///A slow method to retrieve the value at location i of the vectorized array. Consider using readChunk() instead
+    dtype16 value(bigint i) const;
+    ///A slow method to retrieve the value at location (i1,i2) of the array. Consider using readChunk() instead
+    dtype16 value(bigint i1, bigint i2) const;
+
+private:
+    DiskReadMda16Private* d;
+};
+
+#endif // DISKREADMDA16_H
@@ -8,6 +8,7 @@
 
 #include "mda.h"
 #include "mda32.h"
+#include "mda16.h"
 
 #include <QString>
 #include <mdaio.h>
@@ -19,10 +20,24 @@ public:
     DiskWriteMda();
     DiskWriteMda(int data_type, const QString& path, bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
     virtual ~DiskWriteMda();
+    ///A path ending in .mdaz is written in the compressed block format of mdazio.h, which implies append-only mode.
+    ///If path is a FIFO (or another non-seekable file) the array is streamed in order, see mdastream.h: chunks may arrive
+    ///in any order but are held in memory until the data before them has been written
     bool open(int data_type, const QString& path, bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
     bool open(const QString& path);
     void close();
 
+    ///Append-only streaming mode for processors that emit chunks in order: each chunk must start where the previous one ended,
+    ///and the data is written sequentially through a buffered stream. Anything not written is zero-padded on close. Call before open()
+    void setAppendOnly(bool val);
+    bool isAppendOnly() const;
+    ///True if the output is a pipe or FIFO (see open)
+    bool isStream() const;
+    ///Write the page-aligned part of each chunk through a descriptor that bypasses the page cache (O_DIRECT), so that streaming out a huge
+    ///file does not evict everyone else's cached data. Falls back to regular writes if the filesystem refuses. Ignored in append-only mode. Call before open()
+    void setDirectIO(bool val);
+    bool isDirectIO() const;
+
     bigint N1();
     bigint N2();
     bigint N3();
@@ -31,6 +46,7 @@ public:
     bigint N6();
     bigint totalSize();
 
+    ///Chunks are written at explicit offsets, so writeChunk may be called concurrently for non-overlapping regions
     bool writeChunk(Mda& X, bigint i);
     bool writeChunk(Mda& X, bigint i1, bigint i2);
     bool writeChunk(Mda& X, bigint i1, bigint i2, bigint i3);
@@ -38,6 +54,12 @@ public:
     bool writeChunk(Mda32& X, bigint i);
     bool writeChunk(Mda32& X, bigint i1, bigint i2);
     bool writeChunk(Mda32& X, bigint i1, bigint i2, bigint i3);
+    bool writeChunk(Mda16& X, bigint i);
+    bool writeChunk(Mda16& X, bigint i1, bigint i2);
+    bool writeChunk(Mda16& X, bigint i1, bigint i2, bigint i3);
+
+    ///Write a view (see Mda32::getChunk) without copying it into an array first. Only whole contiguous columns are supported (X.N1()==N1(), i1==0)
+    bool writeChunk(const Mda32ConstView& X, bigint i1, bigint i2);
 
 private:
     DiskWriteMdaPrivate* d;
@@ -0,0 +1,121 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDA16_H
+#define MDA16_H
+
+#ifdef QT_CORE_LIB
+#include <QString>
+#include <QDebug>
+#endif
+#include <QSharedPointer>
+
+#include "mlcommon.h"
+#include "mdaview.h"
+
+typedef int16_t dtype16;
+
+class MdaDataInt16;
+
+typedef MdaStridedView<dtype16> Mda16View;
+typedef MdaStridedView<const dtype16> Mda16ConstView;
+
+/** \class Mda16 - a multi-dimensional array of 16-bit integers corresponding to the .mda file format
+ * @brief The Mda16 class
+ *
+ * The int16 companion of Mda32, for timeseries that were quantized on output (see quantization_unit of bandpass_filter and whiten).
+ * Such data may be read (see DiskReadMda16), held and processed at half the size of Mda32. The values are in units of the quantization.
+ * All indexing is 0-based.
+ */
+class Mda16 {
+public:
+    ///Construct an array of size N1xN2x...xN6
+    Mda16(bigint N1 = 1, bigint N2 = 1, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
+    ///Construct an array and read the .mda file
+    Mda16(const QString mda_filename);
+    ///Copy constructor
+    Mda16(const Mda16& other);
+    ///Assignment operator
+    void operator=(const Mda16& other);
+    ///Destructor
+    virtual ~Mda16();
+    ///Allocate an array of size N1xN2x...xN6
+    bool allocate(bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
+    ///Create an array with content read from the .mda file specified by path. Entries of other data types are rounded and saturated
+    bool read(const QString& path);
+    ///Write the array to the .mda file specified by path, with file format 16-bit integer
+    bool write16(const QString& path) const;
+    ///Write the array to the .mda file specified by path, with file format 32-bit float
+    bool write32(const QString& path) const;
+
+    ///The number of dimensions. This will be between 2 and 6. It will be 3 if N3()>1 and N4()...N6() are all 1. And so on.
+    int ndims() const;
+    ///The size of the first dimension
+    bigint N1() const;
+    ///The size of the second dimension
+    bigint N2() const;
+    ///The size of the third dimension
+    bigint N3() const;
+    ///The size of the fourth dimension
+    bigint N4() const;
+    ///The size of the fifth dimension
+    bigint N5() const;
+    ///The size of the sixth dimension
+    bigint N6() const;
+    ///The product of N1() through N6()
+    bigint totalSize() const;
+
+    ///The value of the ith entry of the vectorized array. Use the slower value(i) to safely return 0 when i is out of bounds.
+    dtype16 get(bigint i) const;
+    ///The value of the (i1,i2) entry of the array. Use the slower value(i1,i2) when either of the indices are out of bounds.
+    dtype16 get(bigint i1, bigint i2) const;
+    ///The value of the (i1,i2,i3) entry of the array. Use the slower value(i1,i2,i3) when any of the indices are out of bounds.
+    dtype16 get(bigint i1, bigint i2, bigint i3) const;
+
+    ///Set the value of the ith entry of the vectorized array to val
+    void set(dtype16 val, bigint i);
+    ///Set the value of the (i1,i2) entry of the array to val
+    void set(dtype16 val, bigint i1, bigint i2);
+    ///Set the value of the (i1,i2,i3) entry of the array to val
+    void set(dtype16 val, bigint i1, bigint i2, bigint i3);
+
+    ///Slower version of get(i), safely returning 0 when i is out of bounds.
+    dtype16 value(bigint i) const;
+    ///Slower version of get(i1,i2), safely returning 0 when either of the indices are out of bounds.
+    dtype16 value(bigint i1, bigint i2) const;
+    ///Slower version of get(i1,i2,i3), safely returning 0 when any of the indices are out of bounds.
+    dtype16 value(bigint i1, bigint i2, bigint i3) const;
+
+    ///Slower version of set(val,i), safely doing nothing when i is out of bounds.
+    void setValue(dtype16 val, bigint i);
+    ///Slower version of set(val,i1,i2), safely doing nothing when either of the indices are out of bounds.
+    void setValue(dtype16 val, bigint i1, bigint i2);
+    ///Slower version of set(val,i1,i2,i3), safely doing nothing when any of the indices are out of bounds.
+    void setValue(dtype16 val, bigint i1, bigint i2, bigint i3);
+
+    ///Return a pointer to the 1D raw data. The internal data may be efficiently read/written.
+    dtype16* dataPtr();
+    const dtype16* constDataPtr() const;
+    ///Return a pointer to the 1D raw data at the vectorized location i
+    dtype16* dataPtr(bigint i);
+    ///Return a pointer to the 1D raw data at the the location (i1,i2)
+    dtype16* dataPtr(bigint i1, bigint i2);
+    ///Return a pointer to the 1D raw data at the the location (i1,i2,i3)
+    dtype16* dataPtr(bigint i1, bigint i2, bigint i3);
+
+    ///Retrieve a chunk of the vectorized data of size N1xN2 starting at position (i1,i2), zero-padded outside the array
+    void getChunk(Mda16& ret, bigint i1, bigint i2, bigint N1, bigint N2) const;
+    ///View the block of size N1xN2xN3 at (i1,i2,i3) in place, without copying. Returns false (and an empty view) if the block is not entirely inside the array.
+    bool getChunk(Mda16ConstView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const;
+    bool getChunk(Mda16View& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3);
+
+    dtype16 minimum() const;
+    dtype16 maximum() const;
+
+private:
+    QSharedDataPointer<MdaDataInt16> d;
+};
+
+#endif // MDA16_H
@@ -10,14 +10,17 @@
 #include <QString>
 #include <QDebug>
 #endif
+#include <QSharedPointer>
 
 #include "mlcommon.h"
+#include "mdaview.h"
 
 typedef float dtype32;
 
 extern void* allocate(const bigint nbytes);
 
 class MdaDataFloat;
+class MdaMemoryMap;
 
 /** \class Mda32 - a multi-dimensional array corresponding to the .mda file format
  * @brief The Mda32 class
@@ -38,6 +41,10 @@ public:
     virtual ~Mda32();
     ///Allocate an array of size N1xN2x...xN6
     bool allocate(bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
+    ///Point the array at read-only memory inside a memory mapped file instead of allocating. A private copy is made on the first non-const access.
+    void setExternalData(const dtype32* data, const QSharedPointer<MdaMemoryMap>& mapping, bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1);
+    ///True if the data is a view set by setExternalData() that has not been copied yet
+    bool hasExternalData() const;
 #ifdef QT_CORE_LIB
     ///Create an array with content read from the .mda file specified by path
     bool read(const QString& path);
@@ -136,6 +143,13 @@ public:
     void getChunk(Mda32& ret, bigint i1, bigint i2, bigint N1, bigint N2) const;
     ///Retrieve a chunk of the vectorized data of size N1xN2xN3 starting at position (i1,i2,i3)
     void getChunk(Mda32& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const;
+    ///View the block of size N1xN2 at (i1,i2) in place, without copying. Returns false (and an empty view) if the block is not entirely inside the array.
+    bool getChunk(Mda32ConstView& ret, bigint i1, bigint i2, bigint N1, bigint N2) const;
+    ///View the block of size N1xN2xN3 at (i1,i2,i3) in place, without copying. Returns false (and an empty view) if the block is not entirely inside the array.
+    bool getChunk(Mda32ConstView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const;
+    ///Writable versions of the views above, the entries may be modified in place
+    bool getChunk(Mda32View& ret, bigint i1, bigint i2, bigint N1, bigint N2);
+    bool getChunk(Mda32View& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3);
 
     ///Set a chunk of the vectorized data starting at position i
     void setChunk(Mda32& X, bigint i);
@@ -2,13 +2,18 @@
 #define MDA_P_H
 
 #include <QSharedData>
+#include <QSharedPointer>
 #include "icounter.h"
 #include <objectregistry.h>
 #include <cstring>
+#include <new>
 #include "mlcommon.h"
+#include "mdapool.h"
 
 #define MDA_MAX_DIMS 6
 
+class MdaMemoryMap;
+
 template <typename T>
 class MdaData : public QSharedData {
 public:
@@ -24,10 +29,10 @@ public:
     {
         ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
         if (manager) {
-            allocatedCounter = static_cast<IIntCounter*>(manager->counter("allocated_bytes"));
-            freedCounter = static_cast<IIntCounter*>(manager->counter("freed_bytes"));
-            bytesReadCounter = static_cast<IIntCounter*>(manager->counter("bytes_read"));
-            bytesWrittenCounter = static_cast<IIntCounter*>(manager->counter("bytes_written"));
+            allocatedCounter = qobject_cast<IThreadCounter*>(manager->counter("allocated_bytes"));
+            freedCounter = qobject_cast<IThreadCounter*>(manager->counter("freed_bytes"));
+            bytesReadCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_read"));
+            bytesWrittenCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_written"));
         }
     }
     MdaData(const MdaData& other)
@@ -47,6 +52,18 @@ public:
     {
         deallocate();
     }
+    //the shared data object of a short-lived Mda/Mda32 comes from the pool too (see MdaPoolScope)
+    static void* operator new(size_t num_bytes)
+    {
+        void* ptr = MdaPool::allocate(num_bytes);
+        if (!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+    static void operator delete(void* ptr, size_t num_bytes)
+    {
+        MdaPool::release(ptr, num_bytes);
+    }
     bool allocate(T value, bigint N1, bigint N2, bigint N3 = 1, bigint N4 = 1, bigint N5 = 1, bigint N6 = 1)
     {
         deallocate();
@@ -62,11 +79,7 @@ public:
                 qCritical() << QString("Unable to allocate Mda of size %1x%2x%3x%4x%5x%6 (total=%7)").arg(N1).arg(N2).arg(N3).arg(N4).arg(N5).arg(N6).arg(totalSize());
                 exit(-1);
             }
-            if (value == 0.0) {
-                std::memset(data(), 0, totalSize() * sizeof(value_type));
-            }
-            else
-                std::fill(data(), data() + totalSize(), value);
+            MdaPool::fill(data(), totalSize(), value);
         }
         return true;
     }
@@ -77,29 +90,68 @@ public:
 
     void allocate(bigint size)
     {
-        //m_data = (value_type*)::allocate(size * sizeof(value_type));
-        m_data = (value_type*)malloc(size * sizeof(value_type));
+        m_data = (value_type*)MdaPool::allocate(size * sizeof(value_type));
         if (!m_data)
             return;
+        m_allocated_bytes = size * sizeof(value_type);
         incrementBytesAllocatedCounter(totalSize() * sizeof(value_type));
     }
     void deallocate()
     {
         if (!m_data)
             return;
-        free(m_data);
+        if (m_external_owner) {
+            m_external_owner.clear();
+            m_data = 0;
+            return;
+        }
+        MdaPool::release(m_data, m_allocated_bytes);
+        m_allocated_bytes = 0;
         incrementBytesFreedCounter(totalSize() * sizeof(value_type));
         m_data = 0;
     }
     inline bigint totalSize() const { return total_size; }
     inline void setTotalSize(bigint ts) { total_size = ts; }
-    inline T* data() { return m_data; }
+    inline T* data()
+    {
+        if (m_external_owner)
+            detachExternalData();
+        return m_data;
+    }
     inline const T* constData() const { return m_data; }
     inline T at(bigint idx) const { return *(constData() + idx); }
     inline T at(bigint i1, bigint i2) const { return at(i1 + dim(0) * i2); }
-    inline void set(T val, bigint idx) { m_data[idx] = val; }
+    inline void set(T val, bigint idx)
+    {
+        if (m_external_owner)
+            detachExternalData();
+        m_data[idx] = val;
+    }
     inline void set(T val, bigint i1, bigint i2) { set(val, i1 + dim(0) * i2); }
 
+    //Use memory inside a read-only memory mapped file rather than allocating
+    //The mapping is kept alive as long as we point into it, and the first non-const access makes a private copy
+    void setExternalData(T* ptr, const QSharedPointer<MdaMemoryMap>& mapping, bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
+    {
+        deallocate();
+        setDims(N1, N2, N3, N4, N5, N6);
+        setTotalSize(N1 * N2 * N3 * N4 * N5 * N6);
+        m_data = ptr;
+        m_external_owner = mapping;
+    }
+    inline bool hasExternalData() const { return !m_external_owner.isNull(); }
+    void detachExternalData()
+    {
+        if (!m_external_owner)
+            return;
+        T* ptr = m_data;
+        m_data = 0;
+        allocate(totalSize());
+        if (m_data)
+            std::copy(ptr, ptr + totalSize(), m_data);
+        m_external_owner.clear();
+    }
+
     inline bigint dims(bigint idx) const
     {
         if (idx < 0 || idx >= (bigint)m_dims.size())
@@ -245,10 +297,12 @@ private:
     pointer m_data;
     std::vector<bigint> m_dims;
     bigint total_size;
-    mutable IIntCounter* allocatedCounter = nullptr;
-    mutable IIntCounter* freedCounter = nullptr;
-    mutable IIntCounter* bytesReadCounter = nullptr;
-    mutable IIntCounter* bytesWrittenCounter = nullptr;
+    bigint m_allocated_bytes = 0; //what was requested from MdaPool for m_data
+    QSharedPointer<MdaMemoryMap> m_external_owner;
+    mutable IThreadCounter* allocatedCounter = nullptr;
+    mutable IThreadCounter* freedCounter = nullptr;
+    mutable IThreadCounter* bytesReadCounter = nullptr;
+    mutable IThreadCounter* bytesWrittenCounter = nullptr;
 };
 
 #endif // MDA_P_H
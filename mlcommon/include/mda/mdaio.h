@@ -89,6 +89,39 @@ bigint mda_write_uint16(uint16_t* data, struct MDAIO_HEADER* H, bigint n, FILE*
 bigint mda_write_float64(double* data, struct MDAIO_HEADER* H, bigint n, FILE* output_file);
 bigint mda_write_uint32(uint32_t* data, struct MDAIO_HEADER* H, bigint n, FILE* output_file);
 
+//convert n entries stored in memory with the data type of the header (for example a memory mapped file) to the requested type
+bigint mda_convert_float32(float* data, const struct MDAIO_HEADER* H, const void* raw, bigint n);
+bigint mda_convert_float64(double* data, const struct MDAIO_HEADER* H, const void* raw, bigint n);
+//the reverse: store n entries in memory at raw, using the data type of the header. Returns false for an unknown data type.
+//Conversions to integer types round to nearest (half to even) and saturate
+bool mda_convert_to_raw_float32(void* raw, const struct MDAIO_HEADER* H, const float* data, bigint n);
+bool mda_convert_to_raw_float64(void* raw, const struct MDAIO_HEADER* H, const double* data, bigint n);
+int mda_get_num_bytes_per_entry(int data_type);
+
+//positional read/write of n entries at byte offset of the file descriptor. These do not use or change the file position,
+//so any number of threads may call them on the same descriptor at once. Returns the number of entries transferred
+bigint mda_pread_float32(float* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+bigint mda_pread_float64(double* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+bigint mda_pwrite_float32(const float* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+bigint mda_pwrite_float64(const double* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+//the int16 variants copy without conversion when the file is int16 (see Mda16)
+bigint mda_pread_int16(int16_t* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+bigint mda_pwrite_int16(const int16_t* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset);
+
+//direct I/O, bypassing the page cache, for long single-pass streams. mda_open_direct returns -1 if the platform has no such mode.
+//The direct variants read/write the page-aligned part through direct_fd (opened with mda_open_direct) and everything else through
+//fd (a regular descriptor of the same file). If the filesystem refuses direct I/O they fall back to fd, dropping the pages that
+//were touched from the cache, and set *refused
+#define MDAIO_DIRECT_ALIGNMENT 4096
+#define MDAIO_DIRECT_BLOCK_BYTES (8 * 1024 * 1024)
+int mda_open_direct(const char* path, bool for_writing);
+bigint mda_pread_direct_float32(float* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused = 0);
+bigint mda_pread_direct_float64(double* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused = 0);
+bigint mda_pwrite_direct_float32(const float* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused = 0);
+bigint mda_pwrite_direct_float64(const double* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused = 0);
+//advise the kernel to drop the cached pages of a byte range (e.g. after a buffered streaming pass)
+void mda_drop_cache(int fd, bigint offset, bigint num_bytes);
+
 //here's an example usage function. See top of file for more info.
 void transpose_array(char* infile_path, char* outfile_path);
 
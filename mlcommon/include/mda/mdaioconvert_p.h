@@ -0,0 +1,92 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAIOCONVERT_P_H
+#define MDAIOCONVERT_P_H
+
+#include "mdaio.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*
+ * Data type conversion kernels used by mdaio. The int16/uint16/int32 <-> float/double conversions
+ * are vectorized (SSE2 or AVX2, selected at runtime) on x86-64, everything else is plain C++.
+ * Conversions from floating point to integer types round to nearest and saturate.
+ */
+
+#define MDAIO_STAGING_BUFFER_BYTES (1 << 20)
+#define MDAIO_STAGING_BUFFER_ALIGNMENT 4096
+
+///A scratch buffer of at least num_bytes owned by the calling thread, reused between calls. It is page aligned, as direct I/O requires
+unsigned char* mdaio_staging_buffer(bigint num_bytes);
+
+///Name of the instruction set used by the conversion kernels (avx2, sse2 or scalar)
+const char* mdaio_convert_isa();
+///For testing: use the kernels of isa (avx2, sse2 or scalar), or of the best one available if isa is empty.
+///Returns false if this build or CPU does not support isa. Not thread-safe
+bool mdaio_select_convert_isa(const char* isa);
+
+void mdaio_convert(float* dst, const int16_t* src, bigint n);
+void mdaio_convert(float* dst, const uint16_t* src, bigint n);
+void mdaio_convert(float* dst, const int32_t* src, bigint n);
+void mdaio_convert(double* dst, const int16_t* src, bigint n);
+void mdaio_convert(double* dst, const uint16_t* src, bigint n);
+void mdaio_convert(double* dst, const int32_t* src, bigint n);
+///dst = src*scale, rounded and saturated
+void mdaio_quantize(int16_t* dst, const float* src, bigint n, float scale);
+void mdaio_quantize(uint16_t* dst, const float* src, bigint n, float scale);
+void mdaio_quantize(int32_t* dst, const float* src, bigint n, float scale);
+
+template <typename TargetType>
+TargetType mdaio_round_saturate(double val)
+{
+    val = std::nearbyint(val);
+    if (val <= (double)std::numeric_limits<TargetType>::min())
+        return std::numeric_limits<TargetType>::min();
+    if (val >= (double)std::numeric_limits<TargetType>::max())
+        return std::numeric_limits<TargetType>::max();
+    return (TargetType)val;
+}
+
+template <typename TargetType, typename SourceType>
+void mdaio_quantize(TargetType* dst, const SourceType* src, bigint n, SourceType scale)
+{
+    if (std::numeric_limits<TargetType>::is_integer) {
+        for (bigint i = 0; i < n; i++)
+            dst[i] = mdaio_round_saturate<TargetType>((double)src[i] * scale);
+    }
+    else {
+        for (bigint i = 0; i < n; i++)
+            dst[i] = (TargetType)(src[i] * scale);
+    }
+}
+
+///Generic conversion, the overloads above take precedence for the vectorized pairs
+template <typename TargetType, typename SourceType>
+void mdaio_convert(TargetType* dst, const SourceType* src, bigint n)
+{
+    if ((std::numeric_limits<TargetType>::is_integer) && (!std::numeric_limits<SourceType>::is_integer))
+        mdaio_quantize(dst, src, n, (SourceType)1);
+    else
+        std::copy(src, src + n, dst);
+}
+
+inline void mdaio_convert(int16_t* dst, const float* src, bigint n)
+{
+    mdaio_quantize(dst, src, n, 1.0f);
+}
+
+inline void mdaio_convert(uint16_t* dst, const float* src, bigint n)
+{
+    mdaio_quantize(dst, src, n, 1.0f);
+}
+
+inline void mdaio_convert(int32_t* dst, const float* src, bigint n)
+{
+    mdaio_quantize(dst, src, n, 1.0f);
+}
+
+#endif // MDAIOCONVERT_P_H
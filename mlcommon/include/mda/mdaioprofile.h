@@ -0,0 +1,63 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAIOPROFILE_H
+#define MDAIOPROFILE_H
+
+#include "mdaio.h"
+#include <QJsonObject>
+#include <QString>
+#include <chrono>
+
+#define MDA_IO_PROFILE_ENV "ML_IO_PROFILE" //path of the JSON summary, profiling is off when unset
+#define MDA_IO_PROFILE_NUM_SEEK_BUCKETS 48
+
+/**
+ * \class MdaIOProfile
+ * @brief Per-file accounting of the reads and writes of DiskReadMda, DiskReadMda32, DiskReadMda16 and DiskWriteMda
+ *
+ * When enabled, every read or write records, for its path: the bytes transferred, the number of calls, the time spent in
+ * the call and the distance from the end of the previous call on the same path. Distances are kept in a log2 histogram
+ * (bucket 0 is sequential, bucket b>0 is from 2^(b-1) up to 2^b bytes), so a per-event readChunk shows up as many calls
+ * with large seeks, while a streaming pass is nearly all in bucket 0.
+ *
+ * Profiling is enabled by setting the environment variable ML_IO_PROFILE to a file name; the summary is then written
+ * there as JSON when the process exits. mountainprocess does this for --_io_profile and adds the summary to the
+ * process output. When disabled, the cost is a check of one flag per call.
+ */
+class MdaIOProfile {
+public:
+    enum Direction {
+        Read,
+        Write
+    };
+    static bool isEnabled();
+    static void setEnabled(bool val);
+    ///Record a call that transferred num_bytes at the byte offset in the file at path
+    static void record(Direction direction, const QString& path, bigint offset, bigint num_bytes, int64_t nanoseconds);
+    ///Totals since the start of the process, with an entry per path under "files"
+    static QJsonObject summary();
+    static bool writeSummary(const QString& fname);
+    static void clear();
+};
+
+///Times a read or write and records it in MdaIOProfile, if profiling is enabled
+class MdaIOProfileScope {
+public:
+    MdaIOProfileScope(MdaIOProfile::Direction direction, const QString& path, bigint offset);
+    ~MdaIOProfileScope();
+    ///The bytes actually transferred, which may fall short of what was asked for
+    void setNumBytes(bigint num_bytes);
+
+private:
+    bool m_enabled;
+    MdaIOProfile::Direction m_direction;
+    QString m_path; //a copy: the caller may pass a temporary
+    bigint m_offset;
+    bigint m_num_bytes = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // MDAIOPROFILE_H
@@ -0,0 +1,46 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAMMAP_H
+#define MDAMMAP_H
+
+#include <QString>
+#include <QSharedPointer>
+#include "mlcommon.h"
+
+/**
+ * \class MdaMemoryMap
+ * @brief Read-only memory mapping of an entire .mda file
+ *
+ * Used by DiskReadMda and DiskReadMda32 to serve chunks directly from the page cache.
+ * The mapping is shared (via QSharedPointer) with any Mda/Mda32 views handed out, so it
+ * stays valid for as long as one of those views is alive.
+ */
+class MdaMemoryMap {
+public:
+    MdaMemoryMap();
+    virtual ~MdaMemoryMap();
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+
+    ///Pointer to the first byte of the file (including the header)
+    const unsigned char* data() const;
+    ///Size of the file in bytes
+    bigint size() const;
+
+    ///Returns a null pointer if the file could not be mapped
+    static QSharedPointer<MdaMemoryMap> map(const QString& path);
+
+private:
+    unsigned char* m_data = 0;
+    bigint m_size = 0;
+
+    MdaMemoryMap(const MdaMemoryMap&) = delete;
+    void operator=(const MdaMemoryMap&) = delete;
+};
+
+#endif // MDAMMAP_H
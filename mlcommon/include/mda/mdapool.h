@@ -0,0 +1,82 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAPOOL_H
+#define MDAPOOL_H
+
+#include "mdaio.h"
+
+#define MDAPOOL_MIN_BLOCK_BYTES 64
+#define MDAPOOL_MAX_BLOCK_BYTES (4 * 1024 * 1024)
+#define MDAPOOL_DEFAULT_THREAD_CACHE_LIMIT (64 * 1024 * 1024)
+#define MDAPOOL_ALIGNMENT 64 //a cache line
+#define MDAPOOL_HUGE_PAGE_BYTES (2 * 1024 * 1024)
+#define MDAPOOL_HUGE_PAGE_THRESHOLD (32 * 1024 * 1024)
+#define MDAPOOL_PARALLEL_FILL_THRESHOLD (64 * 1024 * 1024)
+
+/**
+ * \class MdaPool
+ * @brief Per-thread free lists for the storage of Mda and Mda32
+ *
+ * Loops that create and drop a small Mda32 per event (readChunk of a clip, a template slice, ...) spend much of their time in
+ * malloc/free and in page faults on freshly allocated memory. While an MdaPoolScope is active, blocks up to MDAPOOL_MAX_BLOCK_BYTES
+ * are rounded up to a power of two and, when released on a thread with an active scope, go back to a free list of that thread
+ * instead of to the system, so the next array of the same size class reuses warm memory without locking.
+ *
+ * Outside of a scope blocks have their exact size and the behavior is that of malloc/free. A block may be released on any thread.
+ *
+ * All blocks are aligned to a cache line. Blocks of at least MDAPOOL_HUGE_PAGE_THRESHOLD are aligned to a huge page and
+ * advised to use transparent huge pages, which saves TLB misses in kernels that sweep multi-GB arrays.
+ *
+ * Example:
+ *   MdaPoolScope pool_scope;
+ *   for (bigint i = 0; i < L; i++) {
+ *       Mda32 clip;
+ *       X.readChunk(clip, 0, t1, M, T);
+ *       ...
+ *   }
+ */
+class MdaPool {
+public:
+    ///Allocate num_bytes, the returned pointer must be passed back to release() with the same num_bytes
+    static void* allocate(bigint num_bytes);
+    static void release(void* ptr, bigint num_bytes);
+
+    ///Set n entries to value. From MDAPOOL_PARALLEL_FILL_THRESHOLD bytes on this is split over a fixed set of helper threads, so that the first
+    ///touch of the pages of a new array spreads them over the NUMA nodes instead of placing them all on the node of the allocating thread.
+    ///A fill made while another one is using the helpers (e.g. from the threads of a parallel region) is done by the calling thread alone
+    static void fill(float* data, bigint n, float value);
+    static void fill(double* data, bigint n, double value);
+    static void fill(int16_t* data, bigint n, int16_t value);
+    ///Enable or disable the multi-threaded fill above (default enabled)
+    static void setParallelFirstTouch(bool val);
+    static bool parallelFirstTouch();
+
+    ///Free the blocks cached by the calling thread
+    static void clearThreadCache();
+    ///Total size of the blocks cached by the calling thread
+    static bigint threadCacheBytes();
+    ///The most the calling thread will cache (default MDAPOOL_DEFAULT_THREAD_CACHE_LIMIT), beyond which released blocks are freed
+    static void setThreadCacheLimit(bigint num_bytes);
+    static bigint threadCacheLimit();
+};
+
+/**
+ * \class MdaPoolScope
+ * @brief Enables the thread cache of MdaPool for the lifetime of the object
+ *
+ * Scopes nest; the cache of the thread is cleared when the outermost one ends. Create one inside each thread of a parallel region.
+ */
+class MdaPoolScope {
+public:
+    MdaPoolScope();
+    virtual ~MdaPoolScope();
+
+private:
+    MdaPoolScope(const MdaPoolScope&) = delete;
+    void operator=(const MdaPoolScope&) = delete;
+};
+
+#endif // MDAPOOL_H
@@ -0,0 +1,59 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAPREFETCHER_H
+#define MDAPREFETCHER_H
+
+#include "diskreadmda32.h"
+
+class MdaPrefetcherPrivate;
+/**
+ * \class MdaPrefetcher
+ * @brief Sequential chunk reader that keeps the next chunks of a DiskReadMda32 loading on a background thread
+ *
+ * The schedule is a sweep along the second dimension: chunk k covers timepoints
+ * [t1 + k*chunk_size - overlap_size, t1 + (k+1)*chunk_size + overlap_size), read as an N1 x (chunk_size + 2*overlap_size) array
+ * (zero-padded outside the array, as with readChunk). Up to numBuffers() chunks are read ahead, so disk and CPU overlap.
+ *
+ * Example:
+ *   MdaPrefetcher P(X, chunk_size, overlap_size);
+ *   Mda32 chunk;
+ *   bigint timepoint;
+ *   while (P.next(chunk, timepoint)) { ... }
+ *
+ * stallTimeMsec() is the time next() spent waiting for data and readTimeMsec() the time spent reading on the background thread.
+ * A large stall time means the consumer is I/O bound.
+ */
+class MdaPrefetcher {
+public:
+    friend class MdaPrefetcherPrivate;
+    MdaPrefetcher(const DiskReadMda32& X, bigint chunk_size, bigint overlap_size = 0);
+    virtual ~MdaPrefetcher();
+
+    ///Restrict the sweep to timepoints t1 <= t < t2 (default is the whole array). Must be called before the first next()
+    void setRange(bigint t1, bigint t2);
+    ///Number of chunks that may be held ahead of the consumer (default 2). Must be called before the first next()
+    void setNumBuffers(int num);
+    ///If true (default false), the last chunk is shortened so it does not extend past t2 + overlap_size
+    void setTruncateLastChunk(bool val);
+    ///Only read these rows (0-based) of the first dimension, see DiskReadMda32::readChunk. Must be called before the first next()
+    void setChannels(const QList<int>& channels);
+    int numBuffers() const;
+    bigint numChunks() const;
+
+    ///Retrieve the next chunk of the schedule. timepoint is set to the start of the chunk (not counting the overlap). Returns false when done or on a read error
+    bool next(Mda32& chunk, bigint& timepoint);
+    ///Stop the background thread early, e.g. when the consumer gives up before the end of the sweep
+    void stop();
+    bool hadError() const;
+
+    double stallTimeMsec() const;
+    double readTimeMsec() const;
+
+private:
+    MdaPrefetcherPrivate* d;
+};
+
+#endif // MDAPREFETCHER_H
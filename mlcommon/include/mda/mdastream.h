@@ -0,0 +1,107 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDASTREAM_H
+#define MDASTREAM_H
+
+#include <QString>
+#include <QMutex>
+#include <QMap>
+#include <stdio.h>
+#include <vector>
+#include "mdaio.h"
+
+/*
+ * Streaming .mda: the usual header followed by the data in vectorized order, read and written strictly front to back
+ * without seeking. This lets processors that sweep the second dimension (time) in order read from and write to pipes
+ * and FIFOs, so that stages can run concurrently in a shell pipeline, e.g.
+ *
+ *   mkfifo filt.mda
+ *   mp-run-process ms2.bandpass_filter --timeseries=raw.mda --timeseries_out=filt.mda ... &
+ *   mp-run-process ms2.whiten --timeseries=filt.mda ...
+ *
+ * DiskReadMda32 and DiskWriteMda switch to these classes automatically when the path is not a regular file (see mda_is_stream_path).
+ */
+
+///Returns true if path exists and is a FIFO, socket or character device (e.g. /dev/stdin), which can only be read or written in order
+bool mda_is_stream_path(const QString& path);
+
+/**
+ * \class MdaStreamReader
+ * @brief Forward-only reader of the data of a streamed .mda.
+ *
+ * Requests must come in order of their starting index (as from MdaPrefetcher or a sequential loop), but may overlap the
+ * previous request. Everything before the start of a request is discarded, so only the span of the latest request is held in memory.
+ * Reads may be issued from several threads (they are serialized).
+ */
+class MdaStreamReader {
+public:
+    MdaStreamReader();
+    virtual ~MdaStreamReader();
+
+    ///Open the stream and read the header
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+    MDAIO_HEADER header() const;
+
+    ///Read n entries starting at vectorized index i, which must not be before the start of the previous request.
+    ///Returns the number of entries read (fewer than n at the end of the stream, 0 on error)
+    bigint readFloat32(float* data, bigint i, bigint n);
+    bigint readFloat64(double* data, bigint i, bigint n);
+
+private:
+    FILE* m_file = 0;
+    MDAIO_HEADER m_header;
+    QMutex m_mutex;
+    std::vector<unsigned char> m_window; //raw entries m_window_start, m_window_start+1, ... as read from the stream
+    bigint m_window_start = 0;
+    bigint m_window_count = 0;
+
+    template <typename T>
+    bigint read_entries(T* data, bigint i, bigint n);
+    void fill_window(bigint i, bigint n);
+
+    MdaStreamReader(const MdaStreamReader&) = delete;
+    void operator=(const MdaStreamReader&) = delete;
+};
+
+/**
+ * \class MdaStreamWriter
+ * @brief Writer of a streamed .mda to an already open file (see DiskWriteMda).
+ *
+ * Chunks may be handed in out of order (e.g. from a parallel loop); those that do not start at the end of the data written
+ * so far are held (converted to the output data type) until the gap is filled. Thread-safe.
+ */
+class MdaStreamWriter {
+public:
+    MdaStreamWriter();
+    virtual ~MdaStreamWriter();
+
+    ///Write the header H (num_bytes_per_entry and header_size are filled in) at the current position of F
+    bool begin(FILE* F, struct MDAIO_HEADER* H);
+    ///Write n entries at vectorized index i, converted to the data type of the header
+    bool writeFloat32(const float* data, bigint i, bigint n);
+    bool writeFloat64(const double* data, bigint i, bigint n);
+    bigint numEntriesWritten() const;
+    ///Write any held chunks, filling gaps and the remainder of the array with zeros, and flush. Does not close F
+    bool finish();
+
+private:
+    FILE* m_file = 0;
+    MDAIO_HEADER m_header;
+    bigint m_total_size = 0;
+    bigint m_num_written = 0;
+    QMap<bigint, std::vector<unsigned char> > m_pending; //raw chunks waiting for the data before them, by starting index
+    mutable QMutex m_mutex;
+
+    bool write_raw(std::vector<unsigned char>& raw, bigint i);
+    bool write_zeros(bigint n);
+
+    MdaStreamWriter(const MdaStreamWriter&) = delete;
+    void operator=(const MdaStreamWriter&) = delete;
+};
+
+#endif // MDASTREAM_H
@@ -0,0 +1,119 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDASUBBLOCK_P_H
+#define MDASUBBLOCK_P_H
+
+#include "mdaio.h"
+#include <QList>
+#include <QVector>
+#include <stdio.h>
+#include <string.h>
+
+#define SUBBLOCK_BUFFER_SIZE 1e6 //entries read at a time by mda_read_subblock
+#define SUBBLOCK_MAX_GAP_BYTES 32768 //rows are read together unless the gap between the needed parts is larger than this
+
+/*
+ * The reading of a sub-block X(c,j2,j3) = Y(channels[c],i2+j2,i3+j3) shared by DiskReadMda, DiskReadMda32 and DiskReadMda16.
+ * Consecutive channels are handled as one run, and only the wanted runs are copied into X. The readers keep their own
+ * memory-mapped and transposed paths, and use mda_read_subblock for reads through the file.
+ */
+
+struct MdaChannelRun {
+    bigint src, dst, len;
+};
+
+struct MdaSubblock {
+    bigint size1, i2, i3, size2, size3;
+    bigint N1, N2, N3;
+    QVector<MdaChannelRun> runs;
+    bigint k2A, k2B, k3A, k3B; //the part of the sub-block inside Y
+    bigint ch_min, span; //the smallest wanted channel, and the number of channels from there to the largest
+
+    MdaSubblock(const QList<int>& channels, bigint i2_in, bigint i3_in, bigint size2_in, bigint size3_in, bigint N1_in, bigint N2_in, bigint N3_in)
+        : size1(channels.count())
+        , i2(i2_in)
+        , i3(i3_in)
+        , size2(size2_in)
+        , size3(size3_in)
+        , N1(N1_in)
+        , N2(N2_in)
+        , N3(N3_in)
+    {
+        for (bigint c = 0; c < size1; c++) {
+            bigint ch = channels[c];
+            if ((ch < 0) || (ch >= N1))
+                continue;
+            if ((!runs.isEmpty()) && (runs.last().src + runs.last().len == ch) && (runs.last().dst + runs.last().len == c)) {
+                runs.last().len++;
+            }
+            else {
+                MdaChannelRun R;
+                R.src = ch;
+                R.dst = c;
+                R.len = 1;
+                runs << R;
+            }
+        }
+        k2A = qMax(i2, (bigint)0);
+        k2B = qMin(i2 + size2, N2);
+        k3A = qMax(i3, (bigint)0);
+        k3B = qMin(i3 + size3, N3);
+        ch_min = 0;
+        span = 0;
+        if (runs.isEmpty())
+            return;
+        ch_min = runs[0].src;
+        bigint ch_max = runs[0].src + runs[0].len - 1;
+        for (int r = 0; r < runs.count(); r++) {
+            ch_min = qMin(ch_min, runs[r].src);
+            ch_max = qMax(ch_max, runs[r].src + runs[r].len - 1);
+        }
+        span = ch_max - ch_min + 1;
+    }
+
+    ///True if nothing of Y is wanted, so that X stays zero
+    bool isEmpty() const { return ((runs.isEmpty()) || (k2A >= k2B) || (k3A >= k3B)); }
+    ///Index into X of the first channel of column k2, slice k3 of Y
+    bigint xIndex(bigint k2, bigint k3) const { return size1 * ((k2 - i2) + size2 * (k3 - i3)); }
+};
+
+/*
+ * Read the sub-block into Xptr (size1 x size2 x size3, already zeroed) through read_entries(T* buf, bigint i, bigint n),
+ * which reads n entries of the vectorized Y starting at i and returns the number read.
+ * Whole stretches of rows are read when the unwanted parts between them are small (or always, if always_coalesce, for
+ * sources that are decoded by block), otherwise just the needed span of each row.
+ */
+template <typename T, typename ReadEntries>
+bool mda_read_subblock(T* Xptr, const MdaSubblock& S, bigint num_bytes_per_entry, bool always_coalesce, ReadEntries read_entries, const char* reader_name)
+{
+    if (S.isEmpty())
+        return true;
+    bool coalesce = ((always_coalesce) || ((S.N1 - S.span) * num_bytes_per_entry <= SUBBLOCK_MAX_GAP_BYTES));
+    bigint row_stride = coalesce ? S.N1 : S.span;
+    bigint rows_per_read = coalesce ? qMax((bigint)(SUBBLOCK_BUFFER_SIZE / S.N1), (bigint)1) : 1;
+    QVector<T> buffer((rows_per_read - 1) * row_stride + S.span);
+    for (bigint k3 = S.k3A; k3 < S.k3B; k3++) {
+        for (bigint k2 = S.k2A; k2 < S.k2B; k2 += rows_per_read) {
+            bigint num_rows = qMin(rows_per_read, S.k2B - k2);
+            bigint size_to_read = (num_rows - 1) * row_stride + S.span;
+            bigint num_read = read_entries(buffer.data(), S.ch_min + S.N1 * (k2 + S.N2 * k3), size_to_read);
+            if (num_read != size_to_read) {
+                printf("Warning problem reading sub-block in %s: %ld<>%ld\n", reader_name, (long)num_read, (long)size_to_read);
+                return false;
+            }
+            for (bigint j = 0; j < num_rows; j++) {
+                bigint aa = S.xIndex(k2 + j, k3);
+                const T* row = buffer.constData() + j * row_stride - S.ch_min;
+                for (int r = 0; r < S.runs.count(); r++) {
+                    memcpy(&Xptr[aa + S.runs[r].dst], &row[S.runs[r].src], sizeof(T) * S.runs[r].len);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif // MDASUBBLOCK_P_H
@@ -0,0 +1,132 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAVIEW_H
+#define MDAVIEW_H
+
+#include "mdaio.h"
+#include <type_traits>
+
+/**
+ * \class MdaStridedView
+ * @brief A non-owning N1xN2xN3 window into the memory of an Mda or Mda32
+ *
+ * Entry (i1,i2,i3) of the view is data[i1 + stride2*i2 + stride3*i3]. Nothing is copied or reference counted, so a view is
+ * only valid while the array it points into is alive and is not reallocated. Use the Mda32View/Mda32ConstView (and MdaView/MdaConstView)
+ * typedefs, obtained from the getChunk overloads of Mda32 and Mda, e.g.
+ *
+ *   Mda32ConstView template0;
+ *   templates.getChunk(template0, 0, 0, k, M, T, 1); //the kth MxT slice of an MxTxK array, without copying
+ */
+template <typename T>
+class MdaStridedView {
+public:
+    typedef typename std::remove_const<T>::type value_type;
+
+    MdaStridedView() {}
+    ///A view of size N1xN2xN3 starting at data. By default (stride <= 0) the entries are contiguous
+    MdaStridedView(T* data, bigint N1, bigint N2, bigint N3 = 1, bigint stride2 = 0, bigint stride3 = 0)
+        : m_data(data)
+        , m_N1(N1)
+        , m_N2(N2)
+        , m_N3(N3)
+        , m_stride2(stride2 > 0 ? stride2 : N1)
+        , m_stride3(stride3 > 0 ? stride3 : N1 * N2)
+    {
+    }
+    ///A view of the same memory as other, e.g. a const view of a writable one
+    template <typename S>
+    MdaStridedView(const MdaStridedView<S>& other)
+        : m_data(other.dataPtr())
+        , m_N1(other.N1())
+        , m_N2(other.N2())
+        , m_N3(other.N3())
+        , m_stride2(other.stride2())
+        , m_stride3(other.stride3())
+    {
+    }
+
+    bigint N1() const { return m_N1; }
+    bigint N2() const { return m_N2; }
+    bigint N3() const { return m_N3; }
+    bigint totalSize() const { return m_N1 * m_N2 * m_N3; }
+    bigint stride2() const { return m_stride2; }
+    bigint stride3() const { return m_stride3; }
+    bool isEmpty() const { return (!m_data) || (totalSize() == 0); }
+    ///True if the entries are adjacent in memory in vectorized order, so dataPtr() may be used as a plain N1*N2*N3 array
+    bool isContiguous() const
+    {
+        return ((m_N2 <= 1) || (m_stride2 == m_N1)) && ((m_N3 <= 1) || (m_stride3 == m_N1 * m_N2));
+    }
+
+    ///The value of the ith entry in vectorized order (i1 + N1()*i2 + N1()*N2()*i3)
+    value_type get(bigint i) const
+    {
+        if (isContiguous())
+            return m_data[i];
+        return get(i % m_N1, (i / m_N1) % m_N2, i / (m_N1 * m_N2));
+    }
+    value_type get(bigint i1, bigint i2) const { return m_data[i1 + m_stride2 * i2]; }
+    value_type get(bigint i1, bigint i2, bigint i3) const { return m_data[i1 + m_stride2 * i2 + m_stride3 * i3]; }
+    ///Slower version of get(i1,i2), safely returning 0 when either of the indices are out of bounds.
+    value_type value(bigint i1, bigint i2) const { return value(i1, i2, 0); }
+    ///Slower version of get(i1,i2,i3), safely returning 0 when any of the indices are out of bounds.
+    value_type value(bigint i1, bigint i2, bigint i3) const
+    {
+        if ((i1 < 0) || (i1 >= m_N1) || (i2 < 0) || (i2 >= m_N2) || (i3 < 0) || (i3 >= m_N3))
+            return 0;
+        return get(i1, i2, i3);
+    }
+
+    void set(value_type val, bigint i1, bigint i2) { m_data[i1 + m_stride2 * i2] = val; }
+    void set(value_type val, bigint i1, bigint i2, bigint i3) { m_data[i1 + m_stride2 * i2 + m_stride3 * i3] = val; }
+
+    T* dataPtr() const { return m_data; }
+    T* dataPtr(bigint i1, bigint i2) const { return m_data + i1 + m_stride2 * i2; }
+    T* dataPtr(bigint i1, bigint i2, bigint i3) const { return m_data + i1 + m_stride2 * i2 + m_stride3 * i3; }
+
+    ///Copy the viewed entries into ret (an Mda or Mda32), which is allocated to N1xN2xN3
+    template <typename MdaType>
+    void copyTo(MdaType& ret) const
+    {
+        ret.allocate(m_N1, m_N2, m_N3);
+        auto* ptr = ret.dataPtr();
+        for (bigint i3 = 0; i3 < m_N3; i3++) {
+            for (bigint i2 = 0; i2 < m_N2; i2++) {
+                const T* src = dataPtr(0, i2, i3);
+                for (bigint i1 = 0; i1 < m_N1; i1++)
+                    *(ptr++) = src[i1];
+            }
+        }
+    }
+
+private:
+    T* m_data = 0;
+    bigint m_N1 = 0;
+    bigint m_N2 = 0;
+    bigint m_N3 = 0;
+    bigint m_stride2 = 0;
+    bigint m_stride3 = 0;
+};
+
+typedef MdaStridedView<float> Mda32View;
+typedef MdaStridedView<const float> Mda32ConstView;
+typedef MdaStridedView<double> MdaView;
+typedef MdaStridedView<const double> MdaConstView;
+
+///Set ret to the size1xsize2xsize3 block at (i1,i2,i3) of the N1xN2xN3 array at data. Returns false (and an empty view) if the block is not inside the array
+template <typename T>
+bool mda_sub_view(MdaStridedView<T>& ret, T* data, bigint N1, bigint N2, bigint N3, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3)
+{
+    if ((i1 < 0) || (i2 < 0) || (i3 < 0) || (size1 < 0) || (size2 < 0) || (size3 < 0)
+        || (i1 + size1 > N1) || (i2 + size2 > N2) || (i3 + size3 > N3)) {
+        ret = MdaStridedView<T>();
+        return false;
+    }
+    ret = MdaStridedView<T>(data + i1 + N1 * i2 + N1 * N2 * i3, size1, size2, size3, N1, N1 * N2);
+    return true;
+}
+
+#endif // MDAVIEW_H
@@ -0,0 +1,107 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef MDAZIO_H
+#define MDAZIO_H
+
+#include <QString>
+#include <QMutex>
+#include <stdio.h>
+#include <vector>
+#include "mdaio.h"
+
+/*
+ * The .mdaz format is a compressed, randomly accessible variant of .mda.
+ *
+ * The array is split (in vectorized order) into blocks of N1*block_columns entries, e.g. fixed time-blocks of a
+ * timeseries, and each block is compressed independently. Integer data types are delta-coded along the second
+ * index (separately for each row of the first index), zigzag-mapped and bit-packed with the smallest bit width
+ * that fits each row of the block. Blocks that would not get smaller, and all floating point data, are stored raw.
+ *
+ * Layout (little-endian):
+ *   "MDAZ", int32 version, int32 data_type, int32 num_bytes_per_entry, int32 num_dims, int64 dims[num_dims], int64 block_columns
+ *   the blocks, each starting with a uint8 codec (0=raw, 1=delta/bit-packed)
+ *   int64 offsets[num_blocks+1] (file offset of each block, the last one being the start of this index)
+ *   int64 num_blocks, "MDAZ"
+ */
+
+#define MDAZ_DEFAULT_BLOCK_COLUMNS 16384
+
+///Returns true if path has the .mdaz extension
+bool mdaz_is_mdaz_path(const QString& path);
+
+/**
+ * \class MdazWriter
+ * @brief Sequential writer of .mdaz data to an already open file (see DiskWriteMda and mdaconvert)
+ */
+class MdazWriter {
+public:
+    MdazWriter();
+    virtual ~MdazWriter();
+
+    ///Write the .mdaz header for H (num_bytes_per_entry is filled in) at the current position of F
+    bool begin(FILE* F, struct MDAIO_HEADER* H, bigint block_columns = MDAZ_DEFAULT_BLOCK_COLUMNS);
+    ///Append n entries, converted to the data type of the header
+    bool writeFloat32(const float* data, bigint n);
+    bool writeFloat64(const double* data, bigint n);
+    bigint numEntriesWritten() const;
+    ///Pad the remainder of the array with zeros and write the block index. Does not close F
+    bool finish();
+
+private:
+    FILE* m_file = 0;
+    MDAIO_HEADER m_header;
+    bigint m_total_size = 0;
+    bigint m_block_size = 0; //entries
+    bigint m_num_written = 0;
+    std::vector<unsigned char> m_block; //raw entries of the block being filled
+    bigint m_block_count = 0; //entries in m_block
+    std::vector<int64_t> m_offsets;
+
+    bool flush_block();
+
+    MdazWriter(const MdazWriter&) = delete;
+    void operator=(const MdazWriter&) = delete;
+};
+
+/**
+ * \class MdazReader
+ * @brief Random-access reader of .mdaz files. Reads may be issued from several threads at once
+ */
+class MdazReader {
+public:
+    MdazReader();
+    virtual ~MdazReader();
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+    ///The header of the array (header_size is 0 since the data is not stored contiguously)
+    MDAIO_HEADER header() const;
+
+    ///Read n entries starting at vectorized index i, zero outside the array. Returns the number of entries read (n on success)
+    bigint readFloat32(float* data, bigint i, bigint n);
+    bigint readFloat64(double* data, bigint i, bigint n);
+
+private:
+    int m_fd = -1;
+    MDAIO_HEADER m_header;
+    bigint m_total_size = 0;
+    bigint m_block_size = 0; //entries
+    std::vector<int64_t> m_offsets;
+
+    QMutex m_cache_mutex;
+    bigint m_cached_block_index = -1;
+    std::vector<unsigned char> m_cached_block; //raw entries of the most recently decoded block
+
+    bool decode_block(bigint block_index, std::vector<unsigned char>& raw);
+    template <typename T>
+    bigint read_entries(T* data, bigint i, bigint n);
+
+    MdazReader(const MdazReader&) = delete;
+    void operator=(const MdazReader&) = delete;
+};
+
+#endif // MDAZIO_H
@@ -11,9 +11,17 @@
 #include "mda.h"
 #include "mda32.h"
 
+#define REMOTE_READ_MDA_MAX_PARALLEL_DOWNLOADS 4
+#define REMOTE_READ_MDA_READ_AHEAD_CHUNKS 2
+
 class RemoteReadMdaPrivate;
 /**
  * @brief Do not use this class directly -- it is used by DiskReadMda
+ *
+ * The remote array is downloaded in chunks of downloadChunkSize() entries. The chunks needed by a read are fetched
+ * concurrently (up to REMOTE_READ_MDA_MAX_PARALLEL_DOWNLOADS at a time), and the chunks following them are fetched in
+ * the background (see setReadAheadChunks). Chunks are cached in the long-term cache under the checksum of the remote
+ * file, so a chunk is downloaded only once, even across processes.
  */
 class RemoteReadMda {
 public:
@@ -24,22 +32,25 @@ public:
     virtual ~RemoteReadMda();
 
     void setRemoteDataType(QString dtype);
-    void setDownloadChunkSize(int size);
-    int downloadChunkSize();
+    void setDownloadChunkSize(bigint size);
+    bigint downloadChunkSize();
+    ///Number of chunks past the end of each read to download in the background
+    void setReadAheadChunks(int num);
+    int readAheadChunks() const;
 
     void setPath(const QString& path);
     QString makePath() const; //not capturing the reshaping
 
-    bool reshape(int N1b, int N2b, int N3b);
+    bool reshape(bigint N1b, bigint N2b, bigint N3b);
 
-    int N1() const;
-    int N2() const;
-    int N3() const;
+    bigint N1() const;
+    bigint N2() const;
+    bigint N3() const;
     QDateTime fileLastModified() const;
 
     ///Retrieve a chunk of the vectorized data of size 1xN starting at position i
-    bool readChunk(Mda& X, int i, int size) const;
-    bool readChunk32(Mda32& X, int i, int size) const;
+    bool readChunk(Mda& X, bigint i, bigint size) const;
+    bool readChunk32(Mda32& X, bigint i, bigint size) const;
 
 private:
     RemoteReadMdaPrivate* d;
@@ -36,6 +36,13 @@ QString computeSha1SumOfFile(const QString& path);
 QString computeSha1SumOfFileHead(const QString& path, bigint num_bytes);
 QString computeSha1SumOfString(const QString& str);
 QString computeSha1SumOfDirectory(const QString& path);
+///The parallel tree checksum of a file, labeled as such: "sha1tree-<hex>" (see sumit.h)
+QString computeTreeChecksumOfFile(const QString& path);
+///Whether the file has the given checksum, which is either a plain sha1 or a labeled checksum such as "sha1tree-<hex>"
+bool matchesChecksum(QString path, QString checksum);
+///The checksum to check a local copy of the file of a prv object against: its tree checksum (original_checksum_sha1tree) if it
+///has one, which is faster to compute for a large file, otherwise its sha1 (original_checksum). Servers are only ever sent the sha1
+QString prvLocalChecksum(const QJsonObject& prv_object);
 bool matchesFastChecksum(QString path, QString fcs);
 QList<int> stringListToIntList(const QStringList& list);
 QList<bigint> stringListToBigIntList(const QStringList& list);
@@ -55,8 +62,10 @@ QJsonValue configValue(const QString& group, const QString& key);
 QString configResolvedPath(const QString& group, const QString& key);
 QStringList configResolvedPathList(const QString& group, const QString& key);
 QStringList toStringList(const QVariant& val); //val is either a string or a QVariantList
-QJsonObject createPrvObject(const QString& file_or_dir_path);
+QJsonObject createPrvObject(const QString& file_or_dir_path, bool tree_checksum = false);
 QString locatePrv(const QJsonObject& obj, const QStringList& local_search_paths);
+///Stat-only refresh of the persistent index of local files used by locatePrv (see prvindex.h)
+void rescanPrvIndex(const QStringList& search_paths);
 };
 
 namespace MLCompute {
@@ -1,6 +1,9 @@
 #include "icounter.h"
 #include <QHash>
+#include <QTimer>
 #include <objectregistry.h>
+#include <new>
+#include <stdlib.h>
 
 /*!
  * \class ICounterBase
@@ -17,6 +20,13 @@ QString ICounterBase::label() const
     return genericValue().toString();
 }
 
+/*!
+ * \brief ICounterBase::publish
+ */
+void ICounterBase::publish()
+{
+}
+
 /*!
  * \brief IAggregateCounter::add
  * \return
@@ -158,6 +168,28 @@ QStringList CounterManager::availableGroups() const
     return m_groupNames;
 }
 
+void CounterManager::publishCounters()
+{
+    QReadLocker locker(&m_countersLock);
+    QList<ICounterBase*> counters = m_counters.values();
+    locker.unlock();
+    foreach (ICounterBase* counter, counters) {
+        counter->publish();
+    }
+}
+
+void CounterManager::setPublishInterval(int msec)
+{
+    if (!m_publishTimer) {
+        m_publishTimer = new QTimer(this);
+        connect(m_publishTimer, &QTimer::timeout, this, &CounterManager::publishCounters);
+    }
+    if (msec > 0)
+        m_publishTimer->start(msec);
+    else
+        m_publishTimer->stop();
+}
+
 /*!
  * \brief ICounterBase::ICounterBase
  * \param name
@@ -267,3 +299,179 @@ void CounterProxy::updateValue()
 {
     emit valueChanged();
 }
+
+void* ICounterSlotAllocation::operator new[](size_t size)
+{
+    void* ptr = 0;
+    if (posix_memalign(&ptr, ICOUNTER_CACHE_LINE_BYTES, size) != 0)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void ICounterSlotAllocation::operator delete[](void* ptr)
+{
+    free(ptr);
+}
+
+/*!
+ * \class IThreadCounter
+ * \brief A 64-bit counter that is cheap to increment from many threads
+ */
+IThreadCounter::IThreadCounter(const QString& name, QObject* parent)
+    : ICounterBase(name, parent)
+    , m_slots(new Slot[ICOUNTER_NUM_SLOTS])
+{
+}
+
+IThreadCounter::~IThreadCounter()
+{
+    delete[] m_slots;
+}
+
+/*!
+ * \brief IThreadCounter::threadSlot
+ * \return the slot used by the calling thread. Threads are numbered in the order
+ * they first count something, so up to ICOUNTER_NUM_SLOTS threads never share a slot.
+ */
+int IThreadCounter::threadSlot()
+{
+    static std::atomic<int> num_threads(0);
+    static thread_local int slot = (num_threads++) % ICOUNTER_NUM_SLOTS;
+    return slot;
+}
+
+QVariant IThreadCounter::add(const QVariant& inc)
+{
+    add(inc.value<int64_t>());
+    return genericValue();
+}
+
+int64_t IThreadCounter::value() const
+{
+    int64_t ret = 0;
+    for (int i = 0; i < ICOUNTER_NUM_SLOTS; i++)
+        ret += m_slots[i].value.load(std::memory_order_relaxed);
+    return ret;
+}
+
+QVariant IThreadCounter::genericValue() const
+{
+    return QVariant::fromValue<int64_t>(value());
+}
+
+void IThreadCounter::publish()
+{
+    int64_t val = value();
+    if (m_published.exchange(val) != val)
+        emit valueChanged();
+}
+
+/*!
+ * \class ILatencyCounter
+ * \brief A histogram of latencies that is cheap to record from many threads
+ */
+ILatencyCounter::ILatencyCounter(const QString& name, QObject* parent)
+    : ICounterBase(name, parent)
+    , m_slots(new Slot[ICOUNTER_NUM_SLOTS])
+{
+    for (int i = 0; i < ICOUNTER_NUM_SLOTS; i++) {
+        for (int b = 0; b < ILATENCY_NUM_BUCKETS; b++)
+            m_slots[i].buckets[b] = 0;
+        m_slots[i].total_nanoseconds = 0;
+    }
+}
+
+ILatencyCounter::~ILatencyCounter()
+{
+    delete[] m_slots;
+}
+
+QVariant ILatencyCounter::add(const QVariant& nanoseconds)
+{
+    record(nanoseconds.value<int64_t>());
+    return genericValue();
+}
+
+void ILatencyCounter::record(int64_t nanoseconds)
+{
+    int b = 0;
+    for (int64_t us = nanoseconds / 1000; (us > 0) && (b < ILATENCY_NUM_BUCKETS - 1); us >>= 1)
+        b++;
+    Slot& S = m_slots[IThreadCounter::threadSlot()];
+    S.buckets[b].fetch_add(1, std::memory_order_relaxed);
+    S.total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+int64_t ILatencyCounter::count() const
+{
+    int64_t ret = 0;
+    foreach (int64_t num, histogram())
+        ret += num;
+    return ret;
+}
+
+int64_t ILatencyCounter::totalNanoseconds() const
+{
+    int64_t ret = 0;
+    for (int i = 0; i < ICOUNTER_NUM_SLOTS; i++)
+        ret += m_slots[i].total_nanoseconds.load(std::memory_order_relaxed);
+    return ret;
+}
+
+QVector<int64_t> ILatencyCounter::histogram() const
+{
+    QVector<int64_t> ret(ILATENCY_NUM_BUCKETS, 0);
+    for (int i = 0; i < ICOUNTER_NUM_SLOTS; i++) {
+        for (int b = 0; b < ILATENCY_NUM_BUCKETS; b++)
+            ret[b] += m_slots[i].buckets[b].load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+int64_t ILatencyCounter::bucketLimit(int b)
+{
+    return ((int64_t)1) << b;
+}
+
+int64_t ILatencyCounter::percentile(double p) const
+{
+    QVector<int64_t> H = histogram();
+    int64_t total = 0;
+    foreach (int64_t num, H)
+        total += num;
+    if (!total)
+        return 0;
+    int64_t cumulative = 0;
+    for (int b = 0; b < ILATENCY_NUM_BUCKETS; b++) {
+        cumulative += H[b];
+        if (cumulative >= p * total)
+            return bucketLimit(b);
+    }
+    return bucketLimit(ILATENCY_NUM_BUCKETS - 1);
+}
+
+QVariant ILatencyCounter::genericValue() const
+{
+    QVariantMap ret;
+    int64_t num = count();
+    ret["count"] = (qlonglong)num;
+    ret["mean_us"] = num ? totalNanoseconds() / 1000.0 / num : 0.0;
+    ret["p50_us"] = (qlonglong)percentile(0.5);
+    ret["p99_us"] = (qlonglong)percentile(0.99);
+    return ret;
+}
+
+QString ILatencyCounter::label() const
+{
+    int64_t num = count();
+    if (!num)
+        return "none";
+    return QString("%1 calls, mean %2 us, p50 < %3 us, p99 < %4 us").arg(num).arg(totalNanoseconds() / 1000.0 / num, 0, 'f', 1).arg(percentile(0.5)).arg(percentile(0.99));
+}
+
+void ILatencyCounter::publish()
+{
+    int64_t num = count();
+    if (m_published.exchange(num) != num)
+        emit valueChanged();
+}
@@ -0,0 +1,363 @@
+#include "diskreadmda16.h"
+#include "mdastream.h"
+#include "mdaioprofile.h"
+#include "mdasubblock_p.h"
+
+#include <QDebug>
+#include <icounter.h>
+#include <objectregistry.h>
+#include <QMutex>
+#include <QCache>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_VALUE_CACHE_BLOCKS 8
+#define DEFAULT_CHUNK_SIZE 1e6
+
+bool mda_is_int16(const QStringList& paths)
+{
+    if (paths.isEmpty())
+        return false;
+    foreach (QString path, paths) {
+        if ((path.endsWith(".mdaz")) || (mda_is_stream_path(path)))
+            return false;
+        FILE* F = fopen(path.toUtf8().data(), "rb");
+        if (!F)
+            return false;
+        MDAIO_HEADER H;
+        bool ok = (mda_read_header(&H, F) != 0) && (H.data_type == MDAIO_TYPE_INT16);
+        fclose(F);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+struct DiskReadMda16Part {
+    QString path;
+    MDAIO_HEADER header;
+    bigint offset = 0; //vectorized index of the first entry in the concatenation
+    bigint size = 0;
+    int fd = -1;
+};
+
+class DiskReadMda16Private {
+public:
+    DiskReadMda16* q;
+    QStringList m_paths;
+    bigint m_dims[MDAIO_MAX_DIMS];
+    bool m_header_read = false;
+    bool m_failed = false;
+    QList<DiskReadMda16Part> m_parts;
+    QMutex m_mutex;
+    IThreadCounter* bytesReadCounter = nullptr;
+    ILatencyCounter* readLatencyCounter = nullptr;
+    QCache<bigint, Mda16> m_value_cache{ (int)(DEFAULT_VALUE_CACHE_BLOCKS * DEFAULT_CHUNK_SIZE * sizeof(dtype16) / 1024) }; //blocks of DEFAULT_CHUNK_SIZE entries used by value(), cost is in kilobytes
+    QMutex m_value_mutex; //guards m_value_cache, never held together with m_mutex
+
+    void clear();
+    bool read_header_if_needed();
+    bigint total_size();
+    bool read_entries(dtype16* data, bigint i, bigint n);
+    bool read_subblock(dtype16* data, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3);
+
+    static QList<int> channel_range(bigint i1, bigint size1);
+};
+
+DiskReadMda16::DiskReadMda16(const QString& path)
+{
+    d = new DiskReadMda16Private;
+    d->q = this;
+    d->clear();
+    if (!path.isEmpty())
+        this->setPath(path);
+}
+
+DiskReadMda16::DiskReadMda16(int concat_dimension, const QStringList& array_paths)
+{
+    d = new DiskReadMda16Private;
+    d->q = this;
+    d->clear();
+    this->setConcatPaths(concat_dimension, array_paths);
+}
+
+DiskReadMda16::DiskReadMda16(const DiskReadMda16& other)
+{
+    d = new DiskReadMda16Private;
+    d->q = this;
+    d->clear();
+    d->m_paths = other.d->m_paths;
+}
+
+DiskReadMda16::~DiskReadMda16()
+{
+    d->clear();
+    delete d;
+}
+
+void DiskReadMda16::operator=(const DiskReadMda16& other)
+{
+    if (&other == this)
+        return;
+    d->clear();
+    d->m_paths = other.d->m_paths;
+}
+
+void DiskReadMda16::setPath(const QString& file_path)
+{
+    d->clear();
+    d->m_paths = QStringList(file_path);
+}
+
+void DiskReadMda16::setConcatPaths(int concat_dimension, const QStringList& paths)
+{
+    d->clear();
+    if ((concat_dimension != 2) && (paths.count() > 1)) {
+        qWarning() << "DiskReadMda16 only supports concatenation along dimension 2:" << concat_dimension;
+        d->m_failed = true;
+        return;
+    }
+    d->m_paths = paths;
+}
+
+bigint DiskReadMda16::N1() const
+{
+    return N(1);
+}
+
+bigint DiskReadMda16::N2() const
+{
+    return N(2);
+}
+
+bigint DiskReadMda16::N3() const
+{
+    return N(3);
+}
+
+bigint DiskReadMda16::N(int dim) const
+{
+    if ((dim < 1) || (dim > MDAIO_MAX_DIMS))
+        return 1;
+    if (!d->read_header_if_needed())
+        return 0;
+    return d->m_dims[dim - 1];
+}
+
+bigint DiskReadMda16::totalSize() const
+{
+    if (!d->read_header_if_needed())
+        return 0;
+    return d->total_size();
+}
+
+bool DiskReadMda16::readChunk(Mda16& X, bigint i, bigint size) const
+{
+    if (!d->read_header_if_needed())
+        return false;
+    X.allocate(1, size);
+    bigint a = qMax(i, (bigint)0);
+    bigint b = qMin(i + size, d->total_size());
+    if (a >= b)
+        return true;
+    return d->read_entries(X.dataPtr() + (a - i), a, b - a);
+}
+
+bool DiskReadMda16::readChunk(Mda16& X, bigint i1, bigint i2, bigint size1, bigint size2) const
+{
+    if (!d->read_header_if_needed())
+        return false;
+    X.allocate(size1, size2);
+    return d->read_subblock(X.dataPtr(), DiskReadMda16Private::channel_range(i1, size1), i2, 0, size2, 1);
+}
+
+bool DiskReadMda16::readChunk(Mda16& X, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const
+{
+    if (!d->read_header_if_needed())
+        return false;
+    X.allocate(size1, size2, size3);
+    return d->read_subblock(X.dataPtr(), DiskReadMda16Private::channel_range(i1, size1), i2, i3, size2, size3);
+}
+
+bool DiskReadMda16::readChunk(Mda16& X, const QList<int>& channels, bigint i2, bigint size2) const
+{
+    if (!d->read_header_if_needed())
+        return false;
+    X.allocate(channels.count(), size2);
+    return d->read_subblock(X.dataPtr(), channels, i2, 0, size2, 1);
+}
+
+dtype16 DiskReadMda16::value(bigint i) const
+{
+    if (!d->read_header_if_needed())
+        return 0;
+    if ((i < 0) || (i >= d->total_size()))
+        return 0;
+    bigint chunk_index = i / DEFAULT_CHUNK_SIZE;
+    bigint offset = i - DEFAULT_CHUNK_SIZE * chunk_index;
+    QMutexLocker locker(&d->m_value_mutex);
+    Mda16* block = d->m_value_cache.object(chunk_index);
+    if (!block) {
+        bigint size_to_read = qMin((bigint)DEFAULT_CHUNK_SIZE, d->total_size() - chunk_index * (bigint)DEFAULT_CHUNK_SIZE);
+        block = new Mda16;
+        if (!readChunk(*block, chunk_index * DEFAULT_CHUNK_SIZE, size_to_read)) {
+            delete block;
+            return 0;
+        }
+        int cost = qMax((int)(size_to_read * sizeof(dtype16) / 1024), 1);
+        d->m_value_cache.insert(chunk_index, block, cost);
+    }
+    return block->get(offset);
+}
+
+dtype16 DiskReadMda16::value(bigint i1, bigint i2) const
+{
+    if ((i1 < 0) || (i1 >= N1()))
+        return 0;
+    return value(i1 + N1() * i2);
+}
+
+void DiskReadMda16Private::clear()
+{
+    {
+        QMutexLocker locker(&m_value_mutex);
+        m_value_cache.clear();
+    }
+    QMutexLocker locker(&m_mutex);
+    for (int j = 0; j < m_parts.count(); j++) {
+        if (m_parts[j].fd >= 0)
+            ::close(m_parts[j].fd);
+    }
+    m_parts.clear();
+    m_paths.clear();
+    for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+        m_dims[i] = 1;
+    m_header_read = false;
+    m_failed = false;
+}
+
+bool DiskReadMda16Private::read_header_if_needed()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_header_read)
+        return true;
+    if ((m_failed) || (m_paths.isEmpty()))
+        return false;
+    m_failed = true; //until we succeed
+    ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
+    if (manager) {
+        bytesReadCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_read"));
+        readLatencyCounter = qobject_cast<ILatencyCounter*>(manager->counter("read_latency"));
+    }
+    bigint offset = 0;
+    for (int j = 0; j < m_paths.count(); j++) {
+        DiskReadMda16Part part;
+        part.path = m_paths[j];
+        FILE* F = fopen(part.path.toUtf8().data(), "rb");
+        if (!F) {
+            qWarning() << "Unable to open file for reading:" << part.path;
+            break;
+        }
+        bool ok = (mda_read_header(&part.header, F) != 0);
+        fclose(F);
+        if (!ok) {
+            qWarning() << "Problem reading mda header:" << part.path;
+            break;
+        }
+        part.size = 1;
+        for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+            part.size *= part.header.dims[i];
+        if (m_paths.count() > 1) {
+            if ((part.header.num_dims > 2) || ((j > 0) && ((bigint)part.header.dims[0] != m_dims[0]))) {
+                qWarning() << "Arrays concatenated along dimension 2 must be 2D with the same N1:" << part.path;
+                break;
+            }
+        }
+        part.fd = open(part.path.toUtf8().data(), O_RDONLY);
+        if (part.fd < 0) {
+            qWarning() << "Unable to open file for reading:" << part.path;
+            break;
+        }
+        part.offset = offset;
+        offset += part.size;
+        if (j == 0) {
+            for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+                m_dims[i] = part.header.dims[i];
+        }
+        else {
+            m_dims[1] += part.header.dims[1];
+        }
+        m_parts << part;
+    }
+    if (m_parts.count() < m_paths.count()) {
+        for (int j = 0; j < m_parts.count(); j++)
+            ::close(m_parts[j].fd);
+        m_parts.clear();
+        return false;
+    }
+    m_failed = false;
+    m_header_read = true;
+    return true;
+}
+
+bigint DiskReadMda16Private::total_size()
+{
+    bigint ret = 1;
+    for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+        ret *= m_dims[i];
+    return ret;
+}
+
+bool DiskReadMda16Private::read_entries(dtype16* data, bigint i, bigint n)
+{
+    //the vectorized data of a concatenation along the last non-singleton dimension is the concatenation of the vectorized data
+    for (int j = 0; j < m_parts.count(); j++) {
+        const DiskReadMda16Part& P = m_parts[j];
+        bigint a = qMax(i, P.offset);
+        bigint b = qMin(i + n, P.offset + P.size);
+        if (a >= b)
+            continue;
+        bigint file_offset = P.header.header_size + P.header.num_bytes_per_entry * (a - P.offset);
+        bigint num_read;
+        {
+            ILatencyTimer timer(readLatencyCounter);
+            MdaIOProfileScope profile(MdaIOProfile::Read, P.path, file_offset);
+            num_read = mda_pread_int16(data + (a - i), &P.header, b - a, P.fd, file_offset);
+            profile.setNumBytes(num_read * P.header.num_bytes_per_entry);
+        }
+        if (num_read != b - a) {
+            qWarning() << "Problem reading from" << P.path;
+            return false;
+        }
+        if (bytesReadCounter)
+            bytesReadCounter->add(num_read * P.header.num_bytes_per_entry);
+    }
+    return true;
+}
+
+bool DiskReadMda16Private::read_subblock(dtype16* data, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3)
+{
+    //data is channels.count() x size2 x size3, already zeroed
+    MdaSubblock S(channels, i2, i3, size2, size3, m_dims[0], m_dims[1], m_dims[2]);
+    if (S.isEmpty())
+        return true;
+    if ((S.size1 == S.N1) && (S.runs.count() == 1) && (S.runs[0].src == 0) && (S.runs[0].dst == 0) && (S.runs[0].len == S.N1)) {
+        //whole columns are read straight into data
+        for (bigint k3 = S.k3A; k3 < S.k3B; k3++) {
+            if (!read_entries(data + S.xIndex(S.k2A, k3), S.N1 * (S.k2A + S.N2 * k3), S.N1 * (S.k2B - S.k2A)))
+                return false;
+        }
+        return true;
+    }
+    return mda_read_subblock(data, S, m_parts[0].header.num_bytes_per_entry, false, [this](dtype16* buf, bigint i, bigint n) { return read_entries(buf, i, n) ? n : (bigint)0; }, "DiskReadMda16");
+}
+
+QList<int> DiskReadMda16Private::channel_range(bigint i1, bigint size1)
+{
+    QList<int> ret;
+    for (bigint i = i1; i < i1 + size1; i++)
+        ret << i;
+    return ret;
+}
@@ -1,5 +1,7 @@
 #include "diskreadmda32.h"
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include "mdaio.h"
 #include <math.h>
 #include <QFile>
@@ -12,9 +14,29 @@
 #include <QJsonArray>
 #include <icounter.h>
 #include <objectregistry.h>
+#include "mdammap.h"
+#include "mdaioprofile.h"
+#include "mdasubblock_p.h"
+#include "mdazio.h"
+#include "mdastream.h"
+#include "diskwritemda.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QCache>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <algorithm>
+#include <unistd.h>
 
 #define MAX_PATH_LEN 10000
+#define CONCAT_PARALLEL_MIN_ENTRIES 4e6 //smaller reads of a concatenation are done one member at a time
+#define DEFAULT_VALUE_CACHE_BLOCKS 8
 #define DEFAULT_CHUNK_SIZE 1e6
+#define TRANSPOSED_BLOCK_COLUMNS 32768 //timepoints per block of the channel-major sidecar
+#define TRANSPOSED_MAX_CHANNEL_FRACTION 4 //the sidecar serves reads of at most N1/4 channels
 
 /// TODO (LOW) make tmp directory with different name on server, so we can really test if it is doing the computation in the right place
 
@@ -23,7 +45,7 @@ public:
     DiskReadMda32* q;
     FILE* m_file;
     bool m_file_open_failed;
-    bool m_header_read;
+    QAtomicInt m_header_read; //checked without holding m_file_mutex
     MDAIO_HEADER m_header;
     bool m_reshaped;
     bigint m_mda_header_total_size;
@@ -34,18 +56,52 @@ public:
     bool m_use_concat = false;
     int m_concat_dimension = 2;
     QList<DiskReadMda32> m_concat_list;
+    QVector<bigint> m_concat_start_points; //where each member of the concat list starts, plus the total, computed with the header: the first row for concat_dimension 1, otherwise the first entry of the vectorized array
+    bool m_use_mmap = false;
+    bool m_mmap_failed = false;
+    QSharedPointer<MdaMemoryMap> m_mmap;
+    bool m_use_direct = false;
+    int m_direct_fd = -1; //opened along with m_file when m_use_direct is set, -1 if direct I/O is unavailable
+    QAtomicInt m_direct_refused; //set when the filesystem refuses direct I/O; m_direct_fd stays open (other threads may be using it) until close_file
+    QSharedPointer<MdazReader> m_mdaz; //used in place of m_file for .mdaz files
+    QSharedPointer<MdaStreamReader> m_stream; //used in place of m_file for pipes and FIFOs, shared by copies since a stream can only be opened once
+    bool m_use_transposed = false;
+    bool m_transposed_failed = false;
+    QSharedPointer<DiskReadMda32> m_transposed; //the channel-major sidecar, see setUseTransposedCache()
+    QCache<bigint, Mda32> m_value_cache{ (int)(DEFAULT_VALUE_CACHE_BLOCKS * DEFAULT_CHUNK_SIZE * sizeof(dtype32) / 1024) }; //blocks of DEFAULT_CHUNK_SIZE entries used by value(), cost is in kilobytes
+    bigint m_value_cache_hits = 0;
+    bigint m_value_cache_misses = 0;
+    QMutex m_file_mutex{ QMutex::Recursive }; //guards lazy opening of the file, header and mapping
 
     QString m_path;
     QJsonObject m_prv_object;
 
-    IIntCounter* allocatedCounter = nullptr;
-    IIntCounter* freedCounter = nullptr;
-    IIntCounter* bytesReadCounter = nullptr;
-    IIntCounter* bytesWrittenCounter = nullptr;
+    IThreadCounter* allocatedCounter = nullptr;
+    IThreadCounter* freedCounter = nullptr;
+    IThreadCounter* bytesReadCounter = nullptr;
+    IThreadCounter* bytesWrittenCounter = nullptr;
+    ILatencyCounter* readLatencyCounter = nullptr;
 
     void construct_and_clear();
+    void close_file();
+    void close_direct_fd();
     bool read_header_if_needed();
     bool open_file_if_needed();
+    bool map_file_if_needed();
+    bool read_mapped(Mda32& X, bigint i, bigint size, bigint size1, bigint size2, bigint size3);
+    bigint read_entries(dtype32* data, bigint i, bigint n);
+    bigint read_entries_uncounted(dtype32* data, bigint i, bigint n);
+    void set_value_cache_size(bigint num_bytes);
+    bool read_subblock(Mda32& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3);
+    QString transposed_path();
+    bool build_transposed(const QString& fname);
+    bool open_transposed_if_needed();
+    bool read_transposed(Mda32& X, const QList<int>& channels, bigint k2A, bigint k2B, bigint i2);
+    static QList<int> channel_range(bigint i1, bigint size1);
+    static void gather_channels(Mda32& X, const Mda32& Y, const QList<int>& channels);
+    bool read_concat_chunk(Mda32& chunk, bigint i0, bigint size0);
+    bool read_concat_chunk_rows(Mda32& chunk, bigint i0, bigint size0);
+    bool read_concat_subblock(Mda32& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3);
     void copy_from(const DiskReadMda32& other);
     bigint total_size();
     static QStringList find_all_mda_files_in_directory(QString dir_path, bool recursive);
@@ -57,10 +113,11 @@ DiskReadMda32::DiskReadMda32(const QString& path)
     d->q = this;
     ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
     if (manager) {
-        d->allocatedCounter = static_cast<IIntCounter*>(manager->counter("allocated_bytes"));
-        d->freedCounter = static_cast<IIntCounter*>(manager->counter("freed_bytes"));
-        d->bytesReadCounter = static_cast<IIntCounter*>(manager->counter("bytes_read"));
-        d->bytesWrittenCounter = static_cast<IIntCounter*>(manager->counter("bytes_written"));
+        d->allocatedCounter = qobject_cast<IThreadCounter*>(manager->counter("allocated_bytes"));
+        d->freedCounter = qobject_cast<IThreadCounter*>(manager->counter("freed_bytes"));
+        d->bytesReadCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_read"));
+        d->bytesWrittenCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_written"));
+        d->readLatencyCounter = qobject_cast<ILatencyCounter*>(manager->counter("read_latency"));
     }
     d->construct_and_clear();
     if (!path.isEmpty()) {
@@ -128,8 +185,8 @@ DiskReadMda32::DiskReadMda32(int concat_dimension, const QList<DiskReadMda32>& a
     d->q = this;
     d->construct_and_clear();
 
-    if (concat_dimension != 2) {
-        qCritical() << "For now concat_dimension must be 2!";
+    if ((concat_dimension < 1) || (concat_dimension > 3)) {
+        qCritical() << "concat_dimension must be 1, 2 or 3" << concat_dimension;
         return;
     }
 
@@ -153,8 +210,8 @@ DiskReadMda32::DiskReadMda32(int concat_dimension, const QStringList& array_path
         arrays << DiskReadMda32(path);
     }
 
-    if (concat_dimension != 2) {
-        qCritical() << "For now concat_dimension must be 2!";
+    if ((concat_dimension < 1) || (concat_dimension > 3)) {
+        qCritical() << "concat_dimension must be 1, 2 or 3" << concat_dimension;
         return;
     }
 
@@ -165,9 +222,7 @@ DiskReadMda32::DiskReadMda32(int concat_dimension, const QStringList& array_path
 
 DiskReadMda32::~DiskReadMda32()
 {
-    if (d->m_file) {
-        fclose(d->m_file);
-    }
+    d->close_file();
     delete d;
 }
 
@@ -178,10 +233,7 @@ void DiskReadMda32::operator=(const DiskReadMda32& other)
 
 void DiskReadMda32::setPath(const QString& file_path)
 {
-    if (d->m_file) {
-        fclose(d->m_file);
-        d->m_file = 0;
-    }
+    d->close_file();
     d->construct_and_clear();
 
     if ((file_path.endsWith(".txt")) || (file_path.endsWith(".csv"))) {
@@ -237,8 +289,8 @@ void DiskReadMda32::setPrvObject(const QJsonObject& prv_object)
 
 void DiskReadMda32::setConcatPaths(int concat_dimension, const QStringList& paths)
 {
-    if (concat_dimension != 2) {
-        qWarning() << "For now, the concat_dimension must be 2";
+    if ((concat_dimension < 1) || (concat_dimension > 3)) {
+        qWarning() << "The concat_dimension must be 1, 2 or 3" << concat_dimension;
         return;
     }
     d->m_use_concat = true;
@@ -256,6 +308,83 @@ void DiskReadMda32::setConcatDirectory(int concat_dimension, const QString& dir_
     d->m_path = dir_path;
 }
 
+void DiskReadMda32::setMemoryMapped(bool val)
+{
+    d->m_use_mmap = val;
+    if (!val)
+        d->m_mmap.clear();
+    for (int i = 0; i < d->m_concat_list.count(); i++) {
+        d->m_concat_list[i].setMemoryMapped(val);
+    }
+}
+
+bool DiskReadMda32::isMemoryMapped() const
+{
+    return d->m_use_mmap;
+}
+
+bool DiskReadMda32::isStream() const
+{
+    if (d->m_use_concat) {
+        for (int i = 0; i < d->m_concat_list.count(); i++) {
+            if (d->m_concat_list[i].isStream())
+                return true;
+        }
+        return false;
+    }
+    d->open_file_if_needed();
+    return (!d->m_stream.isNull());
+}
+
+void DiskReadMda32::setDirectIO(bool val)
+{
+    QMutexLocker locker(&d->m_file_mutex);
+    d->m_use_direct = val;
+    //when switching off, the descriptor is kept until close_file, since other threads may be reading through it
+    if ((val) && (d->m_file) && (d->m_direct_fd < 0))
+        d->m_direct_fd = mda_open_direct(d->m_path.toLatin1().data(), false);
+    for (int i = 0; i < d->m_concat_list.count(); i++) {
+        d->m_concat_list[i].setDirectIO(val);
+    }
+}
+
+bool DiskReadMda32::isDirectIO() const
+{
+    return d->m_use_direct;
+}
+
+void DiskReadMda32::setUseTransposedCache(bool val)
+{
+    d->m_use_transposed = val;
+    if (!val)
+        d->m_transposed.clear();
+}
+
+bool DiskReadMda32::usesTransposedCache() const
+{
+    return d->m_use_transposed;
+}
+
+void DiskReadMda32::setValueCacheSize(bigint num_bytes)
+{
+    d->set_value_cache_size(num_bytes);
+}
+
+bigint DiskReadMda32::valueCacheSize() const
+{
+    return (bigint)d->m_value_cache.maxCost() * 1024;
+}
+
+bigint DiskReadMda32::valueCacheHits() const
+{
+    return d->m_value_cache_hits;
+}
+
+bigint DiskReadMda32::valueCacheMisses() const
+{
+    return d->m_value_cache_misses;
+}
+
 QString compute_memory_checksum32(bigint nbytes, void* ptr)
 {
     QByteArray X((char*)ptr, nbytes);
@@ -470,77 +599,212 @@ DiskReadMda32 DiskReadMda32::reshaped(bigint N1b, bigint N2b, bigint N3b, bigint
     return ret;
 }
 
-bool read_chunk_from_concat_list(Mda32& chunk, const QList<DiskReadMda32>& list, bigint i0, bigint size0, int concat_dimension)
+//one member's part of a read of a concatenation
+class DiskReadMda32ConcatRead : public QRunnable {
+public:
+    const DiskReadMda32* X;
+    bigint i, size;
+    Mda32 chunk;
+    bool ok = false;
+    QSemaphore* done = 0; //released when run on the thread pool
+
+    void run()
+    {
+        ok = ((size == 0) || (X->readChunk(chunk, i, size)));
+        if (done)
+            done->release();
+    }
+};
+
+//Runs the member reads, concurrently if there is enough to read. A read only goes to the global thread pool if a thread is
+//free right away, and is otherwise run here, so we never wait on the pool (readChunk may itself be running in it)
+static void run_concat_reads(const QList<DiskReadMda32ConcatRead*>& reads, bigint total_size)
+{
+    bool parallel = (total_size >= CONCAT_PARALLEL_MIN_ENTRIES);
+    QSemaphore done;
+    int num_started = 0;
+    QList<DiskReadMda32ConcatRead*> here;
+    for (int j = 0; j < reads.count(); j++) {
+        DiskReadMda32ConcatRead* R = reads[j];
+        R->setAutoDelete(false);
+        if ((parallel) && (j > 0) && (R->size > 0)) {
+            R->done = &done;
+            if (QThreadPool::globalInstance()->tryStart(R)) {
+                num_started++;
+                continue;
+            }
+            R->done = 0;
+        }
+        here << R;
+    }
+    foreach (DiskReadMda32ConcatRead* R, here) {
+        R->run();
+    }
+    done.acquire(num_started);
+}
+
+bool DiskReadMda32Private::read_concat_chunk(Mda32& chunk, bigint i0, bigint size0)
 {
-    if (list.count() == 0) {
-        qWarning() << "Problem in read_chunk_from concat_list: list is empty";
+    if (!read_header_if_needed())
         return false;
-    }
-    bigint N1 = list[0].N1();
-    if ((concat_dimension != 2) || (i0 % N1 != 0) || (size0 % N1 != 0)) {
-        qWarning() << "For now the concat_dimension must be 2 and the i and size in readChunk must be a multiples of N1";
+    const QList<DiskReadMda32>& list = m_concat_list;
+    const QVector<bigint>& start_points = m_concat_start_points;
+    if ((list.count() == 0) || (start_points.count() != list.count() + 1)) {
+        qWarning() << "Problem in read_chunk_from concat_list: list is empty or invalid";
         return false;
     }
-    bigint pos1 = i0 / N1;
-    bigint pos2 = pos1 + size0 / N1 - 1;
+    if (m_concat_dimension == 1)
+        return read_concat_chunk_rows(chunk, i0, size0);
+    //For concatenation along dimensions 2 and 3 each member is a contiguous range of the vectorized array
+    bigint pos1 = i0;
+    bigint pos2 = i0 + size0; //exclusive
+    chunk.allocate(1, size0);
 
-    QVector<bigint> sizes;
-    for (int j = 0; j < list.count(); j++) {
-        if (list[j].totalSize() % N1 != 0) {
-            qWarning() << "For now the concat_dimension must be 2 and the individual arrays must have total size a multiple of N1." << N1 << list[j].totalSize();
-            return false;
-        }
-        sizes << list[j].totalSize() / N1;
+    //the members overlapping [pos1,pos2), by binary search of the start points
+    bigint ii1 = std::upper_bound(start_points.begin(), start_points.end() - 1, qMax(pos1, (bigint)0)) - start_points.begin() - 1;
+    bigint ii2 = std::lower_bound(start_points.begin(), start_points.end() - 1, pos2) - start_points.begin() - 1; //inclusive
+    ii1 = qMax(ii1, (bigint)0);
+    ii2 = qMin(ii2, (bigint)list.count() - 1);
+    if ((pos2 <= 0) || (pos1 >= start_points.last()) || (ii1 > ii2))
+        return true; //entirely outside, zeros
+
+    //a large read that crosses a boundary is issued to the members concurrently
+    QList<DiskReadMda32ConcatRead*> reads;
+    for (bigint ii = ii1; ii <= ii2; ii++) {
+        DiskReadMda32ConcatRead* T = new DiskReadMda32ConcatRead;
+        T->X = &list[ii];
+        T->i = qMax(pos1, start_points[ii]) - start_points[ii];
+        T->size = qMin(pos2, start_points[ii + 1]) - start_points[ii] - T->i;
+        reads << T;
     }
-    QVector<bigint> start_points, end_points;
-    start_points << 0;
-    end_points << sizes.value(0) - 1;
-    for (int i = 1; i < sizes.count(); i++) {
-        start_points << end_points[i - 1] + 1;
-        end_points << start_points[i] + sizes[i] - 1;
+    run_concat_reads(reads, size0);
+    bool ret = true;
+    for (int j = 0; j < reads.count(); j++) {
+        DiskReadMda32ConcatRead* T = reads[j];
+        if (!T->ok)
+            ret = false;
+        else if (T->size > 0)
+            chunk.setChunk(T->chunk, start_points[ii1 + j] + T->i - pos1);
+        delete T;
     }
+    return ret;
+}
 
-    bigint ii1 = 0;
-    while ((ii1 + 1 < list.count()) && (pos1 > end_points[ii1])) {
-        ii1++;
+bool DiskReadMda32Private::read_concat_chunk_rows(Mda32& chunk, bigint i0, bigint size0)
+{
+    //Concatenation along the first dimension: every member contributes rows to each column,
+    //so the members are read (concurrently, for a large read) for the columns touched by the chunk and interleaved
+    const QList<DiskReadMda32>& list = m_concat_list;
+    const QVector<bigint>& start_points = m_concat_start_points;
+    bigint N1 = start_points.last();
+    chunk.allocate(1, size0);
+    if ((N1 == 0) || (size0 <= 0))
+        return true;
+    bigint c1 = i0 >= 0 ? i0 / N1 : -((-i0 + N1 - 1) / N1); //floor
+    bigint c2 = (i0 + size0 - 1 >= 0) ? (i0 + size0 - 1) / N1 + 1 : -((-(i0 + size0 - 1) + N1 - 1) / N1) + 1; //exclusive
+    QList<DiskReadMda32ConcatRead*> reads;
+    for (int ii = 0; ii < list.count(); ii++) {
+        DiskReadMda32ConcatRead* T = new DiskReadMda32ConcatRead;
+        bigint M_ii = start_points[ii + 1] - start_points[ii];
+        T->X = &list[ii];
+        T->i = M_ii * c1;
+        T->size = M_ii * (c2 - c1);
+        reads << T;
     }
-    bigint ii2 = ii1;
-    while ((ii2 + 1 < list.count()) && (start_points[ii2 + 1] <= pos2)) {
-        ii2++;
+    run_concat_reads(reads, N1 * (c2 - c1));
+    bool ret = true;
+    dtype32* ptr = chunk.dataPtr();
+    for (int ii = 0; ii < reads.count(); ii++) {
+        DiskReadMda32ConcatRead* T = reads[ii];
+        if (!T->ok) {
+            ret = false;
+        }
+        else if (T->size > 0) {
+            bigint M_ii = start_points[ii + 1] - start_points[ii];
+            const dtype32* src = T->chunk.constDataPtr();
+            for (bigint c = c1; c < c2; c++) {
+                for (bigint r = 0; r < M_ii; r++) {
+                    bigint k = start_points[ii] + r + N1 * c - i0;
+                    if ((k >= 0) && (k < size0))
+                        ptr[k] = src[r + M_ii * (c - c1)];
+                }
+            }
+        }
+        delete T;
     }
+    return ret;
+}
 
-    chunk.allocate(1, N1 * (pos2 - pos1 + 1));
-    for (bigint ii = ii1; ii <= ii2; ii++) {
-        Mda32 chunk_ii;
-
-        //ttA,ttB, the range to read from Y
-        //ssA, the position to write it in "out"
-        bigint ttA, ttB, ssA;
-        if (ii == ii1) {
-            bigint offset = pos1 - start_points[ii];
-            ssA = 0;
-            if (ii1 < ii2) {
-                ttA = offset;
-                ttB = sizes[ii] - 1;
+bool DiskReadMda32Private::read_concat_subblock(Mda32& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3)
+{
+    //X(c,j2,j3) = Y(channels[c],i2+j2,i3+j3), where each member is given the part of the request it holds, so that
+    //it reads only the needed channels (see read_subblock)
+    if (!read_header_if_needed())
+        return false;
+    const QList<DiskReadMda32>& list = m_concat_list;
+    const QVector<bigint>& start_points = m_concat_start_points;
+    bigint size1 = channels.count();
+    bigint N1 = m_header.dims[0];
+    bigint N2 = m_header.dims[1];
+    bigint N3 = m_header.dims[2];
+    if (m_concat_dimension == 1) {
+        //each channel is in one member
+        X.allocate(size1, size2, size3);
+        dtype32* Xptr = X.dataPtr();
+        for (int ii = 0; ii < list.count(); ii++) {
+            QList<int> member_channels, rows;
+            for (int c = 0; c < size1; c++) {
+                if ((channels[c] >= start_points[ii]) && (channels[c] < start_points[ii + 1])) {
+                    member_channels << channels[c] - start_points[ii];
+                    rows << c;
+                }
             }
-            else {
-                ttA = offset;
-                ttB = ttA + (pos2 - pos1 + 1) - 1;
+            if (member_channels.isEmpty())
+                continue;
+            Mda32 Y;
+            if (!list[ii].readChunk(Y, member_channels, i2, i3, size2, size3))
+                return false;
+            bigint num_rows = member_channels.count();
+            const dtype32* Yptr = Y.constDataPtr();
+            for (bigint j = 0; j < size2 * size3; j++) {
+                for (bigint k = 0; k < num_rows; k++)
+                    Xptr[rows[k] + size1 * j] = Yptr[k + num_rows * j];
             }
         }
-        else if (ii == ii2) {
-            ttA = 0;
-            ttB = pos2 - start_points[ii];
-            ssA = start_points[ii] - pos1;
-        }
-        else {
-            ttA = 0;
-            ttB = sizes[ii] - 1;
-            ssA = start_points[ii] - pos1;
-        }
-
-        list[ii].readChunk(chunk_ii, N1 * ttA, N1 * (ttB - ttA + 1));
-        chunk.setChunk(chunk_ii, N1 * ssA);
+        return true;
+    }
+    bool by_columns = ((m_concat_dimension == 2) && (N3 == 1) && (i3 == 0) && (size3 == 1));
+    bool by_slices = (m_concat_dimension == 3);
+    if ((!by_columns) && (!by_slices)) {
+        //read whole slices, which are contiguous in the vectorized array, and gather
+        Mda32 Y, Y2;
+        if (!q->readChunk(Y, 0, 0, i3, N1, N2, size3))
+            return false;
+        Y.getChunk(Y2, 0, i2, 0, N1, size2, size3);
+        gather_channels(X, Y2, channels);
+        return true;
+    }
+    //each member is a range of columns (slices)
+    X.allocate(size1, size2, size3);
+    bigint unit = by_columns ? N1 : N1 * N2; //entries per column (slice)
+    bigint stride = by_columns ? size1 : size1 * size2; //entries of X per column (slice)
+    bigint j1 = by_columns ? i2 : i3;
+    bigint j2 = by_columns ? i2 + size2 : i3 + size3; //exclusive
+    for (int ii = 0; ii < list.count(); ii++) {
+        bigint a = start_points[ii] / unit;
+        bigint ja = qMax(j1, a);
+        bigint jb = qMin(j2, start_points[ii + 1] / unit);
+        if (ja >= jb)
+            continue;
+        Mda32 Y;
+        bool ok;
+        if (by_columns)
+            ok = list[ii].readChunk(Y, channels, ja - a, jb - ja);
+        else
+            ok = list[ii].readChunk(Y, channels, i2, ja - a, size2, jb - ja);
+        if (!ok)
+            return false;
+        std::copy(Y.constDataPtr(), Y.constDataPtr() + stride * (jb - ja), X.dataPtr() + stride * (ja - j1));
     }
     return true;
 }
@@ -552,19 +816,18 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i, bigint size) const
         return true;
     }
     else if (d->m_use_concat) {
-        return read_chunk_from_concat_list(X, d->m_concat_list, i, size, d->m_concat_dimension);
+        return d->read_concat_chunk(X, i, size);
     }
     if (!d->open_file_if_needed())
         return false;
+    if (d->map_file_if_needed())
+        return d->read_mapped(X, i, size, size, 1, 1);
     X.allocate(size, 1);
     bigint jA = qMax(i, (bigint)0);
     bigint jB = qMin(i + size - 1, d->total_size() - 1);
     bigint size_to_read = jB - jA + 1;
     if (size_to_read > 0) {
-        fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * (jA), SEEK_SET);
-        bigint bytes_read = mda_read_float32(&X.dataPtr()[jA - i], &d->m_header, size_to_read, d->m_file);
-        if (d->bytesReadCounter)
-            d->bytesReadCounter->add(bytes_read);
+        bigint bytes_read = d->read_entries(&X.dataPtr()[jA - i], jA, size_to_read);
         if (bytes_read != size_to_read) {
             printf("Warning problem reading chunk in DiskReadMda32: %ld<>%ld\n", (bigint)bytes_read, (bigint)size_to_read);
             return false;
@@ -583,7 +846,9 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i1, bigint i2, bigint size1, bigi
         return true;
     }
     else if (d->m_use_concat) {
-        if (!readChunk(X, i1 + N1() * i2, size1 * size2))
+        if ((i1 != 0) || (size1 != N1()))
+            return d->read_concat_subblock(X, DiskReadMda32Private::channel_range(i1, size1), i2, 0, size2, 1);
+        if (!readChunk(X, N1() * i2, size1 * size2))
             return false;
         return X.reshape(size1, size2);
     }
@@ -591,15 +856,14 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i1, bigint i2, bigint size1, bigi
         return false;
     if ((size1 == N1()) && (i1 == 0)) {
         //easy case
+        if (d->map_file_if_needed())
+            return d->read_mapped(X, N1() * i2, size1 * size2, size1, size2, 1);
         X.allocate(size1, size2);
         bigint jA = qMax(i2, (bigint)0);
         bigint jB = qMin(i2 + size2 - 1, N2() - 1);
         bigint size2_to_read = jB - jA + 1;
         if (size2_to_read > 0) {
-            fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * (i1 + N1() * jA), SEEK_SET);
-            bigint bytes_read = mda_read_float32(&X.dataPtr()[(jA - i2) * size1], &d->m_header, size1 * size2_to_read, d->m_file);
-            if (d->bytesReadCounter)
-                d->bytesReadCounter->add(bytes_read);
+            bigint bytes_read = d->read_entries(&X.dataPtr()[(jA - i2) * size1], i1 + N1() * jA, size1 * size2_to_read);
             if (bytes_read != size1 * size2_to_read) {
                 printf("Warning problem reading 2d chunk in DiskReadMda32: %ld<>%ld\n", (bigint)bytes_read, (bigint)(size1 * size2));
                 return false;
@@ -612,10 +876,7 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i1, bigint i2, bigint size1, bigi
             qWarning() << "Cannot read chunk from empty array:" << i1 << size1 << N1() << N2();
             return false;
         }
-        else {
-            qWarning() << "Cannot read chunk, dimensions don't agree:" << i1 << i2 << size1 << size2 << N1() << N2();
-            return false;
-        }
+        return d->read_subblock(X, DiskReadMda32Private::channel_range(i1, size1), i2, 0, size2, 1);
     }
 }
 
@@ -634,23 +895,24 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i1, bigint i2, bigint i3, bigint
         return true;
     }
     else if (d->m_use_concat) {
-        if (!readChunk(X, i1 + N1() * i2 + N1() * N2() * i3, size1 * size2 * size3))
+        if ((i1 != 0) || (i2 != 0) || (size1 != N1()) || (size2 != N2()))
+            return d->read_concat_subblock(X, DiskReadMda32Private::channel_range(i1, size1), i2, i3, size2, size3);
+        if (!readChunk(X, N1() * N2() * i3, size1 * size2 * size3))
             return false;
         return X.reshape(size1, size2, size3);
     }
     if (!d->open_file_if_needed())
         return false;
-    if ((size1 == N1()) && (size2 == N2())) {
+    if ((size1 == N1()) && (size2 == N2()) && (i1 == 0) && (i2 == 0)) {
         //easy case
+        if (d->map_file_if_needed())
+            return d->read_mapped(X, i1 + N1() * i2 + N1() * N2() * i3, size1 * size2 * size3, size1, size2, size3);
         X.allocate(size1, size2, size3);
         bigint jA = qMax(i3, (bigint)0);
         bigint jB = qMin(i3 + size3 - 1, N3() - 1);
         bigint size3_to_read = jB - jA + 1;
         if (size3_to_read > 0) {
-            fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * (i1 + N1() * i2 + N1() * N2() * jA), SEEK_SET);
-            bigint bytes_read = mda_read_float32(&X.dataPtr()[(jA - i3) * size1 * size2], &d->m_header, size1 * size2 * size3_to_read, d->m_file);
-            if (d->bytesReadCounter)
-                d->bytesReadCounter->add(bytes_read);
+            bigint bytes_read = d->read_entries(&X.dataPtr()[(jA - i3) * size1 * size2], i1 + N1() * i2 + N1() * N2() * jA, size1 * size2 * size3_to_read);
             if (bytes_read != size1 * size2 * size3_to_read) {
                 printf("Warning problem reading 3d chunk in DiskReadMda32: %ld<>%ld\n", (bigint)bytes_read, (bigint)(size1 * size2 * size3_to_read));
                 return false;
@@ -659,9 +921,40 @@ bool DiskReadMda32::readChunk(Mda32& X, bigint i1, bigint i2, bigint i3, bigint
         return true;
     }
     else {
-        printf("Warning: This case not yet supported (DiskReadMda32::readchunk 3d).\n");
+        return d->read_subblock(X, DiskReadMda32Private::channel_range(i1, size1), i2, i3, size2, size3);
+    }
+}
+
+bool DiskReadMda32::readChunk(Mda32& X, const QList<int>& channels, bigint i2, bigint size2) const
+{
+    if (d->m_use_concat)
+        return d->read_concat_subblock(X, channels, i2, 0, size2, 1);
+    if (d->m_use_memory_mda) {
+        Mda32 tmp;
+        if (!readChunk(tmp, 0, i2, N1(), size2))
+            return false;
+        DiskReadMda32Private::gather_channels(X, tmp, channels);
+        return true;
+    }
+    if (!d->open_file_if_needed())
         return false;
+    return d->read_subblock(X, channels, i2, 0, size2, 1);
+}
+
+bool DiskReadMda32::readChunk(Mda32& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3) const
+{
+    if (d->m_use_concat)
+        return d->read_concat_subblock(X, channels, i2, i3, size2, size3);
+    if (d->m_use_memory_mda) {
+        Mda32 tmp;
+        if (!readChunk(tmp, 0, i2, i3, N1(), size2, size3))
+            return false;
+        DiskReadMda32Private::gather_channels(X, tmp, channels);
+        return true;
     }
+    if (!d->open_file_if_needed())
+        return false;
+    return d->read_subblock(X, channels, i2, i3, size2, size3);
 }
 
 dtype32 DiskReadMda32::value(bigint i) const
@@ -672,15 +965,29 @@ dtype32 DiskReadMda32::value(bigint i) const
         return 0;
     bigint chunk_index = i / DEFAULT_CHUNK_SIZE;
     bigint offset = i - DEFAULT_CHUNK_SIZE * chunk_index;
-    if (d->m_current_internal_chunk_index != chunk_index) {
+    if (d->m_current_internal_chunk_index == chunk_index) {
+        d->m_value_cache_hits++;
+        return d->m_internal_chunk.value(offset);
+    }
+    Mda32* block = d->m_value_cache.object(chunk_index);
+    if (block) {
+        d->m_value_cache_hits++;
+        d->m_internal_chunk = *block; //shares the data
+    }
+    else {
+        d->m_value_cache_misses++;
         bigint size_to_read = DEFAULT_CHUNK_SIZE;
         if (chunk_index * DEFAULT_CHUNK_SIZE + size_to_read > d->total_size())
             size_to_read = d->total_size() - chunk_index * DEFAULT_CHUNK_SIZE;
+        Mda32 block0; //read into a fresh array so that the (possibly cached) previous block is not detached
         if (size_to_read) {
-            this->readChunk(d->m_internal_chunk, chunk_index * DEFAULT_CHUNK_SIZE, size_to_read);
+            this->readChunk(block0, chunk_index * DEFAULT_CHUNK_SIZE, size_to_read);
         }
-        d->m_current_internal_chunk_index = chunk_index;
+        d->m_internal_chunk = block0;
+        int cost = qMax((int)(size_to_read * sizeof(dtype32) / 1024), 1);
+        d->m_value_cache.insert(chunk_index, new Mda32(d->m_internal_chunk), cost);
     }
+    d->m_current_internal_chunk_index = chunk_index;
     return d->m_internal_chunk.value(offset);
 }
 
@@ -708,6 +1015,23 @@ dtype32 DiskReadMda32::value(bigint i1, bigint i2, bigint i3) const
     return value(i1 + N1() * i2 + N1() * N2() * i3);
 }
 
+void DiskReadMda32Private::close_file()
+{
+    close_direct_fd();
+    if (m_file) {
+        fclose(m_file);
+        m_file = 0;
+    }
+}
+
+void DiskReadMda32Private::close_direct_fd()
+{
+    if (m_direct_fd >= 0) {
+        ::close(m_direct_fd);
+        m_direct_fd = -1;
+    }
+}
+
 void DiskReadMda32Private::construct_and_clear()
 {
     m_file_open_failed = false;
@@ -715,60 +1039,80 @@ void DiskReadMda32Private::construct_and_clear()
     m_current_internal_chunk_index = -1;
     m_use_memory_mda = false;
     m_use_concat = false;
+    m_concat_start_points.clear();
     m_header_read = false;
     m_reshaped = false;
     this->m_internal_chunk = Mda32();
     this->m_mda_header_total_size = 0;
     this->m_memory_mda = Mda32();
     this->m_path = "";
+    this->m_mmap.clear();
+    this->m_mmap_failed = false;
+    this->m_mdaz.clear();
+    this->m_stream.clear();
+    this->m_transposed.clear();
+    this->m_transposed_failed = false;
+    this->m_value_cache.clear();
 }
 
 bool DiskReadMda32Private::read_header_if_needed()
 {
     if (m_header_read)
         return true;
+    QMutexLocker locker(&m_file_mutex);
+    if (m_header_read)
+        return true; //another thread got here first
     if (m_use_memory_mda) {
         m_header_read = true;
         return true;
     }
     else if (m_use_concat) {
-        m_header_read = true;
         if (m_concat_list.count() == 0) {
             qWarning() << "Cannot read header of concat array because list is empty";
+            m_header_read = true;
             return false;
         }
+        //all dimensions other than the concat dimension must agree
+        int cd = m_concat_dimension - 1;
         m_header = m_concat_list[0].mdaioHeader();
-        bigint N2 = 0;
+        m_header.dims[cd] = 0;
+        m_concat_start_points.clear();
+        m_concat_start_points << 0;
         for (int i = 0; i < m_concat_list.count(); i++) {
-            if (m_concat_list[i].N1() != m_concat_list[0].N1()) {
-                qWarning() << "dimension mismatch in concat list";
-                return false;
-            }
-            if (m_concat_list[i].N3() != m_concat_list[0].N3()) {
-                qWarning() << "dimension mismatch in concat list";
-                return false;
-            }
-            if (m_concat_list[i].N4() != m_concat_list[0].N4()) {
-                qWarning() << "dimension mismatch in concat list";
-                return false;
+            MDAIO_HEADER H = m_concat_list[i].mdaioHeader();
+            for (int j = 0; j < 6; j++) {
+                if ((j != cd) && ((bigint)H.dims[j] != m_concat_list[0].N(j + 1))) {
+                    qWarning() << "dimension mismatch in concat list" << m_concat_dimension << i << j + 1;
+                    m_concat_start_points.clear();
+                    m_header_read = true;
+                    return false;
+                }
             }
-            N2 += m_concat_list[i].N2();
+            m_header.dims[cd] += H.dims[cd];
+            if (cd == 0)
+                m_concat_start_points << m_concat_start_points.last() + H.dims[0];
+            else
+                m_concat_start_points << m_concat_start_points.last() + m_concat_list[i].totalSize();
         }
-        m_header.dims[1] = N2;
+        if (m_header.num_dims < m_concat_dimension)
+            m_header.num_dims = m_concat_dimension;
         m_mda_header_total_size = 1;
         for (int i = 0; i < MDAIO_MAX_DIMS; i++)
             m_mda_header_total_size *= m_header.dims[i];
+        m_header_read = true; //only after the header is complete, since other threads check this without the lock
         return true;
     }
+    if ((mdaz_is_mdaz_path(m_path)) || (mda_is_stream_path(m_path))) {
+        //the index has to be loaded anyway (or the stream can't be reopened), so the reader stays open
+        return open_file_if_needed();
+    }
     bool file_was_open = (m_file != 0); //so we can restore to previous state (we don't want too many files open unnecessarily)
     if (!open_file_if_needed()) //if successful, it will read the header
         return false;
     if (!m_file)
         return false; //should never happen
-    if (!file_was_open) {
-        fclose(m_file);
-        m_file = 0;
-    }
+    if (!file_was_open)
+        close_file();
     return true;
 }
 
@@ -780,14 +1124,55 @@ bool DiskReadMda32Private::open_file_if_needed()
         read_header_if_needed();
         return true;
     }
-    if (m_file)
+    QMutexLocker locker(&m_file_mutex);
+    if ((m_file) || (m_mdaz) || (m_stream))
         return true;
     if (m_file_open_failed)
         return false;
     if (m_path.isEmpty())
         return false;
+    if (mdaz_is_mdaz_path(m_path)) {
+        QSharedPointer<MdazReader> reader(new MdazReader);
+        if (!reader->open(m_path)) {
+            qWarning() << ":::: Failed to open DiskReadMda32 file: " + m_path;
+            m_file_open_failed = true;
+            return false;
+        }
+        m_mdaz = reader;
+        if (!m_header_read) {
+            m_header = m_mdaz->header();
+            m_mda_header_total_size = 1;
+            for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+                m_mda_header_total_size *= m_header.dims[i];
+            m_header_read = true;
+        }
+        return true;
+    }
+    if (mda_is_stream_path(m_path)) {
+        QSharedPointer<MdaStreamReader> reader(new MdaStreamReader);
+        if (!reader->open(m_path)) {
+            qWarning() << ":::: Failed to open DiskReadMda32 stream: " + m_path;
+            m_file_open_failed = true;
+            return false;
+        }
+        m_stream = reader;
+        if (!m_header_read) {
+            m_header = m_stream->header();
+            m_mda_header_total_size = 1;
+            for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+                m_mda_header_total_size *= m_header.dims[i];
+            m_header_read = true;
+        }
+        return true;
+    }
     m_file = fopen(m_path.toLatin1().data(), "rb");
     if (m_file) {
+        if (m_use_direct) {
+            m_direct_refused = 0;
+            m_direct_fd = mda_open_direct(m_path.toLatin1().data(), false);
+            if (m_direct_fd < 0)
+                qWarning() << "Direct I/O is not available, using regular reads and dropping them from the page cache:" << m_path;
+        }
         if (!m_header_read) {
             //important not to read it again in case we have reshaped the array
             mda_read_header(&m_header, m_file);
@@ -811,18 +1196,259 @@ bool DiskReadMda32Private::open_file_if_needed()
     return true;
 }
 
+bool DiskReadMda32Private::map_file_if_needed()
+{
+    if ((!m_use_mmap) || (m_mdaz) || (m_stream))
+        return false;
+    QMutexLocker locker(&m_file_mutex);
+    if (m_mmap)
+        return true;
+    if (m_mmap_failed)
+        return false;
+    m_mmap = MdaMemoryMap::map(m_path);
+    if ((!m_mmap) || (m_mmap->size() < m_header.header_size + m_header.num_bytes_per_entry * m_mda_header_total_size)) {
+        qWarning() << "Unable to memory map file, falling back to regular reads:" << m_path;
+        m_mmap.clear();
+        m_mmap_failed = true; //we don't want to try this more than once
+        return false;
+    }
+    return true;
+}
+
+bool DiskReadMda32Private::read_mapped(Mda32& X, bigint i, bigint size, bigint size1, bigint size2, bigint size3)
+{
+    //i and size refer to the vectorized array, size1 x size2 x size3 is the shape of the output
+    const unsigned char* ptr = m_mmap->data() + m_header.header_size;
+    bigint NN = total_size();
+    if ((i >= 0) && (i + size <= NN) && (m_header.data_type == MDAIO_TYPE_FLOAT32) && (((uintptr_t)ptr) % sizeof(dtype32) == 0)) {
+        //no conversion or padding needed, so hand back a view into the mapping
+        X.setExternalData(((const dtype32*)ptr) + i, m_mmap, size1, size2, size3);
+        if (MdaIOProfile::isEnabled())
+            MdaIOProfile::record(MdaIOProfile::Read, m_path, m_header.header_size + m_header.num_bytes_per_entry * i, size * m_header.num_bytes_per_entry, 0);
+        if (bytesReadCounter)
+            bytesReadCounter->add(size * m_header.num_bytes_per_entry);
+        return true;
+    }
+    X.allocate(size1, size2, size3);
+    bigint jA = qMax(i, (bigint)0);
+    bigint jB = qMin(i + size - 1, NN - 1);
+    bigint size_to_read = jB - jA + 1;
+    if (size_to_read > 0) {
+        MdaIOProfileScope profile(MdaIOProfile::Read, m_path, m_header.header_size + m_header.num_bytes_per_entry * jA);
+        profile.setNumBytes(size_to_read * m_header.num_bytes_per_entry);
+        mda_convert_float32(&X.dataPtr()[jA - i], &m_header, ptr + m_header.num_bytes_per_entry * jA, size_to_read);
+        if (bytesReadCounter)
+            bytesReadCounter->add(size_to_read * m_header.num_bytes_per_entry);
+    }
+    return true;
+}
+
+bigint DiskReadMda32Private::read_entries(dtype32* data, bigint i, bigint n)
+{
+    //every read of the file goes through here, so this is where it is counted and timed
+    bigint ret;
+    {
+        ILatencyTimer timer(readLatencyCounter);
+        MdaIOProfileScope profile(MdaIOProfile::Read, m_path, m_header.header_size + m_header.num_bytes_per_entry * i);
+        ret = read_entries_uncounted(data, i, n);
+        profile.setNumBytes(ret * m_header.num_bytes_per_entry);
+    }
+    if ((bytesReadCounter) && (ret > 0))
+        bytesReadCounter->add(ret * m_header.num_bytes_per_entry);
+    return ret;
+}
+
+bigint DiskReadMda32Private::read_entries_uncounted(dtype32* data, bigint i, bigint n)
+{
+    //i is the vectorized index of the first entry, which must be within the array
+    if (m_mdaz)
+        return m_mdaz->readFloat32(data, i, n);
+    if (m_stream)
+        return m_stream->readFloat32(data, i, n);
+    bigint offset = m_header.header_size + m_header.num_bytes_per_entry * i;
+    if (m_use_direct) {
+        if ((m_direct_fd >= 0) && (!m_direct_refused.load())) {
+            bool refused = false;
+            bigint ret = mda_pread_direct_float32(data, &m_header, n, m_direct_fd, fileno(m_file), offset, &refused);
+            if (refused)
+                m_direct_refused = 1;
+            return ret;
+        }
+        bigint ret = mda_pread_float32(data, &m_header, n, fileno(m_file), offset);
+        mda_drop_cache(fileno(m_file), offset, m_header.num_bytes_per_entry * ret);
+        return ret;
+    }
+    return mda_pread_float32(data, &m_header, n, fileno(m_file), offset);
+}
+
+bool DiskReadMda32Private::read_subblock(Mda32& X, const QList<int>& channels, bigint i2, bigint i3, bigint size2, bigint size3)
+{
+    //X(c,j2,j3) = Y(channels[c],i2+j2,i3+j3), zero outside of Y
+    MdaSubblock S(channels, i2, i3, size2, size3, m_header.dims[0], m_header.dims[1], m_header.dims[2]);
+    X.allocate(S.size1, size2, size3);
+    if (S.isEmpty())
+        return true;
+    bigint num_bytes_per_entry = m_header.num_bytes_per_entry;
+    dtype32* Xptr = X.dataPtr();
+
+    if ((m_use_transposed) && (i3 == 0) && (m_mda_header_total_size == S.N1 * S.N2) && (S.size1 * TRANSPOSED_MAX_CHANNEL_FRACTION <= S.N1)) {
+        if (open_transposed_if_needed())
+            return read_transposed(X, channels, S.k2A, S.k2B, i2);
+    }
+
+    if (map_file_if_needed()) {
+        MdaIOProfileScope profile(MdaIOProfile::Read, m_path, m_header.header_size + num_bytes_per_entry * (S.ch_min + S.N1 * (S.k2A + S.N2 * S.k3A)));
+        profile.setNumBytes(num_bytes_per_entry * S.span * (S.k2B - S.k2A) * (S.k3B - S.k3A));
+        const unsigned char* ptr = m_mmap->data() + m_header.header_size;
+        for (bigint k3 = S.k3A; k3 < S.k3B; k3++) {
+            for (bigint k2 = S.k2A; k2 < S.k2B; k2++) {
+                bigint aa = S.xIndex(k2, k3);
+                bigint bb = S.N1 * (k2 + S.N2 * k3);
+                for (int r = 0; r < S.runs.count(); r++) {
+                    mda_convert_float32(&Xptr[aa + S.runs[r].dst], &m_header, ptr + num_bytes_per_entry * (bb + S.runs[r].src), S.runs[r].len);
+                }
+            }
+        }
+        if (bytesReadCounter)
+            bytesReadCounter->add(num_bytes_per_entry * S.span * (S.k2B - S.k2A) * (S.k3B - S.k3A));
+        return true;
+    }
+
+    //compressed files are always read in stretches, since they are decoded by block
+    return mda_read_subblock(Xptr, S, num_bytes_per_entry, ((m_mdaz) || (m_stream)), [this](dtype32* buf, bigint i, bigint n) { return read_entries(buf, i, n); }, "DiskReadMda32");
+}
+
+QString DiskReadMda32Private::transposed_path()
+{
+    //keyed by the file and its state, so a modified file gets a new sidecar
+    QFileInfo info(m_path);
+    if (!info.exists())
+        return "";
+    QString str = QString("%1 %2 %3 %4 %5 %6").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(m_header.dims[0]).arg(m_header.dims[1]).arg(TRANSPOSED_BLOCK_COLUMNS);
+    QString code = QString(QCryptographicHash::hash(str.toUtf8(), QCryptographicHash::Sha1).toHex());
+    return CacheManager::globalInstance()->makeLocalFile(code + ".mda.T", CacheManager::LongTerm);
+}
+
+bool DiskReadMda32Private::build_transposed(const QString& fname)
+{
+    //The sidecar is an ordinary .mda of size B x N1 x num_blocks (B=TRANSPOSED_BLOCK_COLUMNS), so the B timepoints of a block are contiguous for each channel
+    bigint N1 = m_header.dims[0];
+    bigint N2 = m_header.dims[1];
+    bigint B = TRANSPOSED_BLOCK_COLUMNS;
+    bigint num_blocks = (N2 + B - 1) / B;
+    QString tmp_fname = fname + QString(".%1").arg(QCoreApplication::applicationPid()); //other processes may be building it too
+    printf("Building channel-major cache of %s...\n", m_path.toUtf8().data());
+    DiskWriteMda W;
+    W.setAppendOnly(true);
+    if (!W.open(m_header.data_type, tmp_fname, B, N1, num_blocks))
+        return false;
+    Mda32 chunk;
+    Mda32 T(B, N1);
+    dtype32* Tptr = T.dataPtr();
+    for (bigint k = 0; k < num_blocks; k++) {
+        if (!q->readChunk(chunk, 0, k * B, N1, B))
+            return false;
+        const dtype32* ptr = chunk.constDataPtr();
+        for (bigint t = 0; t < B; t++) {
+            for (bigint m = 0; m < N1; m++)
+                Tptr[t + B * m] = ptr[m + N1 * t];
+        }
+        if (!W.writeChunk(T, B * N1 * k))
+            return false;
+    }
+    W.close();
+    if ((!QFile::rename(tmp_fname, fname)) && (!QFile::exists(fname))) {
+        QFile::remove(tmp_fname);
+        return false;
+    }
+    QFile::remove(tmp_fname);
+    return true;
+}
+
+bool DiskReadMda32Private::open_transposed_if_needed()
+{
+    QMutexLocker locker(&m_file_mutex);
+    if (m_transposed)
+        return true;
+    if ((m_transposed_failed) || (m_stream))
+        return false; //the copy is built from a pass over the file, which a stream can't spare
+    QString fname = transposed_path();
+    if ((fname.isEmpty()) || ((!QFile::exists(fname)) && (!build_transposed(fname)))) {
+        qWarning() << "Unable to build channel-major cache, falling back to regular reads:" << m_path;
+        m_transposed_failed = true; //we don't want to try this more than once
+        return false;
+    }
+    QSharedPointer<DiskReadMda32> T(new DiskReadMda32(fname));
+    bigint B = TRANSPOSED_BLOCK_COLUMNS;
+    if ((T->N1() != B) || (T->N2() != (bigint)m_header.dims[0]) || (T->N3() != ((bigint)m_header.dims[1] + B - 1) / B)) {
+        qWarning() << "Unexpected dimensions of channel-major cache, falling back to regular reads:" << fname;
+        m_transposed_failed = true;
+        return false;
+    }
+    m_transposed = T;
+    return true;
+}
+
+bool DiskReadMda32Private::read_transposed(Mda32& X, const QList<int>& channels, bigint k2A, bigint k2B, bigint i2)
+{
+    //X has already been allocated (and zeroed) by read_subblock, k2A..k2B-1 are the columns within the array
+    bigint N1 = m_header.dims[0];
+    bigint B = TRANSPOSED_BLOCK_COLUMNS;
+    bigint size1 = X.N1();
+    dtype32* Xptr = X.dataPtr();
+    Mda32 buf;
+    for (bigint c = 0; c < size1; c++) {
+        bigint ch = channels[c];
+        if ((ch < 0) || (ch >= N1))
+            continue;
+        for (bigint k = k2A / B; k * B < k2B; k++) {
+            bigint ta = qMax(k2A, k * B);
+            bigint tb = qMin(k2B, (k + 1) * B);
+            if (!m_transposed->readChunk(buf, B * (ch + N1 * k) + ta - k * B, tb - ta))
+                return false;
+            const dtype32* ptr = buf.constDataPtr();
+            for (bigint t = ta; t < tb; t++)
+                Xptr[c + size1 * (t - i2)] = ptr[t - ta];
+        }
+    }
+    return true;
+}
+
+QList<int> DiskReadMda32Private::channel_range(bigint i1, bigint size1)
+{
+    QList<int> ret;
+    for (bigint i = i1; i < i1 + size1; i++)
+        ret << i;
+    return ret;
+}
+
+void DiskReadMda32Private::gather_channels(Mda32& X, const Mda32& Y, const QList<int>& channels)
+{
+    bigint size1 = channels.count();
+    bigint N1 = Y.N1();
+    bigint num_rows = Y.N2() * Y.N3();
+    X.allocate(size1, Y.N2(), Y.N3());
+    dtype32* Xptr = X.dataPtr();
+    const dtype32* Yptr = Y.constDataPtr();
+    for (bigint j = 0; j < num_rows; j++) {
+        for (bigint c = 0; c < size1; c++) {
+            bigint ch = channels[c];
+            if ((ch >= 0) && (ch < N1))
+                Xptr[c + size1 * j] = Yptr[ch + N1 * j];
+        }
+    }
+}
+
 void DiskReadMda32Private::copy_from(const DiskReadMda32& other)
 {
     /// TODO (LOW) think about copying over additional information such as internal chunks
 
-    if (this->m_file) {
-        fclose(this->m_file);
-        this->m_file = 0;
-    }
+    this->close_file();
     this->allocatedCounter = other.d->allocatedCounter;
     this->freedCounter = other.d->freedCounter;
     this->bytesReadCounter = other.d->bytesReadCounter;
     this->bytesWrittenCounter = other.d->bytesWrittenCounter;
+    this->readLatencyCounter = other.d->readLatencyCounter;
     this->construct_and_clear();
     this->m_current_internal_chunk_index = -1;
     this->m_file_open_failed = other.d->m_file_open_failed;
@@ -837,6 +1463,22 @@ void DiskReadMda32Private::copy_from(const DiskReadMda32& other)
     this->m_use_concat = other.d->m_use_concat;
     this->m_concat_dimension = other.d->m_concat_dimension;
     this->m_concat_list = other.d->m_concat_list;
+    this->m_concat_start_points = other.d->m_concat_start_points;
+    this->m_use_mmap = other.d->m_use_mmap;
+    this->m_use_direct = other.d->m_use_direct;
+    this->m_mmap = other.d->m_mmap;
+    this->m_mmap_failed = other.d->m_mmap_failed;
+    this->m_mdaz = other.d->m_mdaz;
+    this->m_stream = other.d->m_stream;
+    this->m_use_transposed = other.d->m_use_transposed;
+    this->m_transposed = other.d->m_transposed;
+    this->m_transposed_failed = other.d->m_transposed_failed;
+    this->m_value_cache.setMaxCost(other.d->m_value_cache.maxCost());
+}
+
+void DiskReadMda32Private::set_value_cache_size(bigint num_bytes)
+{
+    m_value_cache.setMaxCost((int)qMin(num_bytes / 1024, (bigint)INT_MAX));
 }
 
 bigint DiskReadMda32Private::total_size()
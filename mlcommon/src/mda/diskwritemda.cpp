@@ -1,11 +1,22 @@
 #include "diskwritemda.h"
 #include "mdaio.h"
+#include "mdazio.h"
+#include "mdastream.h"
+#include "mdaioprofile.h"
 
+#include <QAtomicInt>
 #include <QFile>
 #include <QString>
 #include <mda32.h>
 #include "mda.h"
 #include <QDebug>
+#include <icounter.h>
+#include <objectregistry.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include <vector>
 
 class DiskWriteMdaPrivate {
 public:
@@ -14,8 +25,54 @@ public:
     MDAIO_HEADER m_header;
     FILE* m_file;
     bool m_requires_rename = false;
+    bool m_append_only = false;
+    bigint m_append_position = 0;
+    MdazWriter* m_mdaz = 0; //set when writing a compressed .mdaz file, which is always append-only
+    MdaStreamWriter* m_stream = 0; //set when writing to a pipe or FIFO, see mdastream.h
+    bool m_use_direct = false;
+    int m_direct_fd = -1; //second descriptor of the same file opened for direct I/O, see setDirectIO()
+    QAtomicInt m_direct_refused; //set when the filesystem refuses direct I/O; m_direct_fd stays open (other threads may be using it) until close
+    IThreadCounter* bytesWrittenCounter = nullptr;
+    ILatencyCounter* writeLatencyCounter = nullptr;
 
     int determine_ndims(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6);
+    bool set_file_size(bigint num_bytes);
+    bigint data_end() const;
+    void open_direct_fd(const QString& fname);
+    void close_direct_fd();
+    bool use_direct_fd() const;
+    bool write_float32(const float* data, bigint i, bigint size);
+    bool write_float64(const double* data, bigint i, bigint size);
+    bool write_int16(const int16_t* data, bigint i, bigint size);
+    void find_counters();
+};
+
+//times and profiles one write of size entries at position i, and counts it if it succeeded
+class DiskWriteMdaCall {
+public:
+    DiskWriteMdaCall(DiskWriteMdaPrivate* d, bigint i, bigint size)
+        : m_d(d)
+        , m_size(size)
+        , m_timer(d->writeLatencyCounter)
+        , m_profile(MdaIOProfile::Write, d->m_path, d->m_header.header_size + d->m_header.num_bytes_per_entry * i)
+    {
+    }
+    bool finish(bool ok)
+    {
+        if (ok) {
+            bigint num_bytes = m_size * m_d->m_header.num_bytes_per_entry;
+            if (m_d->bytesWrittenCounter)
+                m_d->bytesWrittenCounter->add(num_bytes);
+            m_profile.setNumBytes(num_bytes);
+        }
+        return ok;
+    }
+
+private:
+    DiskWriteMdaPrivate* m_d;
+    bigint m_size;
+    ILatencyTimer m_timer;
+    MdaIOProfileScope m_profile;
 };
 
 DiskWriteMda::DiskWriteMda()
@@ -23,6 +80,7 @@ DiskWriteMda::DiskWriteMda()
     d = new DiskWriteMdaPrivate;
     d->q = this;
     d->m_file = 0;
+    d->find_counters();
 }
 
 DiskWriteMda::DiskWriteMda(int data_type, const QString& path, bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
@@ -30,6 +88,7 @@ DiskWriteMda::DiskWriteMda(int data_type, const QString& path, bigint N1, bigint
     d = new DiskWriteMdaPrivate;
     d->q = this;
     d->m_file = 0;
+    d->find_counters();
     this->open(data_type, path, N1, N2, N3, N4, N5, N6);
 }
 
@@ -46,7 +105,8 @@ bool DiskWriteMda::open(int data_type, const QString& path, bigint N1, bigint N2
         return false; //can't open twice!
     }
 
-    if (QFile::exists(path)) {
+    bool is_stream = mda_is_stream_path(path);
+    if ((!is_stream) && (QFile::exists(path))) {
         if (!QFile::remove(path)) {
             qWarning() << "Unable to remove file in diskwritemda::open" << path;
             return false;
@@ -66,6 +126,22 @@ bool DiskWriteMda::open(int data_type, const QString& path, bigint N1, bigint N2
     d->m_header.dims[5] = N6;
     d->m_header.num_dims = d->determine_ndims(N1, N2, N3, N4, N5, N6);
 
+    if (is_stream) {
+        //a pipe or FIFO: written in order, in place
+        d->m_requires_rename = false;
+        d->m_file = fopen(path.toUtf8().data(), "wb");
+        if (!d->m_file) {
+            qWarning() << "Error in DiskWriteMda::open -- problem opening stream: " + path;
+            return false;
+        }
+        d->m_stream = new MdaStreamWriter;
+        if (!d->m_stream->begin(d->m_file, &d->m_header)) {
+            qWarning() << "Error in DiskWriteMda::open -- problem writing header to stream: " + path;
+            return false;
+        }
+        return true;
+    }
+
     d->m_file = fopen((path + ".tmp").toLatin1().data(), "wb");
     d->m_requires_rename = true;
 
@@ -74,29 +150,34 @@ bool DiskWriteMda::open(int data_type, const QString& path, bigint N1, bigint N2
         return false;
     }
 
-    bigint NN = N1 * N2 * N3 * N4 * N5 * N6;
-    bigint buf_size = 1e6;
+    if (mdaz_is_mdaz_path(path)) {
+        d->m_append_position = 0;
+        d->m_mdaz = new MdazWriter;
+        if (!d->m_mdaz->begin(d->m_file, &d->m_header)) {
+            qWarning() << "Error in DiskWriteMda::open -- problem writing mdaz header: " + path + ".tmp";
+            return false;
+        }
+        return true;
+    }
 
     //write the header
     mda_write_header(&d->m_header, d->m_file);
+    //writeChunk bypasses the stdio buffer, so nothing may be left pending in it
+    fflush(d->m_file);
 
-    //fill it all with zeros!
-    float* zeros = (float*)malloc(sizeof(float) * buf_size);
-    for (bigint i = 0; i < buf_size; i++)
-        zeros[i] = 0;
-    bigint i = 0;
-    while (i < NN) {
-        bigint num_to_write = NN - i;
-        if (num_to_write > buf_size)
-            num_to_write = buf_size;
-        mda_write_float32(zeros, &d->m_header, num_to_write, d->m_file);
-        i += buf_size;
+    d->m_append_position = 0;
+    if (d->m_append_only) {
+        //the file grows as chunks are appended, and is padded (if needed) on close
+        return true;
     }
-    free(zeros);
 
-    fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * NN - 1, SEEK_SET);
-    unsigned char zero = 0;
-    fwrite(&zero, 1, 1, d->m_file);
+    //extend the file to its full size without writing the data -- unwritten regions read back as zeros
+    if (!d->set_file_size(d->data_end())) {
+        qWarning() << "Error in DiskWriteMda::open -- unable to set the size of the file: " + path + ".tmp";
+        return false;
+    }
+    if (d->m_use_direct)
+        d->open_direct_fd(path + ".tmp");
 
     return true;
 }
@@ -108,19 +189,79 @@ bool DiskWriteMda::open(const QString& path)
 
     d->m_path = path;
 
+    if ((d->m_append_only) || (mdaz_is_mdaz_path(path)) || (mda_is_stream_path(path))) {
+        qWarning() << "Error in DiskWriteMda::open -- append-only mode (and .mdaz and streams) is not supported when updating an existing file";
+        return false;
+    }
+
     d->m_requires_rename = false;
     d->m_file = fopen(path.toLatin1().data(), "r+"); //open file for update, both read and write
-    mda_read_header(&d->m_header, d->m_file);
-
     if (!d->m_file)
         return false;
+    mda_read_header(&d->m_header, d->m_file);
+    if (d->m_use_direct)
+        d->open_direct_fd(path);
 
     return true;
 }
 
+void DiskWriteMda::setAppendOnly(bool val)
+{
+    if (d->m_file) {
+        qWarning() << "DiskWriteMda::setAppendOnly must be called before open";
+        return;
+    }
+    d->m_append_only = val;
+}
+
+bool DiskWriteMda::isAppendOnly() const
+{
+    return ((d->m_append_only) || (d->m_mdaz) || (d->m_stream));
+}
+
+bool DiskWriteMda::isStream() const
+{
+    return (d->m_stream != 0);
+}
+
+void DiskWriteMda::setDirectIO(bool val)
+{
+    if (d->m_file) {
+        qWarning() << "DiskWriteMda::setDirectIO must be called before open";
+        return;
+    }
+    d->m_use_direct = val;
+}
+
+bool DiskWriteMda::isDirectIO() const
+{
+    return d->m_use_direct;
+}
+
 void DiskWriteMda::close()
 {
     if (d->m_file) {
+        d->close_direct_fd();
+        if (d->m_mdaz) {
+            //pads with zeros and writes the block index
+            if (!d->m_mdaz->finish())
+                qWarning() << "Unable to finish mdaz file in diskwritemda::close" << d->m_path;
+            delete d->m_mdaz;
+            d->m_mdaz = 0;
+        }
+        else if (d->m_stream) {
+            //writes out chunks still waiting for earlier data, and pads with zeros
+            if (!d->m_stream->finish())
+                qWarning() << "Unable to finish writing stream in diskwritemda::close" << d->m_path;
+            delete d->m_stream;
+            d->m_stream = 0;
+        }
+        else if (d->m_append_only) {
+            //pad with zeros if not everything was written
+            fflush(d->m_file);
+            if (!d->set_file_size(d->data_end()))
+                qWarning() << "Unable to pad file in diskwritemda::close" << d->m_path;
+        }
         fclose(d->m_file);
         if (d->m_requires_rename) {
             if (!QFile::rename(d->m_path + ".tmp", d->m_path)) {
@@ -182,12 +323,12 @@ bool DiskWriteMda::writeChunk(Mda& X, bigint i)
 {
     if (!d->m_file)
         return false;
-    fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * i, SEEK_SET);
     bigint size = X.totalSize();
     if (i + size > this->totalSize())
         size = this->totalSize() - i;
     if (size > 0) {
-        if (!mda_write_float64(X.dataPtr(), &d->m_header, size, d->m_file))
+        DiskWriteMdaCall call(d, i, size);
+        if (!call.finish(d->write_float64(X.constDataPtr(), i, size)))
             return false;
     }
     return true;
@@ -222,12 +363,12 @@ bool DiskWriteMda::writeChunk(Mda32& X, bigint i)
 {
     if (!d->m_file)
         return false;
-    fseeko(d->m_file, d->m_header.header_size + d->m_header.num_bytes_per_entry * i, SEEK_SET);
     bigint size = X.totalSize();
     if (i + size > this->totalSize())
         size = this->totalSize() - i;
     if (size > 0) {
-        return mda_write_float32(X.dataPtr(), &d->m_header, size, d->m_file);
+        DiskWriteMdaCall call(d, i, size);
+        return call.finish(d->write_float32(X.constDataPtr(), i, size));
     }
     else {
         qWarning() << "size is zero in writeChunk";
@@ -260,6 +401,69 @@ bool DiskWriteMda::writeChunk(Mda32& X, bigint i1, bigint i2, bigint i3)
     }
 }
 
+bool DiskWriteMda::writeChunk(Mda16& X, bigint i)
+{
+    if (!d->m_file)
+        return false;
+    bigint size = X.totalSize();
+    if (i + size > this->totalSize())
+        size = this->totalSize() - i;
+    if (size > 0) {
+        DiskWriteMdaCall call(d, i, size);
+        return call.finish(d->write_int16(X.constDataPtr(), i, size));
+    }
+    else {
+        qWarning() << "size is zero in writeChunk";
+        return false;
+    }
+}
+
+bool DiskWriteMda::writeChunk(Mda16& X, bigint i1, bigint i2)
+{
+    if ((X.N1() == N1()) && (i1 == 0)) {
+        return writeChunk(X, i1 + this->N1() * i2);
+    }
+    else {
+        qWarning() << "This case not yet supported in 2d writeSubArray" << X.N1() << X.N2() << N1() << N2() << i1 << i2;
+        return false;
+    }
+}
+
+bool DiskWriteMda::writeChunk(Mda16& X, bigint i1, bigint i2, bigint i3)
+{
+    if ((i3 == 0) && (X.N3() == 1))
+        return writeChunk(X, i1, i2);
+    if ((X.N1() == N1()) && (X.N2() == N2()) && (i1 == 0) && (i2 == 0)) {
+        return writeChunk(X, i1 + this->N1() * i2 + this->N1() * this->N2() * i3);
+    }
+    else {
+        qWarning() << "This case not yet supported in 3d writeSubArray" << X.N1() << X.N2() << X.N3() << N1() << N2() << N3() << i1 << i2 << i3;
+        return false;
+    }
+}
+
+bool DiskWriteMda::writeChunk(const Mda32ConstView& X, bigint i1, bigint i2)
+{
+    if (!d->m_file)
+        return false;
+    if ((X.N1() != N1()) || (i1 != 0) || (!X.isContiguous())) {
+        qWarning() << "This case not yet supported in writeChunk of a view" << X.N1() << X.N2() << X.N3() << N1() << N2() << i1 << i2;
+        return false;
+    }
+    bigint i = this->N1() * i2;
+    bigint size = X.totalSize();
+    if (i + size > this->totalSize())
+        size = this->totalSize() - i;
+    if (size > 0) {
+        DiskWriteMdaCall call(d, i, size);
+        return call.finish(d->write_float32(X.dataPtr(), i, size));
+    }
+    else {
+        qWarning() << "size is zero in writeChunk";
+        return false;
+    }
+}
+
 int DiskWriteMdaPrivate::determine_ndims(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
 {
 #ifdef QT_CORE_LIB
@@ -276,3 +480,144 @@ int DiskWriteMdaPrivate::determine_ndims(bigint N1, bigint N2, bigint N3, bigint
         return 3;
     return 2;
 }
+
+bool DiskWriteMdaPrivate::set_file_size(bigint num_bytes)
+{
+#ifndef _WIN32
+    if (ftruncate(fileno(m_file), num_bytes) == 0)
+        return true;
+#endif
+    //fall back to writing zeros up to the end of the file
+    fseeko(m_file, 0, SEEK_END);
+    bigint pos = ftello(m_file);
+    if (pos > num_bytes)
+        return false;
+    bigint buf_size = 1e6;
+    unsigned char* zeros = (unsigned char*)calloc(buf_size, 1);
+    while (pos < num_bytes) {
+        bigint num_to_write = qMin(buf_size, num_bytes - pos);
+        if (fwrite(zeros, 1, num_to_write, m_file) != (size_t)num_to_write) {
+            free(zeros);
+            return false;
+        }
+        pos += num_to_write;
+    }
+    free(zeros);
+    fflush(m_file);
+    return true;
+}
+
+bigint DiskWriteMdaPrivate::data_end() const
+{
+    bigint NN = 1;
+    for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+        NN *= m_header.dims[i];
+    return m_header.header_size + m_header.num_bytes_per_entry * NN;
+}
+
+void DiskWriteMdaPrivate::open_direct_fd(const QString& fname)
+{
+    m_direct_refused = 0;
+    m_direct_fd = mda_open_direct(fname.toLatin1().data(), true);
+    if (m_direct_fd < 0)
+        qWarning() << "Direct I/O is not available, using regular writes:" << fname;
+}
+
+void DiskWriteMdaPrivate::close_direct_fd()
+{
+#ifndef _WIN32
+    if (m_direct_fd >= 0)
+        ::close(m_direct_fd);
+#endif
+    m_direct_fd = -1;
+}
+
+bool DiskWriteMdaPrivate::use_direct_fd() const
+{
+    return ((m_direct_fd >= 0) && (!m_direct_refused.load()));
+}
+
+void DiskWriteMdaPrivate::find_counters()
+{
+    ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
+    if (manager) {
+        bytesWrittenCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_written"));
+        writeLatencyCounter = qobject_cast<ILatencyCounter*>(manager->counter("write_latency"));
+    }
+}
+
+bool DiskWriteMdaPrivate::write_float32(const float* data, bigint i, bigint size)
+{
+    if (m_stream)
+        return m_stream->writeFloat32(data, i, size);
+    if ((m_append_only) || (m_mdaz)) {
+        if (i != m_append_position) {
+            qWarning() << "DiskWriteMda is append-only, but chunk does not start at the end of the data written so far:" << i << m_append_position;
+            return false;
+        }
+        m_append_position += size;
+        if (m_mdaz)
+            return m_mdaz->writeFloat32(data, size);
+        return (mda_write_float32(data, &m_header, size, m_file) == size);
+    }
+    bigint offset = m_header.header_size + m_header.num_bytes_per_entry * i;
+    if (use_direct_fd()) {
+        bool refused = false;
+        bigint ret = mda_pwrite_direct_float32(data, &m_header, size, m_direct_fd, fileno(m_file), offset, &refused);
+        if (refused)
+            m_direct_refused = 1;
+        return (ret == size);
+    }
+    return (mda_pwrite_float32(data, &m_header, size, fileno(m_file), offset) == size);
+}
+
+bool DiskWriteMdaPrivate::write_float64(const double* data, bigint i, bigint size)
+{
+    if (m_stream)
+        return m_stream->writeFloat64(data, i, size);
+    if ((m_append_only) || (m_mdaz)) {
+        if (i != m_append_position) {
+            qWarning() << "DiskWriteMda is append-only, but chunk does not start at the end of the data written so far:" << i << m_append_position;
+            return false;
+        }
+        m_append_position += size;
+        if (m_mdaz)
+            return m_mdaz->writeFloat64(data, size);
+        return (mda_write_float64((double*)data, &m_header, size, m_file) == size);
+    }
+    bigint offset = m_header.header_size + m_header.num_bytes_per_entry * i;
+    if (use_direct_fd()) {
+        bool refused = false;
+        bigint ret = mda_pwrite_direct_float64(data, &m_header, size, m_direct_fd, fileno(m_file), offset, &refused);
+        if (refused)
+            m_direct_refused = 1;
+        return (ret == size);
+    }
+    return (mda_pwrite_float64(data, &m_header, size, fileno(m_file), offset) == size);
+}
+
+bool DiskWriteMdaPrivate::write_int16(const int16_t* data, bigint i, bigint size)
+{
+    if ((!m_stream) && (!m_mdaz) && (!use_direct_fd())) {
+        if (m_append_only) {
+            if (i != m_append_position) {
+                qWarning() << "DiskWriteMda is append-only, but chunk does not start at the end of the data written so far:" << i << m_append_position;
+                return false;
+            }
+            m_append_position += size;
+            return (mda_write_int16((int16_t*)data, &m_header, size, m_file) == size);
+        }
+        bigint offset = m_header.header_size + m_header.num_bytes_per_entry * i;
+        return (mda_pwrite_int16(data, &m_header, size, fileno(m_file), offset) == size);
+    }
+    //streams, .mdaz and direct I/O take float32, so widen a block at a time
+    const bigint block_size = 1 << 18;
+    std::vector<float> tmp(qMin(size, block_size));
+    for (bigint j = 0; j < size; j += block_size) {
+        bigint num = qMin(block_size, size - j);
+        std::copy(data + j, data + j + num, tmp.begin());
+        if (!write_float32(tmp.data(), i + j, num))
+            return false;
+    }
+    return true;
+}
@@ -24,7 +24,7 @@ static void* malloc_aligned(const int alignValue, const bigint nbytes)
 void* allocate(bigint nbytes)
 {
 #ifdef USE_SSE2
-    return malloc_aligned(16, nbytes);
+    return malloc_aligned(MDAPOOL_ALIGNMENT, nbytes);
 #else
     return malloc(nbytes);
 #endif
@@ -64,6 +64,16 @@ bool Mda::allocate(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint
     return d->allocate(0, N1, N2, N3, N4, N5, N6);
 }
 
+void Mda::setExternalData(const double* data, const QSharedPointer<MdaMemoryMap>& mapping, bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
+{
+    d->setExternalData((double*)data, mapping, N1, N2, N3, N4, N5, N6);
+}
+
+bool Mda::hasExternalData() const
+{
+    return d->hasExternalData();
+}
+
 bool Mda::allocateFill(double value, bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
 {
     return d->allocate(value, N1, N2, N3, N4, N5, N6);
@@ -631,6 +641,26 @@ void Mda::getChunk(Mda& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigi
     }
 }
 
+bool Mda::getChunk(MdaConstView& ret, bigint i1, bigint i2, bigint size1, bigint size2) const
+{
+    return mda_sub_view(ret, this->constDataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, 0, size1, size2, 1);
+}
+
+bool Mda::getChunk(MdaConstView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const
+{
+    return mda_sub_view(ret, this->constDataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
+bool Mda::getChunk(MdaView& ret, bigint i1, bigint i2, bigint size1, bigint size2)
+{
+    return mda_sub_view(ret, this->dataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, 0, size1, size2, 1);
+}
+
+bool Mda::getChunk(MdaView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3)
+{
+    return mda_sub_view(ret, this->dataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
 void Mda::setChunk(Mda& X, bigint i)
 {
     bigint size = X.totalSize();
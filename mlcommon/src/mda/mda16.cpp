@@ -0,0 +1,274 @@
+#include "mda16.h"
+#include "mda_p.h"
+#include "mdaio.h"
+#include <stdio.h>
+#include <algorithm>
+
+class MdaDataInt16 : public MdaData<int16_t> {
+};
+
+Mda16::Mda16(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
+{
+    d = new MdaDataInt16;
+    this->allocate(N1, N2, N3, N4, N5, N6);
+}
+
+Mda16::Mda16(const QString mda_filename)
+{
+    d = new MdaDataInt16;
+    this->read(mda_filename);
+}
+
+Mda16::Mda16(const Mda16& other)
+{
+    d = other.d;
+}
+
+void Mda16::operator=(const Mda16& other)
+{
+    d = other.d;
+}
+
+Mda16::~Mda16()
+{
+}
+
+bool Mda16::allocate(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
+{
+    return d->allocate((dtype16)0, N1, N2, N3, N4, N5, N6);
+}
+
+bool Mda16::read(const QString& path)
+{
+    FILE* input_file = fopen(path.toLatin1().data(), "rb");
+    if (!input_file) {
+        printf("Warning: Unable to open mda file for reading: %s\n", path.toLatin1().data());
+        return false;
+    }
+    MDAIO_HEADER H;
+    if (!mda_read_header(&H, input_file)) {
+        qWarning() << "Problem reading mda file: " + path;
+        fclose(input_file);
+        return false;
+    }
+    this->allocate(H.dims[0], H.dims[1], H.dims[2], H.dims[3], H.dims[4], H.dims[5]);
+    mda_read_int16(d->data(), &H, d->totalSize(), input_file);
+    d->incrementBytesReadCounter(d->totalSize() * H.num_bytes_per_entry);
+    fclose(input_file);
+    return true;
+}
+
+static bool write_mda16(const MdaDataInt16* d, const QString& path, int data_type, int num_dims)
+{
+    FILE* output_file = fopen(path.toLatin1().data(), "wb");
+    if (!output_file) {
+        printf("Warning: Unable to open mda file for writing: %s\n", path.toLatin1().data());
+        return false;
+    }
+    MDAIO_HEADER H;
+    H.data_type = data_type;
+    H.num_bytes_per_entry = mda_get_num_bytes_per_entry(data_type);
+    for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+        H.dims[i] = 1;
+    for (int i = 0; i < MDA_MAX_DIMS; i++)
+        H.dims[i] = d->dims(i);
+    H.num_dims = num_dims;
+    mda_write_header(&H, output_file);
+    bigint num = mda_write_int16((int16_t*)d->constData(), &H, d->totalSize(), output_file);
+    fclose(output_file);
+    return (num == d->totalSize());
+}
+
+bool Mda16::write16(const QString& path) const
+{
+    return write_mda16(d.constData(), path, MDAIO_TYPE_INT16, ndims());
+}
+
+bool Mda16::write32(const QString& path) const
+{
+    return write_mda16(d.constData(), path, MDAIO_TYPE_FLOAT32, ndims());
+}
+
+int Mda16::ndims() const
+{
+    return d->determine_num_dims(N1(), N2(), N3(), N4(), N5(), N6());
+}
+
+bigint Mda16::N1() const
+{
+    return d->dims(0);
+}
+
+bigint Mda16::N2() const
+{
+    return d->dims(1);
+}
+
+bigint Mda16::N3() const
+{
+    return d->dims(2);
+}
+
+bigint Mda16::N4() const
+{
+    return d->dims(3);
+}
+
+bigint Mda16::N5() const
+{
+    return d->dims(4);
+}
+
+bigint Mda16::N6() const
+{
+    return d->dims(5);
+}
+
+bigint Mda16::totalSize() const
+{
+    return d->totalSize();
+}
+
+dtype16 Mda16::get(bigint i) const
+{
+    return d->at(i);
+}
+
+dtype16 Mda16::get(bigint i1, bigint i2) const
+{
+    return d->at(i1 + d->dims(0) * i2);
+}
+
+dtype16 Mda16::get(bigint i1, bigint i2, bigint i3) const
+{
+    return d->at(i1 + d->dims(0) * i2 + d->dims(0) * d->dims(1) * i3);
+}
+
+void Mda16::set(dtype16 val, bigint i)
+{
+    d->set(val, i);
+}
+
+void Mda16::set(dtype16 val, bigint i1, bigint i2)
+{
+    d->set(val, i1 + d->dims(0) * i2);
+}
+
+void Mda16::set(dtype16 val, bigint i1, bigint i2, bigint i3)
+{
+    d->set(val, i1 + d->dims(0) * i2 + d->dims(0) * d->dims(1) * i3);
+}
+
+dtype16 Mda16::value(bigint i) const
+{
+    if (!d->safe_index(i))
+        return 0;
+    return get(i);
+}
+
+dtype16 Mda16::value(bigint i1, bigint i2) const
+{
+    if (!d->safe_index(i1, i2))
+        return 0;
+    return get(i1, i2);
+}
+
+dtype16 Mda16::value(bigint i1, bigint i2, bigint i3) const
+{
+    if (!d->safe_index(i1, i2, i3))
+        return 0;
+    return get(i1, i2, i3);
+}
+
+void Mda16::setValue(dtype16 val, bigint i)
+{
+    if (!d->safe_index(i))
+        return;
+    set(val, i);
+}
+
+void Mda16::setValue(dtype16 val, bigint i1, bigint i2)
+{
+    if (!d->safe_index(i1, i2))
+        return;
+    set(val, i1, i2);
+}
+
+void Mda16::setValue(dtype16 val, bigint i1, bigint i2, bigint i3)
+{
+    if (!d->safe_index(i1, i2, i3))
+        return;
+    set(val, i1, i2, i3);
+}
+
+dtype16* Mda16::dataPtr()
+{
+    return d->data();
+}
+
+const dtype16* Mda16::constDataPtr() const
+{
+    return d->constData();
+}
+
+dtype16* Mda16::dataPtr(bigint i)
+{
+    return d->data() + i;
+}
+
+dtype16* Mda16::dataPtr(bigint i1, bigint i2)
+{
+    return d->data() + (i1 + N1() * i2);
+}
+
+dtype16* Mda16::dataPtr(bigint i1, bigint i2, bigint i3)
+{
+    return d->data() + (i1 + N1() * i2 + N1() * N2() * i3);
+}
+
+void Mda16::getChunk(Mda16& ret, bigint i1, bigint i2, bigint size1, bigint size2) const
+{
+    ret.allocate(size1, size2);
+    bigint a1_begin = qMax(i1, (bigint)0);
+    bigint a1_end = qMin(i1 + size1, N1());
+    bigint a2_begin = qMax(i2, (bigint)0);
+    bigint a2_end = qMin(i2 + size2, N2());
+    if ((a1_begin >= a1_end) || (a2_begin >= a2_end))
+        return;
+    const dtype16* ptr1 = this->constDataPtr();
+    dtype16* ptr2 = ret.dataPtr();
+    for (bigint a2 = a2_begin; a2 < a2_end; a2++) {
+        const dtype16* src = ptr1 + a1_begin + N1() * a2;
+        std::copy(src, src + (a1_end - a1_begin), ptr2 + (a1_begin - i1) + size1 * (a2 - i2));
+    }
+}
+
+bool Mda16::getChunk(Mda16ConstView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const
+{
+    return mda_sub_view(ret, this->constDataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
+bool Mda16::getChunk(Mda16View& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3)
+{
+    return mda_sub_view(ret, this->dataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
+dtype16 Mda16::minimum() const
+{
+    bigint NN = this->totalSize();
+    const dtype16* ptr = this->constDataPtr();
+    if ((!NN) || (!ptr)) {
+        return 0;
+    }
+    return *std::min_element(ptr, ptr + NN);
+}
+
+dtype16 Mda16::maximum() const
+{
+    bigint NN = this->totalSize();
+    const dtype16* ptr = this->constDataPtr();
+    if ((!NN) || (!ptr)) {
+        return 0;
+    }
+    return *std::max_element(ptr, ptr + NN);
+}
@@ -46,6 +46,16 @@ bool Mda32::allocate(bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigi
     return d->allocate((float)0, N1, N2, N3, N4, N5, N6);
 }
 
+void Mda32::setExternalData(const dtype32* data, const QSharedPointer<MdaMemoryMap>& mapping, bigint N1, bigint N2, bigint N3, bigint N4, bigint N5, bigint N6)
+{
+    d->setExternalData((dtype32*)data, mapping, N1, N2, N3, N4, N5, N6);
+}
+
+bool Mda32::hasExternalData() const
+{
+    return d->hasExternalData();
+}
+
 bool Mda32::read(const QString& path)
 {
     return read(path.toLatin1().data());
@@ -514,6 +524,26 @@ void Mda32::getChunk(Mda32& ret, bigint i1, bigint i2, bigint i3, bigint size1,
     }
 }
 
+bool Mda32::getChunk(Mda32ConstView& ret, bigint i1, bigint i2, bigint size1, bigint size2) const
+{
+    return mda_sub_view(ret, this->constDataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, 0, size1, size2, 1);
+}
+
+bool Mda32::getChunk(Mda32ConstView& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3) const
+{
+    return mda_sub_view(ret, this->constDataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
+bool Mda32::getChunk(Mda32View& ret, bigint i1, bigint i2, bigint size1, bigint size2)
+{
+    return mda_sub_view(ret, this->dataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, 0, size1, size2, 1);
+}
+
+bool Mda32::getChunk(Mda32View& ret, bigint i1, bigint i2, bigint i3, bigint size1, bigint size2, bigint size3)
+{
+    return mda_sub_view(ret, this->dataPtr(), N1(), N2(), N3() * N4() * N5() * N6(), i1, i2, i3, size1, size2, size3);
+}
+
 void Mda32::setChunk(Mda32& X, bigint i)
 {
     bigint size = X.totalSize();
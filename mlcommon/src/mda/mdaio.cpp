@@ -1,8 +1,13 @@
 #include "mdaio.h"
 #include "usagetracking.h"
+#include "mdaioconvert_p.h"
 #include <vector>
 #include <cstring>
 #include <inttypes.h>
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 //can be replaced by std::is_same when C++11 is enabled
 template <class T, class U>
@@ -18,6 +23,55 @@ struct is_same<T, T> {
     };
 };
 
+template <typename T>
+struct mda_type_code {
+    enum {
+        value = 0
+    };
+};
+template <>
+struct mda_type_code<unsigned char> {
+    enum {
+        value = MDAIO_TYPE_BYTE
+    };
+};
+template <>
+struct mda_type_code<float> {
+    enum {
+        value = MDAIO_TYPE_FLOAT32
+    };
+};
+template <>
+struct mda_type_code<int16_t> {
+    enum {
+        value = MDAIO_TYPE_INT16
+    };
+};
+template <>
+struct mda_type_code<int32_t> {
+    enum {
+        value = MDAIO_TYPE_INT32
+    };
+};
+template <>
+struct mda_type_code<uint16_t> {
+    enum {
+        value = MDAIO_TYPE_UINT16
+    };
+};
+template <>
+struct mda_type_code<double> {
+    enum {
+        value = MDAIO_TYPE_FLOAT64
+    };
+};
+template <>
+struct mda_type_code<uint32_t> {
+    enum {
+        value = MDAIO_TYPE_UINT32
+    };
+};
+
 int mda_get_num_bytes_per_entry(int data_type)
 {
     int num_bytes_per_entry = 0;
@@ -193,9 +247,20 @@ bigint mdaReadData_impl(TargetType* data, const bigint size, FILE* inputFile)
         return jfread(data, sizeof(SourceType), size, inputFile);
     }
     else {
-        std::vector<SourceType> tmp(size);
-        const bigint ret = jfread(&tmp[0], sizeof(SourceType), size, inputFile);
-        std::copy(tmp.begin(), tmp.end(), data);
+        //read and convert a block at a time through the staging buffer of this thread
+        const bigint block_size = MDAIO_STAGING_BUFFER_BYTES / sizeof(SourceType);
+        SourceType* tmp = (SourceType*)mdaio_staging_buffer(block_size * sizeof(SourceType));
+        if (!tmp)
+            return 0;
+        bigint ret = 0;
+        while (ret < size) {
+            const bigint num_to_read = std::min(block_size, size - ret);
+            const bigint num = jfread(tmp, sizeof(SourceType), num_to_read, inputFile);
+            mdaio_convert(data + ret, tmp, num);
+            ret += num;
+            if (num < num_to_read)
+                break;
+        }
         return ret;
     }
 }
@@ -235,9 +300,20 @@ bigint mdaWriteData_impl(DataType* data, const bigint size, FILE* outputFile)
         return fwrite(data, sizeof(DataType), size, outputFile);
     }
     else {
-        std::vector<TargetType> tmp(size);
-        std::copy(data, data + size, tmp.begin());
-        return fwrite(&tmp[0], sizeof(TargetType), size, outputFile);
+        const bigint block_size = MDAIO_STAGING_BUFFER_BYTES / sizeof(TargetType);
+        TargetType* tmp = (TargetType*)mdaio_staging_buffer(block_size * sizeof(TargetType));
+        if (!tmp)
+            return 0;
+        bigint ret = 0;
+        while (ret < size) {
+            const bigint num = std::min(block_size, size - ret);
+            mdaio_convert(tmp, data + ret, num);
+            const bigint num_written = fwrite(tmp, sizeof(TargetType), num, outputFile);
+            ret += num_written;
+            if (num_written < num)
+                break;
+        }
+        return ret;
     }
 }
 
@@ -269,6 +345,284 @@ bigint mdaWriteData(DataType* data, const bigint size, const struct MDAIO_HEADER
         return 0;
 }
 
+template <typename SourceType, typename TargetType>
+bigint mdaConvertData_impl(TargetType* data, const void* raw, const bigint size)
+{
+    const unsigned char* bytes = (const unsigned char*)raw;
+    if (((uintptr_t)bytes) % sizeof(SourceType) == 0) {
+        mdaio_convert(data, (const SourceType*)bytes, size);
+    }
+    else {
+        //the header size is not always a multiple of the entry size, so go through a small aligned buffer
+        const bigint block_size = 1024;
+        SourceType tmp[block_size];
+        for (bigint i = 0; i < size; i += block_size) {
+            bigint num = std::min(block_size, size - i);
+            std::memcpy(tmp, bytes + i * sizeof(SourceType), num * sizeof(SourceType));
+            mdaio_convert(data + i, tmp, num);
+        }
+    }
+    return size;
+}
+
+template <typename Type>
+bigint mdaConvertData(Type* data, const struct MDAIO_HEADER* header, const void* raw, const bigint size)
+{
+    if (header->data_type == MDAIO_TYPE_BYTE) {
+        return mdaConvertData_impl<unsigned char>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_FLOAT32) {
+        return mdaConvertData_impl<float>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_INT16) {
+        return mdaConvertData_impl<int16_t>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_INT32) {
+        return mdaConvertData_impl<int32_t>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_UINT16) {
+        return mdaConvertData_impl<uint16_t>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_FLOAT64) {
+        return mdaConvertData_impl<double>(data, raw, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_UINT32) {
+        return mdaConvertData_impl<uint32_t>(data, raw, size);
+    }
+    else
+        return 0;
+}
+
+template <typename TargetType, typename DataType>
+void mdaConvertToRaw_impl(void* raw, const DataType* data, const bigint size)
+{
+    mdaio_convert((TargetType*)raw, data, size);
+}
+
+template <typename DataType>
+bool mdaConvertToRaw(void* raw, const struct MDAIO_HEADER* header, const DataType* data, const bigint size)
+{
+    if (header->data_type == MDAIO_TYPE_BYTE) {
+        mdaConvertToRaw_impl<unsigned char>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_FLOAT32) {
+        mdaConvertToRaw_impl<float>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_INT16) {
+        mdaConvertToRaw_impl<int16_t>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_INT32) {
+        mdaConvertToRaw_impl<int32_t>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_UINT16) {
+        mdaConvertToRaw_impl<uint16_t>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_FLOAT64) {
+        mdaConvertToRaw_impl<double>(raw, data, size);
+    }
+    else if (header->data_type == MDAIO_TYPE_UINT32) {
+        mdaConvertToRaw_impl<uint32_t>(raw, data, size);
+    }
+    else
+        return false;
+    return true;
+}
+
+static bigint mda_pread_bytes(void* buf, bigint num_bytes, int fd, bigint offset)
+{
+    unsigned char* ptr = (unsigned char*)buf;
+    bigint total = 0;
+    while (total < num_bytes) {
+        ssize_t ret = pread(fd, ptr + total, num_bytes - total, offset + total);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (ret == 0)
+            break; //end of file
+        total += ret;
+    }
+    return total;
+}
+
+static bigint mda_pwrite_bytes(const void* buf, bigint num_bytes, int fd, bigint offset)
+{
+    const unsigned char* ptr = (const unsigned char*)buf;
+    bigint total = 0;
+    while (total < num_bytes) {
+        ssize_t ret = pwrite(fd, ptr + total, num_bytes - total, offset + total);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        total += ret;
+    }
+    return total;
+}
+
+template <typename Type>
+bigint mdaPreadData(Type* data, const struct MDAIO_HEADER* header, const bigint size, int fd, bigint offset)
+{
+    bigint num_bytes_per_entry = mda_get_num_bytes_per_entry(header->data_type);
+    if (!num_bytes_per_entry)
+        return 0;
+    if (header->data_type == mda_type_code<Type>::value) {
+        return mda_pread_bytes(data, size * num_bytes_per_entry, fd, offset) / num_bytes_per_entry;
+    }
+    const bigint block_size = MDAIO_STAGING_BUFFER_BYTES / num_bytes_per_entry;
+    unsigned char* tmp = mdaio_staging_buffer(block_size * num_bytes_per_entry);
+    if (!tmp)
+        return 0;
+    bigint ret = 0;
+    while (ret < size) {
+        const bigint num_to_read = std::min(block_size, size - ret);
+        const bigint num = mda_pread_bytes(tmp, num_to_read * num_bytes_per_entry, fd, offset + ret * num_bytes_per_entry) / num_bytes_per_entry;
+        mdaConvertData(data + ret, header, tmp, num);
+        ret += num;
+        if (num < num_to_read)
+            break;
+    }
+    return ret;
+}
+
+template <typename Type>
+bigint mdaPwriteData(const Type* data, const struct MDAIO_HEADER* header, const bigint size, int fd, bigint offset)
+{
+    bigint num_bytes_per_entry = mda_get_num_bytes_per_entry(header->data_type);
+    if (!num_bytes_per_entry)
+        return 0;
+    if (header->data_type == mda_type_code<Type>::value) {
+        return mda_pwrite_bytes(data, size * num_bytes_per_entry, fd, offset) / num_bytes_per_entry;
+    }
+    const bigint block_size = MDAIO_STAGING_BUFFER_BYTES / num_bytes_per_entry;
+    unsigned char* tmp = mdaio_staging_buffer(block_size * num_bytes_per_entry);
+    if (!tmp)
+        return 0;
+    bigint ret = 0;
+    while (ret < size) {
+        const bigint num_to_write = std::min(block_size, size - ret);
+        if (!mdaConvertToRaw(tmp, header, data + ret, num_to_write))
+            return ret;
+        const bigint num = mda_pwrite_bytes(tmp, num_to_write * num_bytes_per_entry, fd, offset + ret * num_bytes_per_entry) / num_bytes_per_entry;
+        ret += num;
+        if (num < num_to_write)
+            break;
+    }
+    return ret;
+}
+
+//a single pread/pwrite on a direct descriptor, retried on EINTR. Returns -1 (with errno set) if the first call fails
+static bigint mda_direct_transfer(void* buf, bigint num_bytes, int fd, bigint offset, bool for_writing)
+{
+    unsigned char* ptr = (unsigned char*)buf;
+    bigint total = 0;
+    while (total < num_bytes) {
+        ssize_t ret = for_writing ? pwrite(fd, ptr + total, num_bytes - total, offset + total) : pread(fd, ptr + total, num_bytes - total, offset + total);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            if (total == 0)
+                return -1;
+            break;
+        }
+        if (ret == 0)
+            break; //end of file
+        total += ret;
+        if (total % MDAIO_DIRECT_ALIGNMENT)
+            break; //short read at the end of the file, the remainder can't be requested with an aligned offset
+    }
+    return total;
+}
+
+template <typename Type>
+bigint mdaPreadDirectData(Type* data, const struct MDAIO_HEADER* header, const bigint size, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    bigint num_bytes_per_entry = mda_get_num_bytes_per_entry(header->data_type);
+    if (!num_bytes_per_entry)
+        return 0;
+    unsigned char* buf = mdaio_staging_buffer(MDAIO_DIRECT_BLOCK_BYTES);
+    if ((direct_fd < 0) || (!buf))
+        return mdaPreadData(data, header, size, fd, offset);
+    bigint ret = 0;
+    while (ret < size) {
+        //read the aligned superset of (at most a block of) whole entries
+        const bigint pstart = offset + ret * num_bytes_per_entry;
+        const bigint a = pstart - pstart % MDAIO_DIRECT_ALIGNMENT;
+        const bigint num = std::min(size - ret, (a + MDAIO_DIRECT_BLOCK_BYTES - pstart) / num_bytes_per_entry);
+        const bigint pend = pstart + num * num_bytes_per_entry;
+        const bigint b = ((pend + MDAIO_DIRECT_ALIGNMENT - 1) / MDAIO_DIRECT_ALIGNMENT) * MDAIO_DIRECT_ALIGNMENT;
+        bigint got = mda_direct_transfer(buf, b - a, direct_fd, a, false);
+        if (got < 0) {
+            if (errno != EINVAL)
+                return ret;
+            //the filesystem does not support direct I/O: read normally and drop the pages behind us
+            if (refused)
+                *refused = true;
+            bigint num2 = mdaPreadData(data + ret, header, size - ret, fd, pstart);
+            mda_drop_cache(fd, pstart, num2 * num_bytes_per_entry);
+            return ret + num2;
+        }
+        const bigint num_got = std::max((bigint)0, std::min(num, (got - (pstart - a)) / num_bytes_per_entry));
+        mdaConvertData(data + ret, header, buf + (pstart - a), num_got);
+        ret += num_got;
+        if (num_got < num)
+            break;
+    }
+    return ret;
+}
+
+template <typename Type>
+bigint mdaPwriteDirectData(const Type* data, const struct MDAIO_HEADER* header, const bigint size, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    bigint num_bytes_per_entry = mda_get_num_bytes_per_entry(header->data_type);
+    if (!num_bytes_per_entry)
+        return 0;
+    unsigned char* buf = mdaio_staging_buffer(MDAIO_DIRECT_BLOCK_BYTES);
+    if ((direct_fd < 0) || (!buf))
+        return mdaPwriteData(data, header, size, fd, offset);
+    bigint ret = 0;
+    while (ret < size) {
+        //convert (at most a block of) whole entries into the buffer at the same alignment as in the file
+        const bigint pstart = offset + ret * num_bytes_per_entry;
+        const bigint a = pstart - pstart % MDAIO_DIRECT_ALIGNMENT;
+        const bigint num = std::min(size - ret, (a + MDAIO_DIRECT_BLOCK_BYTES - pstart) / num_bytes_per_entry);
+        const bigint pend = pstart + num * num_bytes_per_entry;
+        if (!mdaConvertToRaw(buf + (pstart - a), header, data + ret, num))
+            return ret;
+        //the aligned interior goes through the direct descriptor, the partial pages at either end through the regular one
+        const bigint lo = (pstart == a) ? a : a + MDAIO_DIRECT_ALIGNMENT;
+        const bigint hi = pend - pend % MDAIO_DIRECT_ALIGNMENT;
+        const bigint head_end = std::min(lo, pend);
+        if (head_end > pstart) {
+            if (mda_pwrite_bytes(buf + (pstart - a), head_end - pstart, fd, pstart) != head_end - pstart)
+                return ret;
+        }
+        if (hi > lo) {
+            bigint written = mda_direct_transfer(buf + (lo - a), hi - lo, direct_fd, lo, true);
+            if ((written < 0) && (errno == EINVAL)) {
+                //the filesystem does not support direct I/O: write normally and drop the pages behind us
+                if (refused)
+                    *refused = true;
+                bigint num2 = mdaPwriteData(data + ret, header, size - ret, fd, pstart);
+                fdatasync(fd);
+                mda_drop_cache(fd, pstart, num2 * num_bytes_per_entry);
+                return ret + num2;
+            }
+            if (written != hi - lo)
+                return ret;
+        }
+        const bigint tail_start = std::max(hi, head_end);
+        if (pend > tail_start) {
+            if (mda_pwrite_bytes(buf + (tail_start - a), pend - tail_start, fd, tail_start) != pend - tail_start)
+                return ret;
+        }
+        ret += num;
+    }
+    return ret;
+}
+
 bigint mda_read_byte(unsigned char* data, struct MDAIO_HEADER* H, bigint n, FILE* input_file)
 {
     return mdaReadData(data, H, n, input_file);
@@ -339,6 +693,107 @@ bigint mda_write_uint32(uint32_t* data, struct MDAIO_HEADER* H, bigint n, FILE*
     return mdaWriteData(data, n, H, output_file);
 }
 
+bigint mda_convert_float32(float* data, const struct MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    return mdaConvertData(data, H, raw, n);
+}
+
+bigint mda_convert_float64(double* data, const struct MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    return mdaConvertData(data, H, raw, n);
+}
+
+bool mda_convert_to_raw_float32(void* raw, const struct MDAIO_HEADER* H, const float* data, bigint n)
+{
+    return mdaConvertToRaw(raw, H, data, n);
+}
+
+bool mda_convert_to_raw_float64(void* raw, const struct MDAIO_HEADER* H, const double* data, bigint n)
+{
+    return mdaConvertToRaw(raw, H, data, n);
+}
+
+bigint mda_pread_float32(float* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPreadData(data, H, n, fd, offset);
+}
+
+bigint mda_pread_float64(double* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPreadData(data, H, n, fd, offset);
+}
+
+bigint mda_pwrite_float32(const float* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPwriteData(data, H, n, fd, offset);
+}
+
+bigint mda_pwrite_float64(const double* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPwriteData(data, H, n, fd, offset);
+}
+
+bigint mda_pread_int16(int16_t* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPreadData(data, H, n, fd, offset);
+}
+
+bigint mda_pwrite_int16(const int16_t* data, const struct MDAIO_HEADER* H, bigint n, int fd, bigint offset)
+{
+    return mdaPwriteData(data, H, n, fd, offset);
+}
+
+int mda_open_direct(const char* path, bool for_writing)
+{
+    int flags = for_writing ? O_WRONLY : O_RDONLY;
+#if defined(O_DIRECT)
+    return open(path, flags | O_DIRECT);
+#elif defined(F_NOCACHE)
+    int fd = open(path, flags);
+    if ((fd >= 0) && (fcntl(fd, F_NOCACHE, 1) != 0)) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void)path;
+    (void)flags;
+    return -1;
+#endif
+}
+
+void mda_drop_cache(int fd, bigint offset, bigint num_bytes)
+{
+#if defined(POSIX_FADV_DONTNEED)
+    if ((fd >= 0) && (num_bytes > 0))
+        posix_fadvise(fd, offset, num_bytes, POSIX_FADV_DONTNEED);
+#else
+    (void)fd;
+    (void)offset;
+    (void)num_bytes;
+#endif
+}
+
+bigint mda_pread_direct_float32(float* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    return mdaPreadDirectData(data, H, n, direct_fd, fd, offset, refused);
+}
+
+bigint mda_pread_direct_float64(double* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    return mdaPreadDirectData(data, H, n, direct_fd, fd, offset, refused);
+}
+
+bigint mda_pwrite_direct_float32(const float* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    return mdaPwriteDirectData(data, H, n, direct_fd, fd, offset, refused);
+}
+
+bigint mda_pwrite_direct_float64(const double* data, const struct MDAIO_HEADER* H, bigint n, int direct_fd, int fd, bigint offset, bool* refused)
+{
+    return mdaPwriteDirectData(data, H, n, direct_fd, fd, offset, refused);
+}
+
 void mda_copy_header(struct MDAIO_HEADER* ret, const struct MDAIO_HEADER* X)
 {
     std::memcpy(ret, X, sizeof(*ret));
@@ -0,0 +1,382 @@
+#include "mdaioconvert_p.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MDAIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace MdaioConvert {
+struct StagingBuffer {
+    unsigned char* data = 0;
+    bigint size = 0;
+    ~StagingBuffer()
+    {
+        free(data);
+    }
+};
+}
+
+unsigned char* mdaio_staging_buffer(bigint num_bytes)
+{
+    static thread_local MdaioConvert::StagingBuffer buffer;
+    if (buffer.size < num_bytes) {
+        free(buffer.data);
+        buffer.data = 0;
+        buffer.size = 0;
+        void* ptr = 0;
+        if (posix_memalign(&ptr, MDAIO_STAGING_BUFFER_ALIGNMENT, num_bytes) != 0)
+            return 0;
+        buffer.data = (unsigned char*)ptr;
+        buffer.size = num_bytes;
+    }
+    return buffer.data;
+}
+
+namespace MdaioConvert {
+
+template <typename TargetType, typename SourceType>
+void convert_scalar(TargetType* dst, const SourceType* src, bigint n)
+{
+    for (bigint i = 0; i < n; i++)
+        dst[i] = (TargetType)src[i];
+}
+
+template <typename TargetType>
+void quantize_scalar(TargetType* dst, const float* src, bigint n, float scale)
+{
+    for (bigint i = 0; i < n; i++)
+        dst[i] = mdaio_round_saturate<TargetType>((double)(src[i] * scale));
+}
+
+#ifdef MDAIO_X86_SIMD
+
+//////////////////////////////// SSE2 ////////////////////////////////
+
+//load 4 entries as int32
+inline __m128i load4_sse2(const int16_t* src)
+{
+    __m128i x = _mm_loadl_epi64((const __m128i*)src);
+    return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+}
+
+inline __m128i load4_sse2(const uint16_t* src)
+{
+    return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)src), _mm_setzero_si128());
+}
+
+inline __m128i load4_sse2(const int32_t* src)
+{
+    return _mm_loadu_si128((const __m128i*)src);
+}
+
+template <typename SourceType>
+void to_float_sse2(float* dst, const SourceType* src, bigint n)
+{
+    bigint i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(load4_sse2(src + i)));
+    convert_scalar(dst + i, src + i, n - i);
+}
+
+template <typename SourceType>
+void to_double_sse2(double* dst, const SourceType* src, bigint n)
+{
+    bigint i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = load4_sse2(src + i);
+        _mm_storeu_pd(dst + i, _mm_cvtepi32_pd(x));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtepi32_pd(_mm_srli_si128(x, 8)));
+    }
+    convert_scalar(dst + i, src + i, n - i);
+}
+
+//scale, clamp to [lo,hi] and round (the conversion uses the current rounding mode, which is round to nearest)
+inline __m128i round4_sse2(const float* src, __m128 scale, __m128 lo, __m128 hi)
+{
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(src), scale);
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, lo), hi));
+}
+
+void quantize_int16_sse2(int16_t* dst, const float* src, bigint n, float scale)
+{
+    __m128 s = _mm_set1_ps(scale), lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+    bigint i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = round4_sse2(src + i, s, lo, hi);
+        __m128i b = round4_sse2(src + i + 4, s, lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+    }
+    quantize_scalar(dst + i, src + i, n - i, scale);
+}
+
+void quantize_uint16_sse2(int16_t* dst, const float* src, bigint n, float scale)
+{
+    //SSE2 has no unsigned pack, so shift into the signed range and flip the sign bit afterwards
+    __m128 s = _mm_set1_ps(scale), lo = _mm_set1_ps(0.0f), hi = _mm_set1_ps(65535.0f);
+    __m128i offset = _mm_set1_epi32(32768);
+    __m128i flip = _mm_set1_epi16((short)0x8000);
+    bigint i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_sub_epi32(round4_sse2(src + i, s, lo, hi), offset);
+        __m128i b = _mm_sub_epi32(round4_sse2(src + i + 4, s, lo, hi), offset);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi32(a, b), flip));
+    }
+    quantize_scalar((uint16_t*)dst + i, src + i, n - i, scale);
+}
+
+void quantize_int32_sse2(int32_t* dst, const float* src, bigint n, float scale)
+{
+    //out of range converts to 0x80000000, which is right for large negatives; for large positives the xor with the comparison mask makes it 0x7fffffff
+    __m128 s = _mm_set1_ps(scale), hi = _mm_set1_ps(2147483648.0f);
+    bigint i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), s);
+        __m128i r = _mm_xor_si128(_mm_cvtps_epi32(x), _mm_castps_si128(_mm_cmpge_ps(x, hi)));
+        _mm_storeu_si128((__m128i*)(dst + i), r);
+    }
+    quantize_scalar(dst + i, src + i, n - i, scale);
+}
+
+//////////////////////////////// AVX2 ////////////////////////////////
+
+//load 8 entries as int32
+__attribute__((target("avx2"))) inline __m256i load8_avx2(const int16_t* src)
+{
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)src));
+}
+
+__attribute__((target("avx2"))) inline __m256i load8_avx2(const uint16_t* src)
+{
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+}
+
+__attribute__((target("avx2"))) inline __m256i load8_avx2(const int32_t* src)
+{
+    return _mm256_loadu_si256((const __m256i*)src);
+}
+
+template <typename SourceType>
+__attribute__((target("avx2"))) void to_float_avx2(float* dst, const SourceType* src, bigint n)
+{
+    bigint i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(load8_avx2(src + i)));
+    convert_scalar(dst + i, src + i, n - i);
+}
+
+template <typename SourceType>
+__attribute__((target("avx2"))) void to_double_avx2(double* dst, const SourceType* src, bigint n)
+{
+    bigint i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = load8_avx2(src + i);
+        _mm256_storeu_pd(dst + i, _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)));
+        _mm256_storeu_pd(dst + i + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)));
+    }
+    convert_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i round8_avx2(const float* src, __m256 scale, __m256 lo, __m256 hi)
+{
+    __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(x, lo), hi));
+}
+
+__attribute__((target("avx2"))) void quantize_int16_avx2(int16_t* dst, const float* src, bigint n, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale), lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+    bigint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = round8_avx2(src + i, s, lo, hi);
+        __m256i b = round8_avx2(src + i + 8, s, lo, hi);
+        //the pack works within 128-bit lanes, so restore the order of the 64-bit quarters
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), p);
+    }
+    quantize_scalar(dst + i, src + i, n - i, scale);
+}
+
+__attribute__((target("avx2"))) void quantize_uint16_avx2(int16_t* dst, const float* src, bigint n, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale), lo = _mm256_set1_ps(0.0f), hi = _mm256_set1_ps(65535.0f);
+    bigint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = round8_avx2(src + i, s, lo, hi);
+        __m256i b = round8_avx2(src + i + 8, s, lo, hi);
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), p);
+    }
+    quantize_scalar((uint16_t*)dst + i, src + i, n - i, scale);
+}
+
+__attribute__((target("avx2"))) void quantize_int32_avx2(int32_t* dst, const float* src, bigint n, float scale)
+{
+    //as for SSE2
+    __m256 s = _mm256_set1_ps(scale), hi = _mm256_set1_ps(2147483648.0f);
+    bigint i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), s);
+        __m256i r = _mm256_xor_si256(_mm256_cvtps_epi32(x), _mm256_castps_si256(_mm256_cmp_ps(x, hi, _CMP_GE_OQ)));
+        _mm256_storeu_si256((__m256i*)(dst + i), r);
+    }
+    quantize_scalar(dst + i, src + i, n - i, scale);
+}
+
+#endif
+
+void quantize_int16_scalar(int16_t* dst, const float* src, bigint n, float scale)
+{
+    quantize_scalar(dst, src, n, scale);
+}
+
+void quantize_uint16_scalar(int16_t* dst, const float* src, bigint n, float scale)
+{
+    quantize_scalar((uint16_t*)dst, src, n, scale);
+}
+
+void quantize_int32_scalar(int32_t* dst, const float* src, bigint n, float scale)
+{
+    quantize_scalar(dst, src, n, scale);
+}
+
+struct Kernels {
+    const char* isa;
+    void (*int16_to_float)(float*, const int16_t*, bigint);
+    void (*uint16_to_float)(float*, const uint16_t*, bigint);
+    void (*int32_to_float)(float*, const int32_t*, bigint);
+    void (*int16_to_double)(double*, const int16_t*, bigint);
+    void (*uint16_to_double)(double*, const uint16_t*, bigint);
+    void (*int32_to_double)(double*, const int32_t*, bigint);
+    void (*quantize_int16)(int16_t*, const float*, bigint, float);
+    void (*quantize_uint16)(int16_t*, const float*, bigint, float); //int16_t* so the SSE2 and scalar versions share a signature
+    void (*quantize_int32)(int32_t*, const float*, bigint, float);
+};
+
+bool isa_matches(const char* isa, const char* name)
+{
+    return ((!isa) || (!isa[0]) || (strcmp(isa, name) == 0));
+}
+
+///The kernels of isa, or of the best instruction set available if isa is empty. Returns false if isa is not available
+bool select_kernels(Kernels& K, const char* isa)
+{
+#ifdef MDAIO_X86_SIMD
+    if ((isa_matches(isa, "avx2")) && (__builtin_cpu_supports("avx2"))) {
+        K.isa = "avx2";
+        K.int16_to_float = to_float_avx2<int16_t>;
+        K.uint16_to_float = to_float_avx2<uint16_t>;
+        K.int32_to_float = to_float_avx2<int32_t>;
+        K.int16_to_double = to_double_avx2<int16_t>;
+        K.uint16_to_double = to_double_avx2<uint16_t>;
+        K.int32_to_double = to_double_avx2<int32_t>;
+        K.quantize_int16 = quantize_int16_avx2;
+        K.quantize_uint16 = quantize_uint16_avx2;
+        K.quantize_int32 = quantize_int32_avx2;
+        return true;
+    }
+    //SSE2 is part of x86-64
+    if (isa_matches(isa, "sse2")) {
+        K.isa = "sse2";
+        K.int16_to_float = to_float_sse2<int16_t>;
+        K.uint16_to_float = to_float_sse2<uint16_t>;
+        K.int32_to_float = to_float_sse2<int32_t>;
+        K.int16_to_double = to_double_sse2<int16_t>;
+        K.uint16_to_double = to_double_sse2<uint16_t>;
+        K.int32_to_double = to_double_sse2<int32_t>;
+        K.quantize_int16 = quantize_int16_sse2;
+        K.quantize_uint16 = quantize_uint16_sse2;
+        K.quantize_int32 = quantize_int32_sse2;
+        return true;
+    }
+#endif
+    if (isa_matches(isa, "scalar")) {
+        K.isa = "scalar";
+        K.int16_to_float = convert_scalar<float, int16_t>;
+        K.uint16_to_float = convert_scalar<float, uint16_t>;
+        K.int32_to_float = convert_scalar<float, int32_t>;
+        K.int16_to_double = convert_scalar<double, int16_t>;
+        K.uint16_to_double = convert_scalar<double, uint16_t>;
+        K.int32_to_double = convert_scalar<double, int32_t>;
+        K.quantize_int16 = quantize_int16_scalar;
+        K.quantize_uint16 = quantize_uint16_scalar;
+        K.quantize_int32 = quantize_int32_scalar;
+        return true;
+    }
+    return false;
+}
+
+Kernels best_kernels()
+{
+    Kernels K;
+    select_kernels(K, "");
+    return K;
+}
+
+Kernels& kernels()
+{
+    static Kernels K = best_kernels(); //thread-safe initialization
+    return K;
+}
+}
+
+bool mdaio_select_convert_isa(const char* isa)
+{
+    MdaioConvert::Kernels K;
+    if (!MdaioConvert::select_kernels(K, isa))
+        return false;
+    MdaioConvert::kernels() = K;
+    return true;
+}
+
+const char* mdaio_convert_isa()
+{
+    return MdaioConvert::kernels().isa;
+}
+
+void mdaio_convert(float* dst, const int16_t* src, bigint n)
+{
+    MdaioConvert::kernels().int16_to_float(dst, src, n);
+}
+
+void mdaio_convert(float* dst, const uint16_t* src, bigint n)
+{
+    MdaioConvert::kernels().uint16_to_float(dst, src, n);
+}
+
+void mdaio_convert(float* dst, const int32_t* src, bigint n)
+{
+    MdaioConvert::kernels().int32_to_float(dst, src, n);
+}
+
+void mdaio_convert(double* dst, const int16_t* src, bigint n)
+{
+    MdaioConvert::kernels().int16_to_double(dst, src, n);
+}
+
+void mdaio_convert(double* dst, const uint16_t* src, bigint n)
+{
+    MdaioConvert::kernels().uint16_to_double(dst, src, n);
+}
+
+void mdaio_convert(double* dst, const int32_t* src, bigint n)
+{
+    MdaioConvert::kernels().int32_to_double(dst, src, n);
+}
+
+void mdaio_quantize(int16_t* dst, const float* src, bigint n, float scale)
+{
+    MdaioConvert::kernels().quantize_int16(dst, src, n, scale);
+}
+
+void mdaio_quantize(uint16_t* dst, const float* src, bigint n, float scale)
+{
+    MdaioConvert::kernels().quantize_uint16((int16_t*)dst, src, n, scale);
+}
+
+void mdaio_quantize(int32_t* dst, const float* src, bigint n, float scale)
+{
+    MdaioConvert::kernels().quantize_int32(dst, src, n, scale);
+}
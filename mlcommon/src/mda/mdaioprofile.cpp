@@ -0,0 +1,207 @@
+#include "mdaioprofile.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <atomic>
+#include <stdlib.h>
+
+namespace MdaIOProfilePrivate {
+
+struct DirectionStats {
+    bigint num_calls = 0;
+    bigint num_bytes = 0;
+    int64_t nanoseconds = 0;
+    bigint num_backward_seeks = 0;
+    bigint seek_histogram[MDA_IO_PROFILE_NUM_SEEK_BUCKETS] = {};
+    bigint next_offset = -1; //where the previous call ended
+};
+
+struct FileStats {
+    DirectionStats stats[2];
+    int64_t first_nanoseconds = -1; //relative to the start of the process
+    int64_t last_nanoseconds = 0;
+};
+
+struct Profile {
+    std::atomic<bool> enabled{ false };
+    QString output_fname;
+    std::chrono::steady_clock::time_point start_time;
+    QMutex mutex;
+    QHash<QString, FileStats> files;
+
+    Profile()
+    {
+        start_time = std::chrono::steady_clock::now();
+        const char* fname = getenv(MDA_IO_PROFILE_ENV);
+        if ((fname) && (fname[0])) {
+            output_fname = fname;
+            enabled = true;
+        }
+    }
+    ~Profile()
+    {
+        //the summary is written as the process exits
+        if ((enabled) && (!output_fname.isEmpty()))
+            MdaIOProfile::writeSummary(output_fname);
+    }
+    int64_t elapsed_nanoseconds() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+};
+
+Profile& profile()
+{
+    static Profile P;
+    return P;
+}
+
+//make sure the profile exists (and so is destroyed, writing the summary) even if nothing is read or written
+struct ProfileInitializer {
+    ProfileInitializer() { profile(); }
+} profile_initializer;
+
+int seek_bucket(bigint distance)
+{
+    int b = 0;
+    while ((distance > 0) && (b < MDA_IO_PROFILE_NUM_SEEK_BUCKETS - 1)) {
+        distance >>= 1;
+        b++;
+    }
+    return b;
+}
+
+QJsonObject direction_to_json(const DirectionStats& S)
+{
+    QJsonObject obj;
+    obj["calls"] = (double)S.num_calls;
+    obj["bytes"] = (double)S.num_bytes;
+    obj["io_sec"] = S.nanoseconds * 1e-9;
+    obj["mean_bytes_per_call"] = S.num_calls ? S.num_bytes * 1.0 / S.num_calls : 0.0;
+    obj["sequential_calls"] = (double)S.seek_histogram[0];
+    obj["backward_seeks"] = (double)S.num_backward_seeks;
+    int num_buckets = MDA_IO_PROFILE_NUM_SEEK_BUCKETS;
+    while ((num_buckets > 0) && (!S.seek_histogram[num_buckets - 1]))
+        num_buckets--;
+    QJsonArray histogram;
+    for (int b = 0; b < num_buckets; b++)
+        histogram.append((double)S.seek_histogram[b]);
+    obj["seek_log2_histogram"] = histogram;
+    return obj;
+}
+}
+
+bool MdaIOProfile::isEnabled()
+{
+    return MdaIOProfilePrivate::profile().enabled;
+}
+
+void MdaIOProfile::setEnabled(bool val)
+{
+    MdaIOProfilePrivate::profile().enabled = val;
+}
+
+void MdaIOProfile::record(Direction direction, const QString& path, bigint offset, bigint num_bytes, int64_t nanoseconds)
+{
+    using namespace MdaIOProfilePrivate;
+    Profile& P = profile();
+    int64_t now = P.elapsed_nanoseconds();
+    QMutexLocker locker(&P.mutex);
+    FileStats& F = P.files[path];
+    DirectionStats& S = F.stats[direction];
+    S.num_calls++;
+    S.num_bytes += num_bytes;
+    S.nanoseconds += nanoseconds;
+    if (S.next_offset >= 0) {
+        bigint distance = offset - S.next_offset;
+        if (distance < 0) {
+            S.num_backward_seeks++;
+            distance = -distance;
+        }
+        S.seek_histogram[seek_bucket(distance)]++;
+    }
+    else {
+        S.seek_histogram[0]++;
+    }
+    S.next_offset = offset + num_bytes;
+    if (F.first_nanoseconds < 0)
+        F.first_nanoseconds = now - nanoseconds;
+    F.last_nanoseconds = now;
+}
+
+QJsonObject MdaIOProfile::summary()
+{
+    using namespace MdaIOProfilePrivate;
+    Profile& P = profile();
+    double wall_sec = P.elapsed_nanoseconds() * 1e-9;
+    QMutexLocker locker(&P.mutex);
+    QJsonObject files;
+    int64_t total_nanoseconds = 0;
+    bigint total_bytes_read = 0, total_bytes_written = 0;
+    foreach (QString path, P.files.keys()) {
+        const FileStats& F = P.files[path];
+        QJsonObject obj;
+        obj["read"] = direction_to_json(F.stats[Read]);
+        obj["write"] = direction_to_json(F.stats[Write]);
+        obj["first_io_sec"] = F.first_nanoseconds * 1e-9;
+        obj["last_io_sec"] = F.last_nanoseconds * 1e-9;
+        files[path] = obj;
+        total_nanoseconds += F.stats[Read].nanoseconds + F.stats[Write].nanoseconds;
+        total_bytes_read += F.stats[Read].num_bytes;
+        total_bytes_written += F.stats[Write].num_bytes;
+    }
+    QJsonObject ret;
+    ret["wall_sec"] = wall_sec;
+    //summed over threads, so this can exceed wall_sec when several threads do I/O at once
+    ret["io_sec"] = total_nanoseconds * 1e-9;
+    ret["outside_io_sec"] = qMax(0.0, wall_sec - total_nanoseconds * 1e-9);
+    ret["bytes_read"] = (double)total_bytes_read;
+    ret["bytes_written"] = (double)total_bytes_written;
+    ret["files"] = files;
+    return ret;
+}
+
+bool MdaIOProfile::writeSummary(const QString& fname)
+{
+    QFile f(fname);
+    if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "Unable to write I/O profile:" << fname;
+        return false;
+    }
+    f.write(QJsonDocument(summary()).toJson());
+    return true;
+}
+
+void MdaIOProfile::clear()
+{
+    MdaIOProfilePrivate::Profile& P = MdaIOProfilePrivate::profile();
+    QMutexLocker locker(&P.mutex);
+    P.files.clear();
+}
+
+MdaIOProfileScope::MdaIOProfileScope(MdaIOProfile::Direction direction, const QString& path, bigint offset)
+    : m_enabled(MdaIOProfile::isEnabled())
+    , m_direction(direction)
+    , m_path(m_enabled ? path : QString()) //only shared when it will be recorded
+    , m_offset(offset)
+{
+    if (m_enabled)
+        m_start = std::chrono::steady_clock::now();
+}
+
+MdaIOProfileScope::~MdaIOProfileScope()
+{
+    if (m_enabled) {
+        int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+        MdaIOProfile::record(m_direction, m_path, m_offset, m_num_bytes, nanoseconds);
+    }
+}
+
+void MdaIOProfileScope::setNumBytes(bigint num_bytes)
+{
+    m_num_bytes = num_bytes;
+}
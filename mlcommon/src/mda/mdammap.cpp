@@ -0,0 +1,80 @@
+#include "mdammap.h"
+
+#include <QDebug>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MdaMemoryMap::MdaMemoryMap()
+{
+}
+
+MdaMemoryMap::~MdaMemoryMap()
+{
+    close();
+}
+
+bool MdaMemoryMap::open(const QString& path)
+{
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.toUtf8().data(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat SS;
+    if ((fstat(fd, &SS) != 0) || (SS.st_size <= 0)) {
+        ::close(fd);
+        return false;
+    }
+    void* ptr = mmap(0, SS.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); //the mapping keeps its own reference to the file
+    if (ptr == MAP_FAILED) {
+        qWarning() << "Unable to memory map file:" << path;
+        return false;
+    }
+    m_data = (unsigned char*)ptr;
+    m_size = SS.st_size;
+    return true;
+#else
+    Q_UNUSED(path)
+    return false;
+#endif
+}
+
+void MdaMemoryMap::close()
+{
+    if (!m_data)
+        return;
+#ifndef _WIN32
+    munmap(m_data, m_size);
+#endif
+    m_data = 0;
+    m_size = 0;
+}
+
+bool MdaMemoryMap::isOpen() const
+{
+    return (m_data != 0);
+}
+
+const unsigned char* MdaMemoryMap::data() const
+{
+    return m_data;
+}
+
+bigint MdaMemoryMap::size() const
+{
+    return m_size;
+}
+
+QSharedPointer<MdaMemoryMap> MdaMemoryMap::map(const QString& path)
+{
+    QSharedPointer<MdaMemoryMap> ret(new MdaMemoryMap);
+    if (!ret->open(path))
+        return QSharedPointer<MdaMemoryMap>();
+    return ret;
+}
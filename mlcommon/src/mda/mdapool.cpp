@@ -0,0 +1,288 @@
+#include "mdapool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include <vector>
+
+namespace MdaPoolPrivate {
+
+const int num_size_classes = 17; //64 bytes ... 4 MB
+const int min_block_shift = 6;
+
+struct ThreadCache {
+    std::vector<void*> free_lists[num_size_classes];
+    bigint num_bytes = 0;
+    bigint limit = MDAPOOL_DEFAULT_THREAD_CACHE_LIMIT;
+    int scope_depth = 0;
+
+    void clear()
+    {
+        for (int c = 0; c < num_size_classes; c++) {
+            for (size_t j = 0; j < free_lists[c].size(); j++)
+                free(free_lists[c][j]);
+            free_lists[c].clear();
+        }
+        num_bytes = 0;
+    }
+    ~ThreadCache()
+    {
+        clear();
+    }
+};
+
+ThreadCache& thread_cache()
+{
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+//the smallest c with num_bytes <= (64 << c), or -1 if the block is too large to pool
+int size_class(bigint num_bytes)
+{
+    if (num_bytes > MDAPOOL_MAX_BLOCK_BYTES)
+        return -1;
+    int c = 0;
+    while (((bigint)MDAPOOL_MIN_BLOCK_BYTES << c) < num_bytes)
+        c++;
+    return c;
+}
+
+inline bigint class_bytes(int c)
+{
+    return ((bigint)1) << (min_block_shift + c);
+}
+
+void* allocate_aligned(bigint num_bytes)
+{
+    bigint alignment = MDAPOOL_ALIGNMENT;
+    if (num_bytes >= MDAPOOL_HUGE_PAGE_THRESHOLD)
+        alignment = MDAPOOL_HUGE_PAGE_BYTES;
+    void* ptr = 0;
+    if (posix_memalign(&ptr, alignment, num_bytes) != 0)
+        return 0;
+#ifdef MADV_HUGEPAGE
+    if (num_bytes >= MDAPOOL_HUGE_PAGE_THRESHOLD)
+        madvise(ptr, num_bytes, MADV_HUGEPAGE); //only advice, fine if transparent huge pages are disabled
+#endif
+    return ptr;
+}
+
+//The usable size of a block from allocate_aligned, which may be more than was asked for
+bigint block_capacity(void* ptr)
+{
+#ifdef __APPLE__
+    return malloc_size(ptr);
+#else
+    return malloc_usable_size(ptr);
+#endif
+}
+
+std::atomic<bool> parallel_first_touch(true);
+
+template <typename T>
+void fill_range(T* data, bigint n, T value)
+{
+    if (value == 0)
+        memset(data, 0, n * sizeof(T));
+    else
+        std::fill(data, data + n, value);
+}
+
+//Helper threads for the parallel fill, started once and kept for the life of the process. Only one fill uses them at a
+//time: a fill that finds them busy (say, the threads of a parallel region all allocating at once) is done serially by the
+//calling thread, so concurrent allocations never multiply the number of threads
+class FillThreads {
+public:
+    FillThreads(int num_helpers)
+    {
+        for (int j = 0; j < num_helpers; j++) {
+            std::thread(&FillThreads::work, this, j + 1).detach();
+        }
+        m_num_slices = num_helpers + 1;
+    }
+    int numSlices() const
+    {
+        return m_num_slices;
+    }
+    ///Run job(0), ..., job(numSlices()-1) concurrently, or return false if another fill is using the threads
+    bool tryRun(const std::function<void(int)>& job)
+    {
+        std::unique_lock<std::mutex> busy_lock(m_busy, std::try_to_lock);
+        if (!busy_lock.owns_lock())
+            return false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = job;
+            m_num_pending = m_num_slices - 1;
+            m_generation++;
+        }
+        m_start.notify_all();
+        job(0);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_num_pending == 0; });
+        return true;
+    }
+
+private:
+    std::mutex m_busy; //held by the fill using the threads
+    std::mutex m_mutex;
+    std::condition_variable m_start, m_done;
+    std::function<void(int)> m_job;
+    int m_generation = 0;
+    int m_num_pending = 0;
+    int m_num_slices = 1;
+
+    void work(int slice)
+    {
+        int generation = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_start.wait(lock, [&] { return m_generation != generation; });
+            generation = m_generation;
+            std::function<void(int)> job = m_job;
+            lock.unlock();
+            job(slice);
+            lock.lock();
+            m_num_pending--;
+            if (m_num_pending == 0)
+                m_done.notify_one();
+        }
+    }
+};
+
+//0 on a single core. Intentionally never deleted, since its threads live until the process exits
+FillThreads* fill_threads()
+{
+    static FillThreads* threads = (std::thread::hardware_concurrency() > 1) ? new FillThreads(std::thread::hardware_concurrency() - 1) : 0;
+    return threads;
+}
+
+template <typename T>
+void fill(T* data, bigint n, T value)
+{
+    if ((parallel_first_touch) && (n * (bigint)sizeof(T) >= MDAPOOL_PARALLEL_FILL_THRESHOLD)) {
+        FillThreads* threads = fill_threads();
+        if (threads) {
+            //contiguous slices, so each thread touches whole pages
+            bigint slice_size = (n + threads->numSlices() - 1) / threads->numSlices();
+            bool ok = threads->tryRun([=](int j) {
+                bigint i1 = std::min(n, j * slice_size);
+                bigint i2 = std::min(n, i1 + slice_size);
+                fill_range(data + i1, i2 - i1, value);
+            });
+            if (ok)
+                return;
+        }
+    }
+    fill_range(data, n, value);
+}
+}
+
+void* MdaPool::allocate(bigint num_bytes)
+{
+    using namespace MdaPoolPrivate;
+    int c = size_class(num_bytes);
+    if (c < 0)
+        return allocate_aligned(num_bytes);
+    ThreadCache& cache = thread_cache();
+    if (cache.scope_depth == 0)
+        return allocate_aligned(num_bytes);
+    if (!cache.free_lists[c].empty()) {
+        void* ptr = cache.free_lists[c].back();
+        cache.free_lists[c].pop_back();
+        cache.num_bytes -= class_bytes(c);
+        return ptr;
+    }
+    //in a scope, round up, so that the block can be recycled by whichever thread releases it
+    return allocate_aligned(class_bytes(c));
+}
+
+void MdaPool::release(void* ptr, bigint num_bytes)
+{
+    using namespace MdaPoolPrivate;
+    if (!ptr)
+        return;
+    int c = size_class(num_bytes);
+    if (c >= 0) {
+        ThreadCache& cache = thread_cache();
+        //a block allocated outside of a scope has the exact size, and is only recycled if that happens to fill its class
+        if ((cache.scope_depth > 0) && (cache.num_bytes + class_bytes(c) <= cache.limit) && (block_capacity(ptr) >= class_bytes(c))) {
+            cache.free_lists[c].push_back(ptr);
+            cache.num_bytes += class_bytes(c);
+            return;
+        }
+    }
+    free(ptr);
+}
+
+void MdaPool::fill(float* data, bigint n, float value)
+{
+    MdaPoolPrivate::fill(data, n, value);
+}
+
+void MdaPool::fill(double* data, bigint n, double value)
+{
+    MdaPoolPrivate::fill(data, n, value);
+}
+
+void MdaPool::fill(int16_t* data, bigint n, int16_t value)
+{
+    MdaPoolPrivate::fill(data, n, value);
+}
+
+void MdaPool::setParallelFirstTouch(bool val)
+{
+    MdaPoolPrivate::parallel_first_touch = val;
+}
+
+bool MdaPool::parallelFirstTouch()
+{
+    return MdaPoolPrivate::parallel_first_touch;
+}
+
+void MdaPool::clearThreadCache()
+{
+    MdaPoolPrivate::thread_cache().clear();
+}
+
+bigint MdaPool::threadCacheBytes()
+{
+    return MdaPoolPrivate::thread_cache().num_bytes;
+}
+
+void MdaPool::setThreadCacheLimit(bigint num_bytes)
+{
+    MdaPoolPrivate::thread_cache().limit = num_bytes;
+}
+
+bigint MdaPool::threadCacheLimit()
+{
+    return MdaPoolPrivate::thread_cache().limit;
+}
+
+MdaPoolScope::MdaPoolScope()
+{
+    MdaPoolPrivate::thread_cache().scope_depth++;
+}
+
+MdaPoolScope::~MdaPoolScope()
+{
+    MdaPoolPrivate::ThreadCache& cache = MdaPoolPrivate::thread_cache();
+    cache.scope_depth--;
+    if (cache.scope_depth == 0)
+        cache.clear();
+}
@@ -0,0 +1,222 @@
+#include "mdaprefetcher.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+class MdaPrefetcherThread : public QThread {
+public:
+    MdaPrefetcherPrivate* d;
+
+    void run();
+};
+
+class MdaPrefetcherPrivate {
+public:
+    MdaPrefetcher* q;
+    DiskReadMda32 m_X;
+    bigint m_chunk_size = 0;
+    bigint m_overlap_size = 0;
+    bigint m_t1 = 0;
+    bigint m_t2 = -1;
+    int m_num_buffers = 2;
+    bool m_truncate_last_chunk = false;
+    QList<int> m_channels;
+
+    MdaPrefetcherThread m_thread;
+    mutable QMutex m_mutex;
+    QWaitCondition m_chunk_ready;
+    QWaitCondition m_buffer_free;
+    QQueue<Mda32> m_chunks;
+    QQueue<bigint> m_timepoints;
+    bool m_started = false;
+    bool m_stop_requested = false;
+    bool m_finished = false;
+    bool m_error = false;
+    qint64 m_stall_nsec = 0;
+    qint64 m_read_nsec = 0;
+
+    void start_if_needed();
+    bigint end_timepoint() const;
+    bigint chunk_timepoint(bigint k) const;
+    bigint chunk_read_size(bigint k) const;
+};
+
+MdaPrefetcher::MdaPrefetcher(const DiskReadMda32& X, bigint chunk_size, bigint overlap_size)
+{
+    d = new MdaPrefetcherPrivate;
+    d->q = this;
+    d->m_X = X;
+    d->m_chunk_size = qMax(chunk_size, (bigint)1);
+    d->m_overlap_size = overlap_size;
+    d->m_thread.d = d;
+}
+
+MdaPrefetcher::~MdaPrefetcher()
+{
+    stop();
+    delete d;
+}
+
+void MdaPrefetcher::setRange(bigint t1, bigint t2)
+{
+    if (d->m_started) {
+        qWarning() << "MdaPrefetcher::setRange has no effect once the sweep has started";
+        return;
+    }
+    d->m_t1 = t1;
+    d->m_t2 = t2;
+}
+
+void MdaPrefetcher::setNumBuffers(int num)
+{
+    if (d->m_started) {
+        qWarning() << "MdaPrefetcher::setNumBuffers has no effect once the sweep has started";
+        return;
+    }
+    d->m_num_buffers = qMax(num, 1);
+}
+
+void MdaPrefetcher::setTruncateLastChunk(bool val)
+{
+    d->m_truncate_last_chunk = val;
+}
+
+void MdaPrefetcher::setChannels(const QList<int>& channels)
+{
+    if (d->m_started) {
+        qWarning() << "MdaPrefetcher::setChannels has no effect once the sweep has started";
+        return;
+    }
+    d->m_channels = channels;
+}
+
+int MdaPrefetcher::numBuffers() const
+{
+    return d->m_num_buffers;
+}
+
+bigint MdaPrefetcher::numChunks() const
+{
+    bigint len = d->end_timepoint() - d->m_t1;
+    if (len <= 0)
+        return 0;
+    return (len + d->m_chunk_size - 1) / d->m_chunk_size;
+}
+
+bool MdaPrefetcher::next(Mda32& chunk, bigint& timepoint)
+{
+    d->start_if_needed();
+    QMutexLocker locker(&d->m_mutex);
+    if (d->m_chunks.isEmpty() && !d->m_finished) {
+        QElapsedTimer timer;
+        timer.start();
+        while (d->m_chunks.isEmpty() && !d->m_finished)
+            d->m_chunk_ready.wait(&d->m_mutex);
+        d->m_stall_nsec += timer.nsecsElapsed();
+    }
+    if (d->m_chunks.isEmpty())
+        return false;
+    chunk = d->m_chunks.dequeue();
+    timepoint = d->m_timepoints.dequeue();
+    d->m_buffer_free.wakeAll();
+    return true;
+}
+
+void MdaPrefetcher::stop()
+{
+    {
+        QMutexLocker locker(&d->m_mutex);
+        d->m_stop_requested = true;
+        d->m_buffer_free.wakeAll();
+    }
+    d->m_thread.wait();
+}
+
+bool MdaPrefetcher::hadError() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_error;
+}
+
+double MdaPrefetcher::stallTimeMsec() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_stall_nsec / 1e6;
+}
+
+double MdaPrefetcher::readTimeMsec() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_read_nsec / 1e6;
+}
+
+void MdaPrefetcherThread::run()
+{
+    bigint num_chunks = d->q->numChunks();
+    bigint M = d->m_X.N1();
+    for (bigint k = 0; k < num_chunks; k++) {
+        {
+            QMutexLocker locker(&d->m_mutex);
+            while ((d->m_chunks.count() >= d->m_num_buffers) && (!d->m_stop_requested))
+                d->m_buffer_free.wait(&d->m_mutex);
+            if (d->m_stop_requested)
+                break;
+        }
+        bigint timepoint = d->chunk_timepoint(k);
+        Mda32 chunk;
+        QElapsedTimer timer;
+        timer.start();
+        bool ok;
+        if (d->m_channels.isEmpty())
+            ok = d->m_X.readChunk(chunk, 0, timepoint - d->m_overlap_size, M, d->chunk_read_size(k));
+        else
+            ok = d->m_X.readChunk(chunk, d->m_channels, timepoint - d->m_overlap_size, d->chunk_read_size(k));
+        qint64 elapsed = timer.nsecsElapsed();
+
+        QMutexLocker locker(&d->m_mutex);
+        d->m_read_nsec += elapsed;
+        if (!ok) {
+            qWarning() << "Problem reading chunk in MdaPrefetcher at timepoint" << timepoint;
+            d->m_error = true;
+            break;
+        }
+        d->m_chunks.enqueue(chunk);
+        d->m_timepoints.enqueue(timepoint);
+        d->m_chunk_ready.wakeAll();
+    }
+    QMutexLocker locker(&d->m_mutex);
+    d->m_finished = true;
+    d->m_chunk_ready.wakeAll();
+}
+
+void MdaPrefetcherPrivate::start_if_needed()
+{
+    if (m_started)
+        return;
+    m_started = true;
+    m_thread.start();
+}
+
+bigint MdaPrefetcherPrivate::end_timepoint() const
+{
+    if (m_t2 < 0)
+        return m_X.N2();
+    return m_t2;
+}
+
+bigint MdaPrefetcherPrivate::chunk_timepoint(bigint k) const
+{
+    return m_t1 + k * m_chunk_size;
+}
+
+bigint MdaPrefetcherPrivate::chunk_read_size(bigint k) const
+{
+    bigint size = m_chunk_size;
+    if (m_truncate_last_chunk)
+        size = qMin(size, end_timepoint() - chunk_timepoint(k));
+    return size + 2 * m_overlap_size;
+}
@@ -0,0 +1,242 @@
+#include "mdastream.h"
+
+#include <QDebug>
+#include <string.h>
+#include <sys/stat.h>
+
+bool mda_is_stream_path(const QString& path)
+{
+    if (path.isEmpty())
+        return false;
+    struct stat st;
+    if (stat(path.toUtf8().data(), &st) != 0)
+        return false;
+    return ((S_ISFIFO(st.st_mode)) || (S_ISSOCK(st.st_mode)) || (S_ISCHR(st.st_mode)));
+}
+
+namespace MdaStreamPrivate {
+
+void convert(float* data, const MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    mda_convert_float32(data, H, raw, n);
+}
+
+void convert(double* data, const MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    mda_convert_float64(data, H, raw, n);
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MdaStreamReader::MdaStreamReader()
+{
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+MdaStreamReader::~MdaStreamReader()
+{
+    close();
+}
+
+bool MdaStreamReader::open(const QString& path)
+{
+    close();
+    m_file = fopen(path.toUtf8().data(), "rb");
+    if (!m_file)
+        return false;
+    if ((!mda_read_header(&m_header, m_file)) || (m_header.num_bytes_per_entry <= 0)) {
+        qWarning() << "Unable to read header of mda stream" << path;
+        close();
+        return false;
+    }
+    m_window.clear();
+    m_window_start = 0;
+    m_window_count = 0;
+    return true;
+}
+
+void MdaStreamReader::close()
+{
+    if (m_file) {
+        fclose(m_file);
+        m_file = 0;
+    }
+}
+
+bool MdaStreamReader::isOpen() const
+{
+    return (m_file != 0);
+}
+
+MDAIO_HEADER MdaStreamReader::header() const
+{
+    return m_header;
+}
+
+bigint MdaStreamReader::readFloat32(float* data, bigint i, bigint n)
+{
+    return read_entries(data, i, n);
+}
+
+bigint MdaStreamReader::readFloat64(double* data, bigint i, bigint n)
+{
+    return read_entries(data, i, n);
+}
+
+void MdaStreamReader::fill_window(bigint i, bigint n)
+{
+    //discard everything before i, then read up to i+n
+    const bigint nbpe = m_header.num_bytes_per_entry;
+    const bigint window_end = m_window_start + m_window_count;
+    if (i >= window_end) {
+        //skip over the unwanted entries in the stream
+        bigint num_to_skip = (i - window_end) * nbpe;
+        unsigned char buf[65536];
+        while (num_to_skip > 0) {
+            size_t num = fread(buf, 1, (size_t)qMin(num_to_skip, (bigint)sizeof(buf)), m_file);
+            if (num == 0)
+                break;
+            num_to_skip -= num;
+        }
+        m_window_start = i;
+        m_window_count = 0;
+    }
+    else if (i > m_window_start) {
+        memmove(m_window.data(), m_window.data() + (i - m_window_start) * nbpe, (window_end - i) * nbpe);
+        m_window_count = window_end - i;
+        m_window_start = i;
+    }
+    if (m_window_count < n) {
+        if ((bigint)m_window.size() < n * nbpe)
+            m_window.resize(n * nbpe);
+        size_t num_bytes = fread(m_window.data() + m_window_count * nbpe, 1, (n - m_window_count) * nbpe, m_file);
+        m_window_count += num_bytes / nbpe;
+    }
+}
+
+template <typename T>
+bigint MdaStreamReader::read_entries(T* data, bigint i, bigint n)
+{
+    QMutexLocker locker(&m_mutex);
+    if ((!m_file) || (n <= 0))
+        return 0;
+    if (i < m_window_start) {
+        qWarning() << "Cannot read backwards in an mda stream:" << i << "is before" << m_window_start;
+        return 0;
+    }
+    fill_window(i, n);
+    bigint num = qMin(n, m_window_count);
+    MdaStreamPrivate::convert(data, &m_header, m_window.data(), num);
+    return num;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MdaStreamWriter::MdaStreamWriter()
+{
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+MdaStreamWriter::~MdaStreamWriter()
+{
+}
+
+bool MdaStreamWriter::begin(FILE* F, MDAIO_HEADER* H)
+{
+    if (!F)
+        return false;
+    if (!mda_write_header(H, F)) {
+        qWarning() << "Unable to write header of mda stream";
+        return false;
+    }
+    m_file = F;
+    m_header = *H;
+    m_total_size = 1;
+    for (int i = 0; i < H->num_dims; i++)
+        m_total_size *= H->dims[i];
+    m_num_written = 0;
+    m_pending.clear();
+    return true;
+}
+
+bool MdaStreamWriter::writeFloat32(const float* data, bigint i, bigint n)
+{
+    std::vector<unsigned char> raw(n * m_header.num_bytes_per_entry);
+    if (!mda_convert_to_raw_float32(raw.data(), &m_header, data, n))
+        return false;
+    return write_raw(raw, i);
+}
+
+bool MdaStreamWriter::writeFloat64(const double* data, bigint i, bigint n)
+{
+    std::vector<unsigned char> raw(n * m_header.num_bytes_per_entry);
+    if (!mda_convert_to_raw_float64(raw.data(), &m_header, data, n))
+        return false;
+    return write_raw(raw, i);
+}
+
+bigint MdaStreamWriter::numEntriesWritten() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_num_written;
+}
+
+bool MdaStreamWriter::finish()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file)
+        return false;
+    bool ok = true;
+    while (!m_pending.isEmpty()) {
+        bigint i = m_pending.firstKey();
+        std::vector<unsigned char> raw = m_pending.take(i);
+        ok = ok && (write_zeros(i - m_num_written));
+        ok = ok && (fwrite(raw.data(), 1, raw.size(), m_file) == raw.size());
+        m_num_written = i + raw.size() / m_header.num_bytes_per_entry;
+    }
+    ok = ok && (write_zeros(m_total_size - m_num_written));
+    ok = ok && (fflush(m_file) == 0);
+    m_file = 0;
+    return ok;
+}
+
+bool MdaStreamWriter::write_raw(std::vector<unsigned char>& raw, bigint i)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file)
+        return false;
+    if (i < m_num_written) {
+        qWarning() << "Cannot write backwards in an mda stream:" << i << "is before" << m_num_written;
+        return false;
+    }
+    if (i > m_num_written) {
+        //hold it until the data before it arrives
+        m_pending[i].swap(raw);
+        return true;
+    }
+    if (fwrite(raw.data(), 1, raw.size(), m_file) != raw.size())
+        return false;
+    m_num_written += raw.size() / m_header.num_bytes_per_entry;
+    while ((!m_pending.isEmpty()) && (m_pending.firstKey() == m_num_written)) {
+        std::vector<unsigned char> raw0 = m_pending.take(m_num_written);
+        if (fwrite(raw0.data(), 1, raw0.size(), m_file) != raw0.size())
+            return false;
+        m_num_written += raw0.size() / m_header.num_bytes_per_entry;
+    }
+    return true;
+}
+
+bool MdaStreamWriter::write_zeros(bigint n)
+{
+    const bigint nbpe = m_header.num_bytes_per_entry;
+    std::vector<unsigned char> zeros(qMin(qMax(n, (bigint)0), (bigint)65536) * nbpe, 0);
+    while (n > 0) {
+        bigint num = qMin(n, (bigint)65536);
+        if ((bigint)fwrite(zeros.data(), nbpe, num, m_file) != num)
+            return false;
+        n -= num;
+        m_num_written += num;
+    }
+    return true;
+}
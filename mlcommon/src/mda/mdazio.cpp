@@ -0,0 +1,497 @@
+#include "mdazio.h"
+
+#include <QDebug>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MDAZ_VERSION 1
+#define MDAZ_CODEC_RAW 0
+#define MDAZ_CODEC_DELTA_BITPACK 1
+
+namespace MdazPrivate {
+
+bool is_integer_type(int data_type)
+{
+    return ((data_type == MDAIO_TYPE_BYTE) || (data_type == MDAIO_TYPE_INT16) || (data_type == MDAIO_TYPE_INT32) || (data_type == MDAIO_TYPE_UINT16) || (data_type == MDAIO_TYPE_UINT32));
+}
+
+bigint pread_all(int fd, void* buf, bigint num_bytes, bigint offset)
+{
+    unsigned char* ptr = (unsigned char*)buf;
+    bigint num_read = 0;
+    while (num_read < num_bytes) {
+        ssize_t ret = ::pread(fd, ptr + num_read, num_bytes - num_read, offset + num_read);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (ret == 0)
+            break;
+        num_read += ret;
+    }
+    return num_read;
+}
+
+int num_bits(uint64_t x)
+{
+    int ret = 0;
+    while (x) {
+        ret++;
+        x >>= 1;
+    }
+    return ret;
+}
+
+//Append n values of nbits bits each, least significant bit first
+void pack_bits(std::vector<unsigned char>& out, const uint64_t* vals, bigint n, int nbits)
+{
+    uint64_t acc = 0;
+    int nacc = 0;
+    for (bigint i = 0; i < n; i++) {
+        uint64_t v = vals[i];
+        int remaining = nbits;
+        while (remaining > 0) {
+            int take = (remaining > 32) ? 32 : remaining;
+            acc |= (v & ((((uint64_t)1) << take) - 1)) << nacc;
+            nacc += take;
+            v >>= take;
+            remaining -= take;
+            while (nacc >= 8) {
+                out.push_back((unsigned char)(acc & 0xff));
+                acc >>= 8;
+                nacc -= 8;
+            }
+        }
+    }
+    if (nacc > 0)
+        out.push_back((unsigned char)(acc & 0xff));
+}
+
+//Returns the number of bytes consumed, or -1 if the input is too short
+bigint unpack_bits(uint64_t* vals, bigint n, int nbits, const unsigned char* in, bigint len)
+{
+    bigint num_bytes = (n * nbits + 7) / 8;
+    if (num_bytes > len)
+        return -1;
+    bigint pos = 0;
+    uint64_t acc = 0;
+    int nacc = 0;
+    for (bigint i = 0; i < n; i++) {
+        uint64_t v = 0;
+        int got = 0;
+        while (got < nbits) {
+            if (nacc == 0) {
+                acc = in[pos++];
+                nacc = 8;
+            }
+            int take = qMin(nbits - got, nacc);
+            v |= (acc & ((((uint64_t)1) << take) - 1)) << got;
+            acc >>= take;
+            nacc -= take;
+            got += take;
+        }
+        vals[i] = v;
+    }
+    return num_bytes;
+}
+
+//Each row m of the N1 x C block is delta coded along the columns, zigzag mapped and bit-packed
+template <typename T>
+void encode_rows(std::vector<unsigned char>& out, const unsigned char* raw, bigint N1, bigint C)
+{
+    std::vector<uint64_t> zz(C);
+    for (bigint m = 0; m < N1; m++) {
+        int64_t prev = 0;
+        uint64_t max_zz = 0;
+        for (bigint c = 0; c < C; c++) {
+            T val;
+            memcpy(&val, raw + sizeof(T) * (m + N1 * c), sizeof(T));
+            int64_t d = (int64_t)val - prev;
+            prev = (int64_t)val;
+            zz[c] = (((uint64_t)d) << 1) ^ ((uint64_t)(d >> 63));
+            if (zz[c] > max_zz)
+                max_zz = zz[c];
+        }
+        int nbits = num_bits(max_zz);
+        out.push_back((unsigned char)nbits);
+        pack_bits(out, zz.data(), C, nbits);
+    }
+}
+
+template <typename T>
+bool decode_rows(unsigned char* raw, const unsigned char* in, bigint len, bigint N1, bigint C)
+{
+    std::vector<uint64_t> zz(C);
+    bigint pos = 0;
+    for (bigint m = 0; m < N1; m++) {
+        if (pos >= len)
+            return false;
+        int nbits = in[pos++];
+        if (nbits > 64)
+            return false;
+        bigint consumed = unpack_bits(zz.data(), C, nbits, in + pos, len - pos);
+        if (consumed < 0)
+            return false;
+        pos += consumed;
+        int64_t prev = 0;
+        for (bigint c = 0; c < C; c++) {
+            int64_t d = (int64_t)(zz[c] >> 1) ^ -(int64_t)(zz[c] & 1);
+            prev += d;
+            T val = (T)prev;
+            memcpy(raw + sizeof(T) * (m + N1 * c), &val, sizeof(T));
+        }
+    }
+    return true;
+}
+
+bool encode_block(std::vector<unsigned char>& out, int data_type, const unsigned char* raw, bigint N1, bigint C)
+{
+    if (data_type == MDAIO_TYPE_BYTE)
+        encode_rows<unsigned char>(out, raw, N1, C);
+    else if (data_type == MDAIO_TYPE_INT16)
+        encode_rows<int16_t>(out, raw, N1, C);
+    else if (data_type == MDAIO_TYPE_INT32)
+        encode_rows<int32_t>(out, raw, N1, C);
+    else if (data_type == MDAIO_TYPE_UINT16)
+        encode_rows<uint16_t>(out, raw, N1, C);
+    else if (data_type == MDAIO_TYPE_UINT32)
+        encode_rows<uint32_t>(out, raw, N1, C);
+    else
+        return false;
+    return true;
+}
+
+bool decode_block(unsigned char* raw, int data_type, const unsigned char* in, bigint len, bigint N1, bigint C)
+{
+    if (data_type == MDAIO_TYPE_BYTE)
+        return decode_rows<unsigned char>(raw, in, len, N1, C);
+    else if (data_type == MDAIO_TYPE_INT16)
+        return decode_rows<int16_t>(raw, in, len, N1, C);
+    else if (data_type == MDAIO_TYPE_INT32)
+        return decode_rows<int32_t>(raw, in, len, N1, C);
+    else if (data_type == MDAIO_TYPE_UINT16)
+        return decode_rows<uint16_t>(raw, in, len, N1, C);
+    else if (data_type == MDAIO_TYPE_UINT32)
+        return decode_rows<uint32_t>(raw, in, len, N1, C);
+    return false;
+}
+
+bigint convert(float* data, const MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    return mda_convert_float32(data, H, raw, n);
+}
+
+bigint convert(double* data, const MDAIO_HEADER* H, const void* raw, bigint n)
+{
+    return mda_convert_float64(data, H, raw, n);
+}
+}
+
+bool mdaz_is_mdaz_path(const QString& path)
+{
+    return path.endsWith(".mdaz");
+}
+
+MdazWriter::MdazWriter()
+{
+}
+
+MdazWriter::~MdazWriter()
+{
+}
+
+bool MdazWriter::begin(FILE* F, MDAIO_HEADER* H, bigint block_columns)
+{
+    H->num_bytes_per_entry = mda_get_num_bytes_per_entry(H->data_type);
+    if ((!F) || (H->num_bytes_per_entry == 0) || (H->num_dims <= 0) || (H->num_dims > MDAIO_MAX_DIMS) || (block_columns <= 0)) {
+        qWarning() << "Unable to begin writing mdaz file" << H->data_type << H->num_dims << block_columns;
+        return false;
+    }
+    m_file = F;
+    m_header = *H;
+    m_total_size = 1;
+    for (int i = 0; i < H->num_dims; i++)
+        m_total_size *= H->dims[i];
+    m_block_size = H->dims[0] * block_columns;
+    m_block.resize(m_block_size * H->num_bytes_per_entry);
+    m_block_count = 0;
+    m_num_written = 0;
+    m_offsets.clear();
+
+    bool ok = (fwrite("MDAZ", 1, 4, F) == 4);
+    int32_t vals[4] = { MDAZ_VERSION, H->data_type, H->num_bytes_per_entry, H->num_dims };
+    ok = ok && (fwrite(vals, sizeof(int32_t), 4, F) == 4);
+    for (int i = 0; i < H->num_dims; i++) {
+        int64_t dim0 = H->dims[i];
+        ok = ok && (fwrite(&dim0, sizeof(int64_t), 1, F) == 1);
+    }
+    int64_t block_columns0 = block_columns;
+    ok = ok && (fwrite(&block_columns0, sizeof(int64_t), 1, F) == 1);
+    H->header_size = ftello(F);
+    return ok;
+}
+
+bool MdazWriter::writeFloat32(const float* data, bigint n)
+{
+    while (n > 0) {
+        if (m_num_written >= m_total_size) {
+            qWarning() << "Too many entries written to mdaz file";
+            return false;
+        }
+        bigint num = qMin(n, m_block_size - m_block_count);
+        num = qMin(num, m_total_size - m_num_written);
+        if (!mda_convert_to_raw_float32(&m_block[m_block_count * m_header.num_bytes_per_entry], &m_header, data, num))
+            return false;
+        m_block_count += num;
+        m_num_written += num;
+        data += num;
+        n -= num;
+        if ((m_block_count == m_block_size) && (!flush_block()))
+            return false;
+    }
+    return true;
+}
+
+bool MdazWriter::writeFloat64(const double* data, bigint n)
+{
+    while (n > 0) {
+        if (m_num_written >= m_total_size) {
+            qWarning() << "Too many entries written to mdaz file";
+            return false;
+        }
+        bigint num = qMin(n, m_block_size - m_block_count);
+        num = qMin(num, m_total_size - m_num_written);
+        if (!mda_convert_to_raw_float64(&m_block[m_block_count * m_header.num_bytes_per_entry], &m_header, data, num))
+            return false;
+        m_block_count += num;
+        m_num_written += num;
+        data += num;
+        n -= num;
+        if ((m_block_count == m_block_size) && (!flush_block()))
+            return false;
+    }
+    return true;
+}
+
+bigint MdazWriter::numEntriesWritten() const
+{
+    return m_num_written;
+}
+
+bool MdazWriter::finish()
+{
+    if (!m_file)
+        return false;
+    //pad with zeros
+    while (m_num_written < m_total_size) {
+        bigint num = qMin(m_block_size - m_block_count, m_total_size - m_num_written);
+        memset(&m_block[m_block_count * m_header.num_bytes_per_entry], 0, num * m_header.num_bytes_per_entry);
+        m_block_count += num;
+        m_num_written += num;
+        if ((m_block_count == m_block_size) && (!flush_block()))
+            return false;
+    }
+    if (!flush_block())
+        return false;
+
+    //the index
+    m_offsets.push_back(ftello(m_file));
+    bool ok = (fwrite(m_offsets.data(), sizeof(int64_t), m_offsets.size(), m_file) == m_offsets.size());
+    int64_t num_blocks = m_offsets.size() - 1;
+    ok = ok && (fwrite(&num_blocks, sizeof(int64_t), 1, m_file) == 1);
+    ok = ok && (fwrite("MDAZ", 1, 4, m_file) == 4);
+    fflush(m_file);
+    m_file = 0;
+    return ok;
+}
+
+bool MdazWriter::flush_block()
+{
+    if (m_block_count == 0)
+        return true;
+    m_offsets.push_back(ftello(m_file));
+    bigint num_raw_bytes = m_block_count * m_header.num_bytes_per_entry;
+    if (MdazPrivate::is_integer_type(m_header.data_type)) {
+        std::vector<unsigned char> encoded;
+        encoded.reserve(num_raw_bytes + 1);
+        encoded.push_back(MDAZ_CODEC_DELTA_BITPACK);
+        MdazPrivate::encode_block(encoded, m_header.data_type, m_block.data(), m_header.dims[0], m_block_count / m_header.dims[0]);
+        if ((bigint)encoded.size() < num_raw_bytes + 1) {
+            m_block_count = 0;
+            return (fwrite(encoded.data(), 1, encoded.size(), m_file) == encoded.size());
+        }
+    }
+    //not compressible
+    unsigned char codec = MDAZ_CODEC_RAW;
+    bool ok = (fwrite(&codec, 1, 1, m_file) == 1);
+    ok = ok && (fwrite(m_block.data(), 1, num_raw_bytes, m_file) == (size_t)num_raw_bytes);
+    m_block_count = 0;
+    return ok;
+}
+
+MdazReader::MdazReader()
+{
+}
+
+MdazReader::~MdazReader()
+{
+    close();
+}
+
+bool MdazReader::open(const QString& path)
+{
+    close();
+    m_fd = ::open(path.toUtf8().data(), O_RDONLY);
+    if (m_fd < 0)
+        return false;
+    char magic[4];
+    int32_t vals[4];
+    if ((MdazPrivate::pread_all(m_fd, magic, 4, 0) != 4) || (strncmp(magic, "MDAZ", 4) != 0) || (MdazPrivate::pread_all(m_fd, vals, sizeof(vals), 4) != sizeof(vals))) {
+        qWarning() << "Not a valid mdaz file:" << path;
+        close();
+        return false;
+    }
+    if ((vals[0] != MDAZ_VERSION) || (vals[3] <= 0) || (vals[3] > MDAIO_MAX_DIMS) || (vals[2] != mda_get_num_bytes_per_entry(vals[1]))) {
+        qWarning() << "Unsupported mdaz file:" << path << vals[0] << vals[1] << vals[2] << vals[3];
+        close();
+        return false;
+    }
+    m_header.data_type = vals[1];
+    m_header.num_bytes_per_entry = vals[2];
+    m_header.num_dims = vals[3];
+    m_header.header_size = 0;
+    for (int i = 0; i < MDAIO_MAX_DIMS; i++)
+        m_header.dims[i] = 1;
+    std::vector<int64_t> dims(m_header.num_dims + 1); //the dims followed by the block columns
+    if (MdazPrivate::pread_all(m_fd, dims.data(), sizeof(int64_t) * dims.size(), 4 + sizeof(vals)) != (bigint)(sizeof(int64_t) * dims.size())) {
+        close();
+        return false;
+    }
+    m_total_size = 1;
+    for (int i = 0; i < m_header.num_dims; i++) {
+        m_header.dims[i] = dims[i];
+        m_total_size *= dims[i];
+    }
+    m_block_size = m_header.dims[0] * dims[m_header.num_dims];
+
+    //the trailer and block index
+    struct stat SS;
+    int64_t num_blocks = 0;
+    if ((m_block_size <= 0) || (fstat(m_fd, &SS) != 0) || (SS.st_size < 12) || (MdazPrivate::pread_all(m_fd, &num_blocks, 8, SS.st_size - 12) != 8) || (MdazPrivate::pread_all(m_fd, magic, 4, SS.st_size - 4) != 4) || (strncmp(magic, "MDAZ", 4) != 0)) {
+        qWarning() << "Missing index in mdaz file:" << path;
+        close();
+        return false;
+    }
+    if (num_blocks != (m_total_size + m_block_size - 1) / m_block_size) {
+        qWarning() << "Unexpected number of blocks in mdaz file:" << path << num_blocks;
+        close();
+        return false;
+    }
+    m_offsets.resize(num_blocks + 1);
+    bigint index_size = sizeof(int64_t) * (num_blocks + 1);
+    if (MdazPrivate::pread_all(m_fd, m_offsets.data(), index_size, SS.st_size - 12 - index_size) != index_size) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MdazReader::close()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_offsets.clear();
+    m_cached_block_index = -1;
+    m_cached_block.clear();
+}
+
+bool MdazReader::isOpen() const
+{
+    return (m_fd >= 0);
+}
+
+MDAIO_HEADER MdazReader::header() const
+{
+    return m_header;
+}
+
+bigint MdazReader::readFloat32(float* data, bigint i, bigint n)
+{
+    return read_entries(data, i, n);
+}
+
+bigint MdazReader::readFloat64(double* data, bigint i, bigint n)
+{
+    return read_entries(data, i, n);
+}
+
+bool MdazReader::decode_block(bigint block_index, std::vector<unsigned char>& raw)
+{
+    bigint offset = m_offsets[block_index];
+    bigint len = m_offsets[block_index + 1] - offset;
+    bigint num_entries = qMin(m_block_size, m_total_size - block_index * m_block_size);
+    bigint num_raw_bytes = num_entries * m_header.num_bytes_per_entry;
+    if (len < 1)
+        return false;
+    std::vector<unsigned char> encoded(len);
+    if (MdazPrivate::pread_all(m_fd, encoded.data(), len, offset) != len)
+        return false;
+    raw.resize(num_raw_bytes);
+    if (encoded[0] == MDAZ_CODEC_RAW) {
+        if (len - 1 != num_raw_bytes)
+            return false;
+        memcpy(raw.data(), encoded.data() + 1, num_raw_bytes);
+        return true;
+    }
+    else if (encoded[0] == MDAZ_CODEC_DELTA_BITPACK) {
+        return MdazPrivate::decode_block(raw.data(), m_header.data_type, encoded.data() + 1, len - 1, m_header.dims[0], num_entries / m_header.dims[0]);
+    }
+    return false;
+}
+
+template <typename T>
+bigint MdazReader::read_entries(T* data, bigint i, bigint n)
+{
+    if (m_fd < 0)
+        return 0;
+    //zeros outside of the array
+    bigint jA = qMax(i, (bigint)0);
+    bigint jB = qMin(i + n, m_total_size); //exclusive
+    for (bigint j = i; j < qMin(jA, i + n); j++)
+        data[j - i] = 0;
+    for (bigint j = qMax(jB, i); j < i + n; j++)
+        data[j - i] = 0;
+    if (jA >= jB)
+        return n;
+
+    bigint num_read = 0;
+    for (bigint k = jA / m_block_size; k * m_block_size < jB; k++) {
+        bigint kA = qMax(jA, k * m_block_size);
+        bigint kB = qMin(jB, (k + 1) * m_block_size);
+        bigint raw_offset = (kA - k * m_block_size) * m_header.num_bytes_per_entry;
+        {
+            QMutexLocker locker(&m_cache_mutex);
+            if (m_cached_block_index == k) {
+                MdazPrivate::convert(&data[kA - i], &m_header, &m_cached_block[raw_offset], kB - kA);
+                num_read += kB - kA;
+                continue;
+            }
+        }
+        std::vector<unsigned char> raw;
+        if (!decode_block(k, raw)) {
+            qWarning() << "Problem decoding block of mdaz file" << k;
+            return num_read;
+        }
+        MdazPrivate::convert(&data[kA - i], &m_header, &raw[raw_offset], kB - kA);
+        num_read += kB - kA;
+        QMutexLocker locker(&m_cache_mutex);
+        m_cached_block.swap(raw);
+        m_cached_block_index = k;
+    }
+    return n - (jB - jA) + num_read;
+}
@@ -9,6 +9,11 @@
 #include <QStringList>
 #include <QDir>
 #include <QDateTime>
+#include <QMutex>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <mlnetwork.h>
 #include <mda32.h>
 #include <diskreadmda32.h>
@@ -23,11 +28,23 @@ struct RemoteReadMdaInfo {
         N1 = N2 = N3 = 0;
     }
 
-    int N1, N2, N3;
+    bigint N1, N2, N3;
     QString checksum;
     QDateTime file_last_modified;
 };
 
+///Everything needed to download one chunk, copied so that a background download does not depend on the RemoteReadMda
+struct RemoteReadMdaChunkRequest {
+    QString path;
+    QString checksum;
+    QString datatype;
+    bigint chunk_size = 0;
+    bigint total_size = 0;
+    bigint index = 0;
+
+    QString cache_file_name() const;
+};
+
 class RemoteReadMdaPrivate {
 public:
     RemoteReadMda* q;
@@ -37,14 +54,57 @@ public:
     bool m_reshaped;
     bool m_info_downloaded;
     QString m_remote_datatype;
-    int m_download_chunk_size;
+    bigint m_download_chunk_size;
+    int m_read_ahead_chunks;
     bool m_download_failed; //don't make excessive calls. Once we failed, that's it.
 
     void construct_and_clear();
     void copy_from(const RemoteReadMda& other);
     void download_info_if_needed();
-    QString download_chunk_at_index(int ii);
+    RemoteReadMdaChunkRequest chunk_request(bigint ii);
+    QString download_chunk_at_index(bigint ii);
+    void start_downloads(bigint jj1, bigint jj2);
+    template <class ArrayType, class DiskReadType>
+    bool read_chunk(ArrayType& X, bigint i, bigint size);
+};
+
+namespace RemoteReadMdaDownloads {
+//chunks waiting in the thread pool, and chunks being downloaded, by cache file name
+QMutex mutex;
+QWaitCondition finished;
+QSet<QString> queued;
+QSet<QString> downloading;
+
+QThreadPool* thread_pool()
+{
+    //never deleted, so that exiting does not wait for the read-ahead
+    static QThreadPool* pool = 0;
+    static QMutex pool_mutex;
+    QMutexLocker locker(&pool_mutex);
+    if (!pool) {
+        pool = new QThreadPool;
+        pool->setMaxThreadCount(REMOTE_READ_MDA_MAX_PARALLEL_DOWNLOADS);
+    }
+    return pool;
+}
+
+QString download_chunk(const RemoteReadMdaChunkRequest& R);
+
+class ChunkDownload : public QRunnable {
+public:
+    ChunkDownload(const RemoteReadMdaChunkRequest& R)
+        : m_request(R)
+    {
+    }
+    void run() Q_DECL_OVERRIDE
+    {
+        download_chunk(m_request);
+    }
+
+private:
+    RemoteReadMdaChunkRequest m_request;
 };
+}
 
 RemoteReadMda::RemoteReadMda(const QString& path)
 {
@@ -56,8 +116,6 @@ RemoteReadMda::RemoteReadMda(const QString& path)
 
 RemoteReadMda::RemoteReadMda(const RemoteReadMda& other)
 {
-    d = new RemoteReadMdaPrivate;
-    d->q = this;
     d = new RemoteReadMdaPrivate;
     d->q = this;
     d->copy_from(other);
@@ -78,16 +136,26 @@ void RemoteReadMda::setRemoteDataType(QString dtype)
     d->m_remote_datatype = dtype;
 }
 
-void RemoteReadMda::setDownloadChunkSize(int size)
+void RemoteReadMda::setDownloadChunkSize(bigint size)
 {
     d->m_download_chunk_size = size;
 }
 
-int RemoteReadMda::downloadChunkSize()
+bigint RemoteReadMda::downloadChunkSize()
 {
     return d->m_download_chunk_size;
 }
 
+void RemoteReadMda::setReadAheadChunks(int num)
+{
+    d->m_read_ahead_chunks = num;
+}
+
+int RemoteReadMda::readAheadChunks() const
+{
+    return d->m_read_ahead_chunks;
+}
+
 void RemoteReadMda::setPath(const QString& file_path)
 {
     d->construct_and_clear();
@@ -100,7 +168,7 @@ QString RemoteReadMda::makePath() const
     return d->m_path;
 }
 
-bool RemoteReadMda::reshape(int N1b, int N2b, int N3b)
+bool RemoteReadMda::reshape(bigint N1b, bigint N2b, bigint N3b)
 {
     if (this->N1() * this->N2() * this->N3() != N1b * N2b * N3b)
         return false;
@@ -112,19 +180,19 @@ bool RemoteReadMda::reshape(int N1b, int N2b, int N3b)
     return true;
 }
 
-int RemoteReadMda::N1() const
+bigint RemoteReadMda::N1() const
 {
     d->download_info_if_needed();
     return d->m_info.N1;
 }
 
-int RemoteReadMda::N2() const
+bigint RemoteReadMda::N2() const
 {
     d->download_info_if_needed();
     return d->m_info.N2;
 }
 
-int RemoteReadMda::N3() const
+bigint RemoteReadMda::N3() const
 {
     d->download_info_if_needed();
     return d->m_info.N3;
@@ -147,229 +215,74 @@ QString format_num(double num_entries)
     return QString("%1G").arg(num_entries / 1e9, 0, 'f', 2);
 }
 
-bool RemoteReadMda::readChunk(Mda& X, int i, int size) const
+bool RemoteReadMda::readChunk(Mda& X, bigint i, bigint size) const
 {
-    if (d->m_download_failed) {
-        //don't make excessive calls... once we fail, that's it.
-        return false;
-    }
-    //double size_mb = size * datatype_size * 1.0 / 1e6;
-    //TaskProgress task(TaskProgress::Download, "Downloading array chunk");
-    //if (size_mb > 0.5) {
-    //    task.setLabel(QString("Downloading array chunk: %1 MB").arg(size_mb));
-    //}
-    //read a chunk of the remote array considered as a 1D array
-
-    TaskProgress task(TaskProgress::Download, QString("Downloading %1 numbers - %2 (%3x%4x%5)").arg(format_num(size)).arg(d->m_remote_datatype).arg(N1()).arg(N2()).arg(N3()));
-    task.log() << "Reading chunk:" << this->makePath() << i << size;
-
-    X.allocate(size, 1); //allocate the output array
-    double* Xptr = X.dataPtr(); //pointer to the output data
-    int ii1 = i; //start index of the remote array
-    int ii2 = i + size - 1; //end index of the remote array
-    int jj1 = ii1 / d->m_download_chunk_size; //start chunk index of the remote array
-    int jj2 = ii2 / d->m_download_chunk_size; //end chunk index of the remote array
-    if (jj1 == jj2) { //in this case there is only one chunk we need to worry about
-        task.setProgress(0.2);
-        QString fname = d->download_chunk_at_index(jj1); //download the single chunk
-        if (fname.isEmpty()) {
-            //task.error("fname is empty");
-            if (!MLUtil::threadInterruptRequested()) {
-                TaskProgress errtask("Download chunk at index");
-                errtask.log() << QString("m_remote_data_type = %1, download chunk size = %2").arg(d->m_remote_datatype).arg(d->m_download_chunk_size);
-                errtask.log() << d->m_path;
-                errtask.error() << QString("Failed to download chunk at index %1 *").arg(jj1);
-                d->m_download_failed = true;
-            }
-            return false;
-        }
-        DiskReadMda A(fname);
-        A.readChunk(X, ii1 - jj1 * d->m_download_chunk_size, size); //starting reading at the offset of ii1 relative to the start index of the chunk
-        return true;
-    }
-    else {
-        for (int jj = jj1; jj <= jj2; jj++) { //otherwise we need to step through the chunks
-            task.setProgress((jj - jj1 + 0.5) / (jj2 - jj1 + 1));
-            if (MLUtil::threadInterruptRequested()) {
-                //X = Mda(); //maybe it's better to return the right size.
-                //task.error("Halted");
-                return false;
-            }
-            QString fname = d->download_chunk_at_index(jj); //download the chunk at index jj
-            if (fname.isEmpty()) {
-                //task.error("fname is empty *");
-                return false;
-            }
-            DiskReadMda A(fname);
-            if (jj == jj1) { //case 1/3, this is the first chunk
-                Mda tmp;
-                int size0 = (jj1 + 1) * d->m_download_chunk_size - ii1; //the size is going to be the difference between ii1 and the start index of the next chunk
-                A.readChunk(tmp, ii1 - jj1 * d->m_download_chunk_size, size0); //again we start reading at the offset of ii1 relative to the start index of the chunk
-                double* tmp_ptr = tmp.dataPtr(); //copy the data directly from tmp_ptr to Xptr
-                const int b = 0;
-                std::copy(tmp_ptr, tmp_ptr + size0, Xptr + b);
-                //                for (int a = 0; a < size0; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
-            else if (jj == jj2) { //case 2/3, this is the last chunk
-                Mda tmp;
-                int size0 = ii2 + 1 - jj2 * d->m_download_chunk_size; //the size is going to be the difference between the start index of the last chunk and ii2+1
-                A.readChunk(tmp, 0, size0); //we start reading at position zero
-                double* tmp_ptr = tmp.dataPtr();
-                //copy the data to the last part of X
-                const int b = size - size0;
-                std::copy(tmp_ptr, tmp_ptr + size0, Xptr + b);
-                //                for (int a = 0; a < size0; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
+    return d->read_chunk<Mda, DiskReadMda>(X, i, size);
+}
 
-            /*
-             ///this was the old code, which was wrong!!!!!!!!! -- fixed on 5/16/2016
-            else if (jj == jj2) {
-                Mda tmp;
-                int size0 = ii2 + 1 - jj2 * d->m_download_chunk_size;
-                A.readChunk(tmp, d->m_download_chunk_size - size0, size0);
-                double* tmp_ptr = tmp.dataPtr();
-                int b = jj2 * d->m_download_chunk_size - ii1;
-                for (int a = 0; a < size0; a++) {
-                    Xptr[b] = tmp_ptr[a];
-                    b++;
-                }
-            }
-            */
-            else { //case 3/3, this is a middle chunk
-                Mda tmp;
-                A.readChunk(tmp, 0, d->m_download_chunk_size); //read the entire chunk, because we'll use it all
-                double* tmp_ptr = tmp.dataPtr();
-                int b = jj * d->m_download_chunk_size - ii1; //we start writing at the offset between the start index of the chunk and the start index
-                std::copy(tmp_ptr, tmp_ptr + d->m_download_chunk_size, Xptr + b);
-                //                for (int a = 0; a < d->m_download_chunk_size; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
-        }
-        return true;
-    }
+bool RemoteReadMda::readChunk32(Mda32& X, bigint i, bigint size) const
+{
+    return d->read_chunk<Mda32, DiskReadMda32>(X, i, size);
 }
 
-bool RemoteReadMda::readChunk32(Mda32& X, int i, int size) const
+template <class ArrayType, class DiskReadType>
+bool RemoteReadMdaPrivate::read_chunk(ArrayType& X, bigint i, bigint size)
 {
-    if (d->m_download_failed) {
+    if (m_download_failed) {
         //don't make excessive calls... once we fail, that's it.
         return false;
     }
-    //double size_mb = size * datatype_size * 1.0 / 1e6;
-    //TaskProgress task(TaskProgress::Download, "Downloading array chunk");
-    //if (size_mb > 0.5) {
-    //    task.setLabel(QString("Downloading array chunk: %1 MB").arg(size_mb));
-    //}
     //read a chunk of the remote array considered as a 1D array
 
-    TaskProgress task(TaskProgress::Download, QString("Downloading %1 numbers -- %2 (%3x%4x%5)").arg(format_num(size)).arg(d->m_remote_datatype).arg(N1()).arg(N2()).arg(N3()));
-    task.log(this->makePath());
+    TaskProgress task(TaskProgress::Download, QString("Downloading %1 numbers - %2 (%3x%4x%5)").arg(format_num(size)).arg(m_remote_datatype).arg(q->N1()).arg(q->N2()).arg(q->N3()));
+    task.log() << "Reading chunk:" << m_path << i << size;
 
     X.allocate(size, 1); //allocate the output array
-    dtype32* Xptr = X.dataPtr(); //pointer to the output data
-    int ii1 = i; //start index of the remote array
-    int ii2 = i + size - 1; //end index of the remote array
-    int jj1 = ii1 / d->m_download_chunk_size; //start chunk index of the remote array
-    int jj2 = ii2 / d->m_download_chunk_size; //end chunk index of the remote array
-    if (jj1 == jj2) { //in this case there is only one chunk we need to worry about
-        task.setProgress(0.2);
-        QString fname = d->download_chunk_at_index(jj1); //download the single chunk
+    if (size <= 0)
+        return true;
+    bigint ii1 = i; //start index of the remote array
+    bigint ii2 = i + size - 1; //end index of the remote array
+    bigint jj1 = ii1 / m_download_chunk_size; //start chunk index of the remote array
+    bigint jj2 = ii2 / m_download_chunk_size; //end chunk index of the remote array
+
+    //the pool fetches the other chunks, and those that follow, while we fetch the first. Below we take the chunks in
+    //order, waiting for those the pool is downloading and fetching ourselves those it has not started yet.
+    start_downloads(jj1 + 1, jj2 + m_read_ahead_chunks);
+
+    for (bigint jj = jj1; jj <= jj2; jj++) {
+        task.setProgress((jj - jj1 + 0.5) / (jj2 - jj1 + 1));
+        if (MLUtil::threadInterruptRequested()) {
+            return false;
+        }
+        QString fname = download_chunk_at_index(jj);
         if (fname.isEmpty()) {
-            //task.error("fname is empty");
             if (!MLUtil::threadInterruptRequested()) {
                 TaskProgress errtask("Download chunk at index");
-                errtask.log(QString("m_remote_data_type = %1, download chunk size = %2").arg(d->m_remote_datatype).arg(d->m_download_chunk_size));
-                errtask.log(d->m_path);
-                errtask.error(QString("Failed to download chunk at index %1 -").arg(jj1));
-                d->m_download_failed = true;
+                errtask.log() << QString("m_remote_data_type = %1, download chunk size = %2").arg(m_remote_datatype).arg(m_download_chunk_size);
+                errtask.log() << m_path;
+                errtask.error() << QString("Failed to download chunk at index %1").arg(jj);
+                m_download_failed = true;
             }
             return false;
         }
-        DiskReadMda32 A(fname);
-        A.readChunk(X, ii1 - jj1 * d->m_download_chunk_size, size); //starting reading at the offset of ii1 relative to the start index of the chunk
-        return true;
-    }
-    else {
-        for (int jj = jj1; jj <= jj2; jj++) { //otherwise we need to step through the chunks
-            task.setProgress((jj - jj1 + 0.5) / (jj2 - jj1 + 1));
-            if (MLUtil::threadInterruptRequested()) {
-                //X = Mda32(); //maybe it's better to return the right size.
-                //task.error("Halted");
-                return false;
-            }
-            QString fname = d->download_chunk_at_index(jj); //download the chunk at index jj
-            if (fname.isEmpty()) {
-                //task.error("fname is empty *");
-                return false;
-            }
-            DiskReadMda32 A(fname);
-            if (jj == jj1) { //case 1/3, this is the first chunk
-                Mda32 tmp;
-                int size0 = (jj1 + 1) * d->m_download_chunk_size - ii1; //the size is going to be the difference between ii1 and the start index of the next chunk
-                A.readChunk(tmp, ii1 - jj1 * d->m_download_chunk_size, size0); //again we start reading at the offset of ii1 relative to the start index of the chunk
-                dtype32* tmp_ptr = tmp.dataPtr(); //copy the data directly from tmp_ptr to Xptr
-                std::copy(tmp_ptr, tmp_ptr + size0, Xptr);
-                //                int b = 0;
-                //                for (int a = 0; a < size0; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
-            else if (jj == jj2) { //case 2/3, this is the last chunk
-                Mda32 tmp;
-                int size0 = ii2 + 1 - jj2 * d->m_download_chunk_size; //the size is going to be the difference between the start index of the last chunk and ii2+1
-                A.readChunk(tmp, 0, size0); //we start reading at position zero
-                dtype32* tmp_ptr = tmp.dataPtr();
-                //copy the data to the last part of X
-                int b = size - size0;
-                std::copy(tmp_ptr, tmp_ptr + size0, Xptr + b);
-                //                for (int a = 0; a < size0; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
-
-            /*
-             ///this was the old code, which was wrong!!!!!!!!! -- fixed on 5/16/2016
-            else if (jj == jj2) {
-                Mda32 tmp;
-                int size0 = ii2 + 1 - jj2 * d->m_download_chunk_size;
-                A.readChunk(tmp, d->m_download_chunk_size - size0, size0);
-                dtype32* tmp_ptr = tmp.dataPtr();
-                int b = jj2 * d->m_download_chunk_size - ii1;
-                for (int a = 0; a < size0; a++) {
-                    Xptr[b] = tmp_ptr[a];
-                    b++;
-                }
-            }
-            */
-            else { //case 3/3, this is a middle chunk
-                Mda32 tmp;
-                A.readChunk(tmp, 0, d->m_download_chunk_size); //read the entire chunk, because we'll use it all
-                dtype32* tmp_ptr = tmp.dataPtr();
-                //const int b = jj * d->m_download_chunk_size - ii1; //we start writing at the offset between the start index of the chunk and the start index
-                std::copy(tmp_ptr, tmp_ptr + d->m_download_chunk_size, Xptr);
-                //                for (int a = 0; a < d->m_download_chunk_size; a++) {
-                //                    Xptr[b] = tmp_ptr[a];
-                //                    b++;
-                //                }
-            }
+        //the part of X covered by this chunk
+        bigint a = qMax(ii1, jj * m_download_chunk_size);
+        bigint b = qMin(ii2 + 1, (jj + 1) * m_download_chunk_size);
+        DiskReadType A(fname);
+        ArrayType tmp;
+        if (!A.readChunk(tmp, a - jj * m_download_chunk_size, b - a)) {
+            task.error() << "Problem reading downloaded chunk:" << fname;
+            return false;
         }
-        return true;
+        std::copy(tmp.dataPtr(), tmp.dataPtr() + (b - a), X.dataPtr() + (a - ii1));
     }
+    return true;
 }
 
 void RemoteReadMdaPrivate::construct_and_clear()
 {
     this->m_download_chunk_size = REMOTE_READ_MDA_CHUNK_SIZE;
+    this->m_read_ahead_chunks = REMOTE_READ_MDA_READ_AHEAD_CHUNKS;
     this->m_download_failed = false;
     this->m_info = RemoteReadMdaInfo();
     this->m_info_downloaded = false;
@@ -382,6 +295,7 @@ void RemoteReadMdaPrivate::construct_and_clear()
 void RemoteReadMdaPrivate::copy_from(const RemoteReadMda& other)
 {
     this->m_download_chunk_size = other.d->m_download_chunk_size;
+    this->m_read_ahead_chunks = other.d->m_read_ahead_chunks;
     this->m_download_failed = other.d->m_download_failed;
     this->m_info = other.d->m_info;
     this->m_info_downloaded = other.d->m_info_downloaded;
@@ -405,46 +319,108 @@ void RemoteReadMdaPrivate::download_info_if_needed()
     QString txt = MLNetwork::httpGetTextSync(url2);
     QStringList lines = txt.split("\n");
     QStringList sizes = lines.value(0).split(",");
-    m_info.N1 = sizes.value(0).toLong();
-    m_info.N2 = sizes.value(1).toLong();
-    m_info.N3 = sizes.value(2).toLong();
+    m_info.N1 = sizes.value(0).toLongLong();
+    m_info.N2 = sizes.value(1).toLongLong();
+    m_info.N3 = sizes.value(2).toLongLong();
     m_info.checksum = lines.value(1);
-    m_info.file_last_modified = QDateTime::fromMSecsSinceEpoch(lines.value(2).toLong());
+    m_info.file_last_modified = QDateTime::fromMSecsSinceEpoch(lines.value(2).toLongLong());
 }
 
-void unquantize8(Mda& X, double minval, double maxval);
-QString RemoteReadMdaPrivate::download_chunk_at_index(int ii)
+RemoteReadMdaChunkRequest RemoteReadMdaPrivate::chunk_request(bigint ii)
 {
-    TaskProgress task(QString("Download chunk at index %1 ---").arg(ii));
     download_info_if_needed();
-    int Ntot = m_info.N1 * m_info.N2 * m_info.N3;
-    int size = m_download_chunk_size;
-    if (ii * m_download_chunk_size + size > Ntot) {
-        size = Ntot - ii * m_download_chunk_size;
+    RemoteReadMdaChunkRequest R;
+    R.path = m_path;
+    R.checksum = m_info.checksum;
+    R.datatype = m_remote_datatype;
+    R.chunk_size = m_download_chunk_size;
+    R.total_size = m_info.N1 * m_info.N2 * m_info.N3;
+    R.index = ii;
+    return R;
+}
+
+QString RemoteReadMdaPrivate::download_chunk_at_index(bigint ii)
+{
+    return RemoteReadMdaDownloads::download_chunk(chunk_request(ii));
+}
+
+void RemoteReadMdaPrivate::start_downloads(bigint jj1, bigint jj2)
+{
+    using namespace RemoteReadMdaDownloads;
+    for (bigint jj = jj1; jj <= jj2; jj++) {
+        RemoteReadMdaChunkRequest R = chunk_request(jj);
+        if ((jj * R.chunk_size >= R.total_size) || (R.checksum.isEmpty()))
+            break;
+        QString fname = R.cache_file_name();
+        if (QFile::exists(fname))
+            continue;
+        QMutexLocker locker(&mutex);
+        if ((queued.contains(fname)) || (downloading.contains(fname)))
+            continue;
+        queued.insert(fname);
+        thread_pool()->start(new ChunkDownload(R));
+    }
+}
+
+QString RemoteReadMdaChunkRequest::cache_file_name() const
+{
+    //the checksum identifies the content, so the cache stays valid for as long as the file is unchanged on the server
+    QString file_name = QString("remotereadmda-%1-%2-%3-%4.mda").arg(checksum).arg(datatype).arg(chunk_size).arg(index);
+    return CacheManager::globalInstance()->makeLocalFile(file_name, CacheManager::LongTerm);
+}
+
+void unquantize8(Mda& X, double minval, double maxval);
+namespace RemoteReadMdaDownloads {
+QString download_chunk_2(const RemoteReadMdaChunkRequest& R, const QString& fname);
+
+QString download_chunk(const RemoteReadMdaChunkRequest& R)
+{
+    QString fname = R.cache_file_name();
+    {
+        //if someone else is downloading this chunk, wait for them rather than downloading it twice
+        QMutexLocker locker(&mutex);
+        queued.remove(fname);
+        while (downloading.contains(fname))
+            finished.wait(&mutex);
+        if (QFile::exists(fname))
+            return fname;
+        downloading.insert(fname);
+    }
+    QString ret = download_chunk_2(R, fname);
+    {
+        QMutexLocker locker(&mutex);
+        downloading.remove(fname);
+        finished.wakeAll();
+    }
+    return ret;
+}
+
+QString download_chunk_2(const RemoteReadMdaChunkRequest& R, const QString& fname)
+{
+    TaskProgress task(QString("Download chunk at index %1 ---").arg(R.index));
+    bigint size = R.chunk_size;
+    if (R.index * R.chunk_size + size > R.total_size) {
+        size = R.total_size - R.index * R.chunk_size;
     }
     if (size <= 0) {
-        task.log() << m_info.N1 << m_info.N2 << m_info.N3 << Ntot << m_download_chunk_size << ii;
+        task.log() << R.total_size << R.chunk_size << R.index;
         task.error() << "Size is:" << size;
         return "";
     }
-    if (m_info.checksum.isEmpty()) {
+    if (R.checksum.isEmpty()) {
         task.error() << "Info checksum is empty";
         return "";
     }
-    QString file_name = m_info.checksum + "-" + QString("%1-%2").arg(m_download_chunk_size).arg(ii);
-    QString fname = CacheManager::globalInstance()->makeLocalFile(file_name, CacheManager::ShortTerm);
-    if (QFile::exists(fname))
-        return fname;
-    QString url = m_path;
-    QString url0 = url + QString("?a=readChunk&output=text&index=%1&size=%2&datatype=%3").arg((int)(ii * m_download_chunk_size)).arg(size).arg(m_remote_datatype);
+    QString url = R.path;
+    QString url0 = url + QString("?a=readChunk&output=text&index=%1&size=%2&datatype=%3").arg(R.index * R.chunk_size).arg(size).arg(R.datatype);
     QString binary_url = MLNetwork::httpGetTextSync(url0).trimmed();
     if (binary_url.isEmpty())
         return "";
 
     //the following is ugly
-    int ind = m_path.indexOf("/mdaserver");
+    int ind = R.path.indexOf("/mdaserver");
     if (ind > 0) {
-        binary_url = m_path.mid(0, ind) + "/mdaserver/" + binary_url;
+        binary_url = R.path.mid(0, ind) + "/mdaserver/" + binary_url;
     }
 
     task.log() << "binary_url:" << binary_url;
@@ -458,39 +434,47 @@ QString RemoteReadMdaPrivate::download_chunk_at_index(int ii)
         QFile::remove(tmp_mda_fname);
         return "";
     }
-    if (m_remote_datatype == "float32_q8") {
+    if (R.datatype == "float32_q8") {
         QString dynamic_range_fname = MLNetwork::httpGetBinaryFileSync(binary_url + ".q8");
         if (dynamic_range_fname.isEmpty()) {
             qWarning() << "problem downloading .q8 file: " + binary_url + ".q8";
             task.error() << "problem downloading .q8 file: " + binary_url + ".q8";
+            QFile::remove(tmp_mda_fname);
             return "";
         }
         Mda dynamic_range(dynamic_range_fname);
+        QFile::remove(dynamic_range_fname);
         if (dynamic_range.totalSize() != 2) {
             qWarning() << QString("Problem in .q8 file. Unexpected size %1: ").arg(dynamic_range.totalSize()) + binary_url + ".q8";
             task.error() << QString("Problem in .q8 file. Unexpected size %1: ").arg(dynamic_range.totalSize()) + binary_url + ".q8";
+            QFile::remove(tmp_mda_fname);
             return "";
         }
         Mda chunk(tmp_mda_fname);
+        QFile::remove(tmp_mda_fname);
         unquantize8(chunk, dynamic_range.value(0), dynamic_range.value(1));
-        if (!chunk.write32(fname)) {
+        //write next to the cache file and rename, so that the cache never holds a partial chunk
+        tmp_mda_fname = fname + ".tmp." + MLUtil::makeRandomId(5);
+        if (!chunk.write32(tmp_mda_fname)) {
             QFile::remove(tmp_mda_fname);
-            qWarning() << "Unable to write file: " + fname;
-            task.error() << "Unable to write file: " + fname;
+            qWarning() << "Unable to write file: " + tmp_mda_fname;
+            task.error() << "Unable to write file: " + tmp_mda_fname;
             return "";
         }
-        QFile::remove(tmp_mda_fname);
     }
-    else {
-        if (!QFile::rename(tmp_mda_fname, fname)) {
-            QFile::remove(tmp_mda_fname);
-            qWarning() << "Unable to rename file: " << tmp_mda_fname << fname;
-            task.error() << "Unable to rename file: " << tmp_mda_fname << fname;
-            return "";
+    if (!QFile::rename(tmp_mda_fname, fname)) {
+        QFile::remove(tmp_mda_fname);
+        if (QFile::exists(fname)) {
+            //another process downloaded the same chunk
+            return fname;
         }
+        qWarning() << "Unable to rename file: " << tmp_mda_fname << fname;
+        task.error() << "Unable to rename file: " << tmp_mda_fname << fname;
+        return "";
     }
     return fname;
 }
+}
 
 void unit_test_remote_read_mda()
 {
@@ -26,6 +26,9 @@
 #include "mlnetwork.h"
 
 #define PRV_VERSION "0.11"
+#define TREE_CHECKSUM_NAME "sha1tree"
+#define TREE_CHECKSUM_PRV_KEY "original_checksum_sha1tree" //recorded next to original_checksum, which is always the sha1
+#define HEAD1000_BUG_FCS_VALUE "da39a3ee5e6b4b0d3255bfef95601890afd80709"
 
 #ifdef QT_GUI_LIB
 #include <QtNetwork/QNetworkAccessManager>
@@ -226,6 +229,8 @@ void MLUtil::mkdirIfNeeded(const QString& path)
 }
 
 #include "sumit.h"
+#include "prvindex.h"
+#include <thread>
 QString MLUtil::computeSha1SumOfFile(const QString& path)
 {
     //printf("Looking up sha1: %s\n",path.toUtf8().data());
@@ -251,6 +256,45 @@ QString MLUtil::computeSha1SumOfDirectory(const QString& path)
     return sumit_dir(path, MLUtil::tempPath());
 }
 
+QString MLUtil::computeTreeChecksumOfFile(const QString& path)
+{
+    QString hash = sumit_tree(path, MLUtil::tempPath());
+    if (hash.isEmpty())
+        return "";
+    return QString(TREE_CHECKSUM_NAME) + "-" + hash;
+}
+
+QString compute_checksum_of_same_kind(const QString& path, const QString& checksum)
+{
+    //a plain sha1 has no label
+    int ind0 = checksum.indexOf("-");
+    if (ind0 < 0)
+        return MLUtil::computeSha1SumOfFile(path);
+
+    QString checksum_name = checksum.mid(0, ind0);
+    if (checksum_name == TREE_CHECKSUM_NAME) {
+        return MLUtil::computeTreeChecksumOfFile(path);
+    }
+    else {
+        qWarning() << "Unknown checksum name: " + checksum;
+        return "";
+    }
+}
+
+bool MLUtil::matchesChecksum(QString path, QString checksum)
+{
+    QString checksum1 = compute_checksum_of_same_kind(path, checksum);
+    return ((!checksum1.isEmpty()) && (checksum1 == checksum));
+}
+
+QString MLUtil::prvLocalChecksum(const QJsonObject& prv_object)
+{
+    QString tree_checksum = prv_object[TREE_CHECKSUM_PRV_KEY].toString();
+    if (!tree_checksum.isEmpty())
+        return tree_checksum;
+    return prv_object["original_checksum"].toString();
+}
+
 static QString s_temp_path = "";
 QString MLUtil::tempPath()
 {
@@ -963,7 +1007,7 @@ bool MLUtil::matchesFastChecksum(QString path, QString fcs)
     QString fcs_value = fcs.mid(ind0 + 1);
 
     if (fcs_name == "head1000") {
-        if (fcs_value == "da39a3ee5e6b4b0d3255bfef95601890afd80709") {
+        if (fcs_value == HEAD1000_BUG_FCS_VALUE) {
             // Need to handle this exceptional case because there was a bug in the initial implementation where all the head1000 fcs values were computed incorrectly to this value, which I believe is the checksum of an empty string
             return true;
         }
@@ -1005,7 +1049,7 @@ double MLCompute::stdev(bigint N, const float* X)
         return 0;
 }
 
-QJsonObject MLUtil::createPrvObject(const QString& file_or_dir_path)
+QJsonObject MLUtil::createPrvObject(const QString& file_or_dir_path, bool tree_checksum)
 {
     qDebug().noquote() << "Creating prv object for: " + file_or_dir_path;
     QString path = file_or_dir_path;
@@ -1013,7 +1057,17 @@ QJsonObject MLUtil::createPrvObject(const QString& file_or_dir_path)
         QJsonObject obj;
         obj["prv_version"] = PRV_VERSION;
         obj["original_path"] = path;
+        //The sha1 is always recorded, since it is what servers (and older readers) know the file by, so the tree
+        //checksum cannot save its serial pass over the file; it is computed alongside, and adds no time beyond that pass
+        QString tree_checksum_value;
+        std::thread tree_thread;
+        if (tree_checksum)
+            tree_thread = std::thread([&tree_checksum_value, path]() { tree_checksum_value = MLUtil::computeTreeChecksumOfFile(path); });
         obj["original_checksum"] = MLUtil::computeSha1SumOfFile(path);
+        if (tree_checksum) {
+            tree_thread.join();
+            obj[TREE_CHECKSUM_PRV_KEY] = tree_checksum_value;
+        }
         obj["original_fcs"] = "head1000-" + MLUtil::computeSha1SumOfFileHead(path, 1000);
         obj["original_size"] = QFileInfo(path).size();
         return obj;
@@ -1026,10 +1080,17 @@ QJsonObject MLUtil::createPrvObject(const QString& file_or_dir_path)
 
         QJsonArray files_array;
         QStringList file_list = QDir(dir_path).entryList(QStringList("*"), QDir::Files, QDir::Name);
+        //compute the sha1 sums concurrently, so that createPrvObject below finds them in the cache
+        //(tree checksums are already computed in parallel within each file)
+        QStringList file_paths;
+        foreach (QString file, file_list) {
+            file_paths << dir_path + "/" + file;
+        }
+        sumit_files(file_paths, MLUtil::tempPath());
         foreach (QString file, file_list) {
             QJsonObject obj0;
             obj0["name"] = file;
-            obj0["prv"] = MLUtil::createPrvObject(dir_path + "/" + file);
+            obj0["prv"] = MLUtil::createPrvObject(dir_path + "/" + file, tree_checksum);
             files_array.push_back(obj0);
         }
         if (!files_array.isEmpty())
@@ -1040,7 +1101,7 @@ QJsonObject MLUtil::createPrvObject(const QString& file_or_dir_path)
         foreach (QString dir, dir_list) {
             QJsonObject obj0;
             obj0["name"] = dir;
-            obj0["prv"] = MLUtil::createPrvObject(dir_path + "/" + dir);
+            obj0["prv"] = MLUtil::createPrvObject(dir_path + "/" + dir, tree_checksum);
             dirs_array.push_back(obj0);
         }
         if (!dirs_array.isEmpty())
@@ -1059,8 +1120,8 @@ bool file_matches_prv_object(QString file_path, const QJsonObject& obj)
         if (QFileInfo(file_path).size() == original_size) {
             QString fcs = obj["original_fcs"].toString();
             if (MLUtil::matchesFastChecksum(file_path, fcs)) {
-                QString checksum = obj["original_checksum"].toString();
-                if (MLUtil::computeSha1SumOfFile(file_path) == checksum) {
+                QString checksum = MLUtil::prvLocalChecksum(obj);
+                if (MLUtil::matchesChecksum(file_path, checksum)) {
                     return true;
                 }
             }
@@ -1151,66 +1212,72 @@ QString find_directory_in_search_paths(const QJsonObject& obj, const QStringList
     return "";
 }
 
-QString find_file_2(QString directory, QString checksum, QString fcs_optional, bigint size, bool recursive, bool verbose)
-{
-    QStringList files = QDir(directory).entryList(QStringList("*"), QDir::Files, QDir::Name);
-    foreach (QString file, files) {
-        QString path = directory + "/" + file;
-        if (QFileInfo(path).size() == size) {
-            if (!fcs_optional.isEmpty()) {
-                if (verbose)
-                    printf("Fast checksum test for %s\n", path.toUtf8().data());
-                if (MLUtil::matchesFastChecksum(path, fcs_optional)) {
-                    if (verbose)
-                        printf("Matches. Computing full checksum...\n");
-                    QString checksum1 = MLUtil::computeSha1SumOfFile(path);
-                    if (checksum1 == checksum) {
-                        if (verbose)
-                            printf("Matches.\n");
-                        return path;
-                    }
-                    else {
-                        if (verbose)
-                            printf("Does not match.\n");
-                    }
-                }
-                else {
-                    if (verbose)
-                        printf("Does not match.\n");
-                }
-            }
-            else {
+QString find_indexed_file(bigint size, const QString& checksum, const QString& fcs_optional, const QStringList& local_search_paths, bool verbose)
+{
+    PrvIndex* index = PrvIndex::globalInstance();
+    QString fcs = fcs_optional;
+    if (fcs == QString("head1000-") + HEAD1000_BUG_FCS_VALUE)
+        fcs = ""; //matches anything, see matchesFastChecksum
+    foreach (QString path, index->candidates(size, checksum, fcs, local_search_paths)) {
+        if (!index->refresh(path))
+            continue;
+        if (QFileInfo(path).size() != size)
+            continue;
+        if (fcs.startsWith("head1000-")) {
+            if (verbose)
+                printf("Fast checksum test for %s\n", path.toUtf8().data());
+            QString fcs1 = "head1000-" + MLUtil::computeSha1SumOfFileHead(path, 1000);
+            index->recordFcs(path, fcs1);
+            if (fcs1 != fcs) {
                 if (verbose)
-                    printf("Computing sha1 sum for: %s\n", path.toUtf8().data());
-                QString checksum1 = MLUtil::computeSha1SumOfFile(path);
-                if (checksum1 == checksum) {
-                    return path;
-                }
+                    printf("Does not match.\n");
+                continue;
             }
         }
-    }
-    if (recursive) {
-        QStringList dirs = QDir(directory).entryList(QStringList("*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-        foreach (QString dir, dirs) {
-            QString path = find_file_2(directory + "/" + dir, checksum, fcs_optional, size, recursive, verbose);
-            if (!path.isEmpty())
-                return path;
+        else if (!MLUtil::matchesFastChecksum(path, fcs)) {
+            continue;
+        }
+        if (verbose)
+            printf("Computing checksum for: %s\n", path.toUtf8().data());
+        QString checksum1 = compute_checksum_of_same_kind(path, checksum);
+        index->recordChecksum(path, checksum1);
+        if ((!checksum1.isEmpty()) && (checksum1 == checksum)) {
+            if (verbose)
+                printf("Matches.\n");
+            return path;
         }
+        if (verbose)
+            printf("Does not match.\n");
     }
     return "";
 }
 
 QString find_local_file(bigint size, const QString& checksum, const QString& fcs_optional, const QStringList& local_search_paths, bool verbose)
 {
-    for (int i = 0; i < local_search_paths.count(); i++) {
-        QString search_path = local_search_paths[i];
-        if (verbose)
-            qDebug().noquote() << "Searching: " + search_path;
-        QString fname = find_file_2(search_path, checksum, fcs_optional, size, true, verbose);
-        if (!fname.isEmpty())
-            return fname;
+    //look the file up in the index; if it is not there, bring the index up to date with a stat-only rescan and look again.
+    //The rescan only lists the directories that changed since the last one, so a lookup of a file that is not here at
+    //all (e.g. only on a server) costs a stat of each directory and indexed file
+    PrvIndex* index = PrvIndex::globalInstance();
+    QString fname = find_indexed_file(size, checksum, fcs_optional, local_search_paths, verbose);
+    if (fname.isEmpty()) {
+        for (int i = 0; i < local_search_paths.count(); i++) {
+            if (verbose)
+                qDebug().noquote() << "Rescanning: " + local_search_paths[i];
+            index->rescan(local_search_paths[i]);
+        }
+        fname = find_indexed_file(size, checksum, fcs_optional, local_search_paths, verbose);
     }
-    return "";
+    index->save();
+    return fname;
+}
+
+void MLUtil::rescanPrvIndex(const QStringList& search_paths)
+{
+    PrvIndex* index = PrvIndex::globalInstance();
+    for (int i = 0; i < search_paths.count(); i++) {
+        index->rescan(search_paths[i]);
+    }
+    index->save();
 }
 
 QString MLUtil::locatePrv(const QJsonObject& obj, const QStringList& local_search_paths)
@@ -1218,14 +1285,14 @@ QString MLUtil::locatePrv(const QJsonObject& obj, const QStringList& local_searc
     if (obj.contains("original_checksum")) {
         //it is a file
         bigint size = obj["original_size"].toVariant().toLongLong();
-        QString checksum = obj["original_checksum"].toString();
+        QString checksum = MLUtil::prvLocalChecksum(obj);
         QString fcs = obj["original_fcs"].toString();
         QString original_path = obj["original_path"].toString();
         if (!original_path.isEmpty()) {
             if (QFile::exists(original_path)) {
                 if (QFileInfo(original_path).size() == size) {
                     if (matchesFastChecksum(original_path, fcs)) {
-                        if (MLUtil::computeSha1SumOfFile(original_path) == checksum) {
+                        if (MLUtil::matchesChecksum(original_path, checksum)) {
                             return original_path;
                         }
                     }
@@ -14,13 +14,16 @@ TEMPLATE = lib
 
 INCLUDEPATH += ../include
 VPATH += ../include
-HEADERS += mlcommon.h sumit.h \
+HEADERS += mlcommon.h sumit.h sumitcache.h prvindex.h \
     ../include/mda/mda32.h \
     ../include/mda/diskreadmda32.h \
+    ../include/mda/mda16.h \
+    ../include/mda/diskreadmda16.h \
     ../include/mda/mda_p.h \
     ../include/mliterator.h \
     ../include/mda/mdareader.h \
     ../include/mda/mdareader_p.h \
+    ../include/mda/mdasubblock_p.h \
     ../include/objectregistry.h \
     ../include/mlprivate.h \
     ../include/icounter.h \
@@ -29,9 +32,11 @@ HEADERS += mlcommon.h sumit.h \
     ../include/mllog.h
 
 SOURCES += \
-    mlcommon.cpp sumit.cpp \
+    mlcommon.cpp sumit.cpp sumitcache.cpp prvindex.cpp \
     mda/mda32.cpp \
     mda/diskreadmda32.cpp \
+    mda/mda16.cpp \
+    mda/diskreadmda16.cpp \
     objectregistry.cpp \
     mda/mdareader.cpp \
     componentmanager/icomponent.cpp \
@@ -43,8 +48,8 @@ SOURCES += \
 INCLUDEPATH += ../include/mda
 VPATH += ../include/mda
 VPATH += mda
-HEADERS += diskreadmda.h diskwritemda.h mda.h mdaio.h remotereadmda.h usagetracking.h
-SOURCES += diskreadmda.cpp diskwritemda.cpp mda.cpp mdaio.cpp remotereadmda.cpp usagetracking.cpp
+HEADERS += diskreadmda.h diskwritemda.h mda.h mdaio.h mdaioprofile.h mdammap.h mdapool.h mdaprefetcher.h mdastream.h mdaview.h mdazio.h remotereadmda.h usagetracking.h
+SOURCES += diskreadmda.cpp diskwritemda.cpp mda.cpp mdaio.cpp mdaioconvert.cpp mdaioprofile.cpp mdammap.cpp mdapool.cpp mdaprefetcher.cpp mdastream.cpp mdazio.cpp remotereadmda.cpp usagetracking.cpp
 
 INCLUDEPATH += ../include/cachemanager
 VPATH += ../include/cachemanager
@@ -5,6 +5,7 @@
 #include <QFileInfo>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QThreadStorage>
 #include <cachemanager.h>
 #include "mlcommon.h"
 #include <QCoreApplication>
@@ -13,12 +14,13 @@
 
 namespace MLNetwork {
 
-static QNetworkAccessManager* s_manager = 0;
 QNetworkAccessManager* manager()
 {
-    if (!s_manager)
-        s_manager = new QNetworkAccessManager;
-    return s_manager;
+    //one per thread: a manager delivers its replies in the thread it lives in, and the sync calls wait by processing the events of their own thread
+    static QThreadStorage<QNetworkAccessManager*> managers;
+    if (!managers.hasLocalData())
+        managers.setLocalData(new QNetworkAccessManager);
+    return managers.localData();
 }
 
 Downloader::~Downloader()
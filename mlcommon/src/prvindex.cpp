@@ -0,0 +1,367 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#include "prvindex.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <stdio.h>
+#include <sys/stat.h>
+
+bool stat_prv_index_entry(const QString& path, PrvIndexEntry& E)
+{
+    struct stat SS;
+    if (stat(path.toUtf8().data(), &SS) != 0)
+        return false;
+    if (!S_ISREG(SS.st_mode))
+        return false;
+    E.size = SS.st_size;
+    E.modified_msec = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    E.inode = SS.st_ino;
+    return true;
+}
+
+qint64 directory_modified_nsec(const QString& path)
+{
+    //-1 if it is not a directory
+    struct stat SS;
+    if (stat(path.toUtf8().data(), &SS) != 0)
+        return -1;
+    if (!S_ISDIR(SS.st_mode))
+        return -1;
+#ifdef __APPLE__
+    return SS.st_mtimespec.tv_sec * (qint64)1000000000 + SS.st_mtimespec.tv_nsec;
+#else
+    return SS.st_mtim.tv_sec * (qint64)1000000000 + SS.st_mtim.tv_nsec;
+#endif
+}
+
+QString parent_directory(const QString& path)
+{
+    int ind0 = path.lastIndexOf("/");
+    if (ind0 == 0)
+        return "/";
+    return path.mid(0, ind0);
+}
+
+QString checksum_kind(const QString& checksum)
+{
+    //a plain sha1 has no label
+    int ind0 = checksum.indexOf("-");
+    if (ind0 < 0)
+        return "sha1";
+    return checksum.mid(0, ind0);
+}
+
+QString canonical_search_path(const QString& path)
+{
+    //so that relative paths and trailing slashes compare equal to the indexed paths
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
+
+bool is_under_search_path(const QString& path, const QString& search_path)
+{
+    //both canonical
+    if (search_path.endsWith("/"))
+        return path.startsWith(search_path); //the root
+    return path.startsWith(search_path + "/");
+}
+
+bool is_under_search_paths(const QString& path, const QStringList& search_paths)
+{
+    foreach (QString search_path, search_paths) {
+        if (is_under_search_path(path, canonical_search_path(search_path)))
+            return true;
+    }
+    return false;
+}
+
+PrvIndex::PrvIndex(const QString& index_path)
+    : m_index_path(index_path)
+{
+    load();
+}
+
+QStringList PrvIndex::candidates(bigint size, const QString& checksum, const QString& fcs, const QStringList& search_paths)
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList ret;
+    foreach (QString path, m_paths_by_checksum.values(checksum)) {
+        if (is_under_search_paths(path, search_paths))
+            ret << path;
+    }
+    QString kind = checksum_kind(checksum);
+    QStringList same_fcs, unknown_fcs;
+    foreach (QString path, m_paths_by_size.values(size)) {
+        if ((ret.contains(path)) || (!is_under_search_paths(path, search_paths)))
+            continue;
+        PrvIndexEntry E = m_entries.value(path);
+        bool has_other_checksum = false;
+        foreach (QString checksum0, E.checksums) {
+            if (checksum_kind(checksum0) == kind)
+                has_other_checksum = true;
+        }
+        if (has_other_checksum)
+            continue;
+        if ((fcs.isEmpty()) || (E.fcs.isEmpty()))
+            unknown_fcs << path;
+        else if (E.fcs == fcs)
+            same_fcs << path;
+    }
+    ret.append(same_fcs);
+    ret.append(unknown_fcs);
+    return ret;
+}
+
+bool PrvIndex::refresh(const QString& path)
+{
+    QMutexLocker locker(&m_mutex);
+    PrvIndexEntry E;
+    if (!stat_prv_index_entry(path, E)) {
+        remove(path);
+        return false;
+    }
+    PrvIndexEntry E0 = m_entries.value(path);
+    if ((m_entries.contains(path)) && (E0.size == E.size) && (E0.modified_msec == E.modified_msec) && (E0.inode == E.inode))
+        return true;
+    remove(path);
+    insert(path, E);
+    return true;
+}
+
+void PrvIndex::recordFcs(const QString& path, const QString& fcs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_entries.contains(path))
+        return;
+    if (m_entries[path].fcs == fcs)
+        return;
+    m_entries[path].fcs = fcs;
+    m_modified = true;
+}
+
+void PrvIndex::recordChecksum(const QString& path, const QString& checksum)
+{
+    QMutexLocker locker(&m_mutex);
+    if ((!m_entries.contains(path)) || (checksum.isEmpty()))
+        return;
+    PrvIndexEntry E = m_entries.value(path);
+    if (E.checksums.contains(checksum))
+        return;
+    remove(path);
+    E.checksums << checksum;
+    insert(path, E);
+}
+
+void PrvIndex::rescan(const QString& search_path)
+{
+    QMutexLocker locker(&m_mutex);
+    do_rescan(canonical_search_path(search_path));
+}
+
+int PrvIndex::fileCount()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.count();
+}
+
+bool PrvIndex::save()
+{
+    QMutexLocker locker(&m_mutex);
+    if ((!m_modified) || (m_index_path.isEmpty()))
+        return true;
+    QJsonObject files;
+    foreach (QString path, m_entries.keys()) {
+        PrvIndexEntry E = m_entries.value(path);
+        QJsonObject obj;
+        obj["size"] = (long long)E.size;
+        obj["modified_msec"] = E.modified_msec;
+        obj["inode"] = E.inode;
+        if (!E.fcs.isEmpty())
+            obj["fcs"] = E.fcs;
+        if (!E.checksums.isEmpty())
+            obj["checksums"] = QJsonArray::fromStringList(E.checksums);
+        files[path] = obj;
+    }
+    QJsonObject directories;
+    foreach (QString path, m_directories.keys()) {
+        PrvIndexDirectory D = m_directories.value(path);
+        QJsonObject obj;
+        obj["modified_nsec"] = D.modified_nsec;
+        obj["subdirs"] = QJsonArray::fromStringList(D.subdirs);
+        directories[path] = obj;
+    }
+    QJsonObject index;
+    index["files"] = files;
+    index["directories"] = directories;
+    //write and rename, so that a reader never sees a partial index
+    QString tmp_fname = m_index_path + ".tmp." + MLUtil::makeRandomId(5);
+    if (!TextFile::write(tmp_fname, QJsonDocument(index).toJson(QJsonDocument::Compact))) {
+        qWarning() << "Unable to write prv index:" << tmp_fname;
+        return false;
+    }
+    if (::rename(tmp_fname.toUtf8().data(), m_index_path.toUtf8().data()) != 0) {
+        QFile::remove(tmp_fname);
+        qWarning() << "Unable to rename prv index:" << tmp_fname << m_index_path;
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
+
+PrvIndex* PrvIndex::globalInstance()
+{
+    static PrvIndex* index = 0;
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if (!index)
+        index = new PrvIndex(MLUtil::tempPath() + "/" + PRV_INDEX_FILE_NAME);
+    return index;
+}
+
+void PrvIndex::load()
+{
+    if ((m_index_path.isEmpty()) || (!QFile::exists(m_index_path)))
+        return;
+    QJsonObject index = QJsonDocument::fromJson(TextFile::read(m_index_path).toUtf8()).object();
+    QJsonObject files = index["files"].toObject();
+    foreach (QString path, files.keys()) {
+        QJsonObject obj = files[path].toObject();
+        PrvIndexEntry E;
+        E.size = obj["size"].toVariant().toLongLong();
+        E.modified_msec = obj["modified_msec"].toVariant().toLongLong();
+        E.inode = obj["inode"].toVariant().toLongLong();
+        E.fcs = obj["fcs"].toString();
+        E.checksums = MLUtil::toStringList(obj["checksums"].toVariant());
+        E.checksums.removeAll("");
+        insert(path, E);
+    }
+    QJsonObject directories = index["directories"].toObject();
+    foreach (QString path, directories.keys()) {
+        QJsonObject obj = directories[path].toObject();
+        PrvIndexDirectory D;
+        D.modified_nsec = obj["modified_nsec"].toVariant().toLongLong();
+        D.subdirs = MLUtil::toStringList(obj["subdirs"].toVariant());
+        D.subdirs.removeAll("");
+        m_directories[path] = D;
+    }
+    m_modified = false;
+}
+
+void PrvIndex::insert(const QString& path, const PrvIndexEntry& E)
+{
+    m_entries[path] = E;
+    m_paths_by_size.insert(E.size, path);
+    foreach (QString checksum, E.checksums) {
+        m_paths_by_checksum.insert(checksum, path);
+    }
+    m_modified = true;
+}
+
+void PrvIndex::remove(const QString& path)
+{
+    if (!m_entries.contains(path))
+        return;
+    PrvIndexEntry E = m_entries.take(path);
+    m_paths_by_size.remove(E.size, path);
+    foreach (QString checksum, E.checksums) {
+        m_paths_by_checksum.remove(checksum, path);
+    }
+    m_modified = true;
+}
+
+void PrvIndex::do_rescan(const QString& search_path)
+{
+    //the known files of each directory, for the directories that are not listed again
+    QHash<QString, QStringList> files_by_directory;
+    foreach (QString path, m_entries.keys()) {
+        if (is_under_search_path(path, search_path))
+            files_by_directory[parent_directory(path)] << path;
+    }
+    qint64 rescan_start_nsec = QDateTime::currentMSecsSinceEpoch() * 1000000;
+    QSet<QString> seen, seen_directories;
+    rescan_directory(search_path, files_by_directory, rescan_start_nsec, seen, seen_directories);
+    foreach (QString path, m_entries.keys()) {
+        if ((is_under_search_path(path, search_path)) && (!seen.contains(path)))
+            remove(path);
+    }
+    //the directory records are only bookkeeping: they are saved along with the files, but do not by themselves make the index modified
+    foreach (QString path, m_directories.keys()) {
+        if (((path == search_path) || (is_under_search_path(path, search_path))) && (!seen_directories.contains(path)))
+            m_directories.remove(path);
+    }
+}
+
+bool PrvIndex::is_excluded_directory(const QString& path) const
+{
+    //the legacy per-file sumit cache and the sumit logs, kept in the same directory as the index
+    return (path == canonical_search_path(QFileInfo(m_index_path).absolutePath() + "/sumit"));
+}
+
+bool PrvIndex::is_excluded_file_name(const QString& name)
+{
+    //the index and its temporary copies, logs, and files being written (DiskWriteMda, TextFile, downloads)
+    static const QStringList patterns = QStringList() << PRV_INDEX_FILE_NAME "*"
+                                                      << "mountainprocess_log.*"
+                                                      << "*.tmp.*"
+                                                      << "*.tf.*.tmp"
+                                                      << "*.mda.tmp"
+                                                      << "*.json.tmp";
+    return QDir::match(patterns, name);
+}
+
+void PrvIndex::rescan_directory(const QString& path, const QHash<QString, QStringList>& files_by_directory, qint64 rescan_start_nsec, QSet<QString>& seen, QSet<QString>& seen_directories)
+{
+    if (is_excluded_directory(path))
+        return;
+    qint64 modified_nsec = directory_modified_nsec(path);
+    if (modified_nsec < 0)
+        return;
+    seen_directories.insert(path);
+    QString prefix = path.endsWith("/") ? path : path + "/";
+    //a directory whose modification time is unchanged has the same entries, so only its known files need a stat
+    PrvIndexDirectory D0 = m_directories.value(path);
+    bool unchanged = ((m_directories.contains(path)) && (D0.modified_nsec >= 0) && (D0.modified_nsec == modified_nsec));
+    QStringList files, dirs;
+    if (unchanged) {
+        foreach (QString path0, files_by_directory.value(path)) {
+            files << path0.mid(prefix.count());
+        }
+        dirs = D0.subdirs;
+    }
+    else {
+        files = QDir(path).entryList(QStringList("*"), QDir::Files, QDir::Name);
+        dirs = QDir(path).entryList(QStringList("*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    }
+    foreach (QString file, files) {
+        if (is_excluded_file_name(file))
+            continue;
+        QString path0 = prefix + file;
+        PrvIndexEntry E;
+        if (!stat_prv_index_entry(path0, E))
+            continue;
+        seen.insert(path0);
+        PrvIndexEntry E0 = m_entries.value(path0);
+        if ((m_entries.contains(path0)) && (E0.size == E.size) && (E0.modified_msec == E.modified_msec) && (E0.inode == E.inode))
+            continue;
+        remove(path0);
+        insert(path0, E);
+    }
+    //an entry added within the timestamp granularity of the listing may not have changed the modification time, so a
+    //directory modified just before the rescan is listed again next time
+    PrvIndexDirectory D;
+    D.modified_nsec = (modified_nsec < rescan_start_nsec - PRV_INDEX_RECENT_DIRECTORY_NSEC) ? modified_nsec : -1;
+    D.subdirs = dirs;
+    m_directories[path] = D;
+    foreach (QString dir, dirs) {
+        rescan_directory(prefix + dir, files_by_directory, rescan_start_nsec, seen, seen_directories);
+    }
+}
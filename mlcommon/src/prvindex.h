@@ -0,0 +1,85 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef PRVINDEX_H
+#define PRVINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include "mlcommon.h"
+
+#define PRV_INDEX_FILE_NAME "prv_index.json"
+#define PRV_INDEX_RECENT_DIRECTORY_NSEC 2000000000LL //a directory modified this recently before a rescan is listed again on the next one
+
+/*
+Persistent index of the local files that prv objects may refer to, so that MLUtil::locatePrv can look up candidates
+instead of walking the search paths on every call. It is stored as JSON in the temporary path.
+
+Each file is recorded with its size, modification time and inode, together with whatever is known of its fast checksum
+(fcs) and full checksums (of any kind, see MLUtil::matchesChecksum). A rescan only stats files: new or changed files are
+recorded without checksums, which are filled in as lookups compute them. The modification time and subdirectories of
+each scanned directory are kept too, so that a directory that has not changed since is not listed again (its known
+files are still re-statted, which catches files rewritten in place). Nothing in the index is trusted without a
+check: a candidate is re-statted before use, and its checksum is confirmed through sumit (which is cached).
+
+Search paths are compared in absolute, cleaned form. Our own bookkeeping beside the index (the index itself, the sumit
+cache, logs and half-written temporary files) is never indexed, since it changes all the time and no prv refers to it.
+
+Several processes may use the index at once; each saves its own view, so the last writer wins. Since everything is
+verified, a lost update only costs recomputation.
+*/
+
+struct PrvIndexEntry {
+    bigint size = 0;
+    qint64 modified_msec = 0;
+    qint64 inode = 0;
+    QString fcs; //empty until computed
+    QStringList checksums; //empty until computed
+};
+
+struct PrvIndexDirectory {
+    qint64 modified_nsec = -1; //-1 if it is to be listed again on the next rescan
+    QStringList subdirs;
+};
+
+class PrvIndex {
+public:
+    PrvIndex(const QString& index_path);
+
+    ///Indexed files under one of the search paths that may have the checksum, most likely first
+    QStringList candidates(bigint size, const QString& checksum, const QString& fcs, const QStringList& search_paths);
+    ///Re-stat the file, forgetting its checksums if it changed. Returns false (and drops it) if it is gone
+    bool refresh(const QString& path);
+    void recordFcs(const QString& path, const QString& fcs);
+    void recordChecksum(const QString& path, const QString& checksum);
+    ///Stat every file under search_path (no reading or hashing), adding new files and dropping missing ones. Only the directories that changed since the last rescan are listed
+    void rescan(const QString& search_path);
+    int fileCount();
+
+    bool save(); //does nothing unless a file was added, changed or dropped, or a checksum recorded
+
+    static PrvIndex* globalInstance();
+
+private:
+    QString m_index_path;
+    QHash<QString, PrvIndexEntry> m_entries; //by path
+    QMultiHash<QString, QString> m_paths_by_checksum;
+    QMultiHash<bigint, QString> m_paths_by_size;
+    QHash<QString, PrvIndexDirectory> m_directories; //by path
+    bool m_modified = false;
+    QMutex m_mutex;
+
+    void load();
+    void insert(const QString& path, const PrvIndexEntry& E);
+    void remove(const QString& path);
+    void rescan_directory(const QString& path, const QHash<QString, QStringList>& files_by_directory, qint64 rescan_start_nsec, QSet<QString>& seen, QSet<QString>& seen_directories);
+    void do_rescan(const QString& search_path);
+    bool is_excluded_directory(const QString& path) const;
+    static bool is_excluded_file_name(const QString& name);
+};
+
+#endif // PRVINDEX_H
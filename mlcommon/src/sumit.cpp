@@ -5,16 +5,23 @@
 *******************************************************/
 
 #include "sumit.h"
+#include "sumitcache.h"
 
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QCryptographicHash>
 #include <QDir>
 #include <QStringList>
 #include <QTime>
 #include <QDataStream>
 #include <sys/stat.h>
+#include <atomic>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 QString compute_the_file_hash(const QString& path, int num_bytes)
 {
@@ -39,6 +46,66 @@ QString compute_the_file_hash(const QString& path, int num_bytes)
     return ret;
 }
 
+bool compute_the_block_hash(int fd, qint64 offset, qint64 size, QByteArray& buffer, QByteArray& digest)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    qint64 num_bytes_processed = 0;
+    while (num_bytes_processed < size) {
+        qint64 num_bytes = qMin((qint64)buffer.size(), size - num_bytes_processed);
+        ssize_t num_read = pread(fd, buffer.data(), num_bytes, offset + num_bytes_processed);
+        if (num_read <= 0)
+            return false;
+        hash.addData(buffer.constData(), num_read);
+        num_bytes_processed += num_read;
+    }
+    digest = hash.result();
+    return true;
+}
+
+QString compute_the_file_tree_hash(const QString& path)
+{
+    // Do not printf here!
+    int fd = open(path.toUtf8().data(), O_RDONLY);
+    if (fd < 0)
+        return "";
+    struct stat SS;
+    if (fstat(fd, &SS) != 0) {
+        close(fd);
+        return "";
+    }
+    const qint64 size = SS.st_size;
+    const qint64 num_blocks = (size + SUMIT_TREE_BLOCK_SIZE - 1) / SUMIT_TREE_BLOCK_SIZE;
+
+    //each thread takes the next block and reads it sequentially in large reads
+    std::vector<QByteArray> digests(num_blocks);
+    std::atomic<qint64> next_block(0);
+    std::atomic<bool> ok(true);
+    auto hash_blocks = [&]() {
+        QByteArray buffer(SUMIT_TREE_READ_SIZE, 0);
+        qint64 b;
+        while ((ok) && ((b = next_block++) < num_blocks)) {
+            qint64 offset = b * SUMIT_TREE_BLOCK_SIZE;
+            if (!compute_the_block_hash(fd, offset, qMin((qint64)SUMIT_TREE_BLOCK_SIZE, size - offset), buffer, digests[b]))
+                ok = false;
+        }
+    };
+    qint64 num_threads = qMax((qint64)1, qMin((qint64)std::thread::hardware_concurrency(), num_blocks));
+    std::vector<std::thread> threads;
+    for (qint64 t = 1; t < num_threads; t++)
+        threads.push_back(std::thread(hash_blocks));
+    hash_blocks();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    close(fd);
+    if (!ok)
+        return "";
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (size_t b = 0; b < digests.size(); b++)
+        hash.addData(digests[b]);
+    return QString(hash.result().toHex());
+}
+
 QString compute_the_string_hash(const QString& str)
 {
     QCryptographicHash X(QCryptographicHash::Sha1);
@@ -76,10 +143,43 @@ void write_text_file(const QString& path, const QString& txt)
     out << txt;
 }
 
-void create_hash_file(const QString& path, const QString& hash_path)
+typedef QString (*FileHashFunction)(const QString& path);
+
+QString compute_the_full_file_hash(const QString& path)
+{
+    return compute_the_file_hash(path, 0);
+}
+
+QString legacy_cached_file_hash(const QString& path, const QString& temporary_path, const QString& hash_kind)
 {
-    QString the_hash = compute_the_file_hash(path, 0);
-    write_text_file(hash_path, the_hash);
+    //the cache used to be one file per hashed file, named by a hash of the path, size and modification time (in ms)
+    QFileInfo info(path);
+    QString id_string = QString("%1:%2:%3:%4").arg(path).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size());
+    QString file_id = compute_the_string_hash(id_string);
+    QString hash_path = QString(temporary_path + "/sumit/%1/%2/%3").arg(hash_kind).arg(file_id.mid(0, 4)).arg(file_id);
+    return read_text_file(hash_path).trimmed();
+}
+
+QString cached_file_hash(const QString& path, const QString& temporary_path, const QString& hash_kind, FileHashFunction compute_hash)
+{
+    //the key is taken before hashing, so that a file modified meanwhile is not recorded under its new key
+    //note that it is not dependent on the file name
+    SumitFileKey key;
+    if (!SumitFileKey::fromFile(path, key))
+        return "";
+
+    create_directory_if_doesnt_exist(temporary_path + "/sumit");
+    SumitCache* cache = SumitCache::instance(QString("%1/sumit/%2.log").arg(temporary_path).arg(hash_kind));
+    QString hash_sum = cache->lookup(key);
+    if (hash_sum.count() == 40)
+        return hash_sum;
+
+    hash_sum = legacy_cached_file_hash(path, temporary_path, hash_kind);
+    if (hash_sum.count() != 40)
+        hash_sum = compute_hash(path);
+    if (hash_sum.count() == 40)
+        cache->record(key, path, hash_sum);
+    return hash_sum;
 }
 
 QString sumit(const QString& path, int num_bytes, const QString& temporary_path)
@@ -87,47 +187,79 @@ QString sumit(const QString& path, int num_bytes, const QString& temporary_path)
     if (num_bytes != 0) {
         return compute_the_file_hash(path, num_bytes);
     }
-    //the file id is a hashed function of device,inode,size, and modification time (in seconds)
-    //note that it is not dependent on the file name
-    struct stat SS;
-    stat(path.toLatin1().data(), &SS);
-
-    //didn't compile on mac so using the following which only depends on size and modification date
+    return cached_file_hash(path, temporary_path, "sha1", compute_the_full_file_hash);
+}
 
-    QFileInfo info(path);
-    QString id_string = QString("%1:%2:%3:%4").arg(path).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size());
+QString sumit_tree(const QString& path, const QString& temporary_path)
+{
+    return cached_file_hash(path, temporary_path, "sha1tree", compute_the_file_tree_hash);
+}
 
-    //QString id_string = QString("%1:%2:%3:%4").arg(SS.st_dev).arg(SS.st_ino).arg(SS.st_size).arg(SS.st_mtim.tv_sec);
-    QString file_id = compute_the_string_hash(id_string);
+QStringList sumit_files(const QStringList& paths, const QString& temporary_path, bool tree)
+{
+    //each thread takes the next file; the results go to fixed positions, so the order does not depend on the scheduling
+    std::vector<QString> hashes(paths.count());
+    std::atomic<int> next_index(0);
+    auto hash_files = [&]() {
+        int i;
+        while ((i = next_index++) < paths.count()) {
+            if (tree)
+                hashes[i] = sumit_tree(paths[i], temporary_path);
+            else
+                hashes[i] = sumit(paths[i], 0, temporary_path);
+        }
+    };
+    int num_threads = qMax(1, qMin(qMin((int)std::thread::hardware_concurrency(), SUMIT_MAX_THREADS), paths.count()));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++)
+        threads.push_back(std::thread(hash_files));
+    hash_files();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
 
-    QString dirname = QString(temporary_path + "/sumit/sha1/%1").arg(file_id.mid(0, 4));
-    create_directory_if_doesnt_exist(dirname);
-    QString hash_path = QString("%1/%2").arg(dirname).arg(file_id);
+    QStringList ret;
+    for (size_t i = 0; i < hashes.size(); i++)
+        ret << hashes[i];
+    return ret;
+}
 
-    QString hash_sum = read_text_file(hash_path);
-    if (hash_sum.isEmpty()) {
-        create_hash_file(path, hash_path);
-        hash_sum = read_text_file(hash_path);
+void collect_dir_files(const QString& path, QStringList& file_paths)
+{
+    QStringList files = QDir(path).entryList(QStringList("*"), QDir::Files, QDir::Name);
+    QStringList dirs = QDir(path).entryList(QStringList("*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (int i = 0; i < dirs.count(); i++) {
+        collect_dir_files(path + "/" + dirs[i], file_paths);
     }
-    if (hash_sum.count() != 40) {
-        create_hash_file(path, hash_path);
-        hash_sum = read_text_file(hash_path);
+    for (int i = 0; i < files.count(); i++) {
+        file_paths << path + "/" + files[i];
     }
-    return hash_sum;
 }
 
-QString sumit_dir(const QString& path, const QString& temporary_path)
+QString combine_dir_hash(const QString& path, const QHash<QString, QString>& file_hashes)
 {
     QStringList files = QDir(path).entryList(QStringList("*"), QDir::Files, QDir::Name);
     QStringList dirs = QDir(path).entryList(QStringList("*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
 
     QString str = "";
     for (int i = 0; i < dirs.count(); i++) {
-        str += QString("%1 %2\n").arg(sumit_dir(path + "/" + dirs[i], temporary_path)).arg(dirs[i]);
+        str += QString("%1 %2\n").arg(combine_dir_hash(path + "/" + dirs[i], file_hashes)).arg(dirs[i]);
     }
     for (int i = 0; i < files.count(); i++) {
-        str += QString("%1 %2\n").arg(sumit(path + "/" + files[i], 0, temporary_path)).arg(files[i]);
+        str += QString("%1 %2\n").arg(file_hashes.value(path + "/" + files[i])).arg(files[i]);
     }
 
     return compute_the_string_hash(str);
 }
+
+QString sumit_dir(const QString& path, const QString& temporary_path)
+{
+    //hash every file in the tree concurrently, then combine in sorted-name order exactly as before
+    QStringList file_paths;
+    collect_dir_files(path, file_paths);
+    QStringList hashes = sumit_files(file_paths, temporary_path);
+    QHash<QString, QString> file_hashes;
+    for (int i = 0; i < file_paths.count(); i++) {
+        file_hashes[file_paths[i]] = hashes[i];
+    }
+    return combine_dir_hash(path, file_hashes);
+}
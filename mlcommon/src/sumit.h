@@ -8,16 +8,26 @@
 #define SUMIT_H
 
 #include <QString>
+#include <QStringList>
+
+#define SUMIT_TREE_BLOCK_SIZE (64 * 1024 * 1024) //changing this changes every tree checksum
+#define SUMIT_TREE_READ_SIZE (4 * 1024 * 1024)
+#define SUMIT_MAX_THREADS 8 //files hashed at once by sumit_files and sumit_dir
 
 /*
 Computation of hash checksums. Like sha1sum except applies to folders as well as files and automatically caches computations on the local disk: /tmp/sumit.
 
-In the case of files, outputs the sha1 checksum, equivalent to the output of sha1sum. Local caching is performed (in /tmp/sumit/sha1) so that checksums do not need to be recomputed on subsequent calls with large files. The cache indexing is by device/inode/size/modification_time so there is no problem if files are moved or renamed within the same file system.
+In the case of files, outputs the sha1 checksum, equivalent to the output of sha1sum. Local caching is performed (in /tmp/sumit/sha1.log, see sumitcache.h) so that checksums do not need to be recomputed on subsequent calls with large files. The cache indexing is by device/inode/size/modification_time so there is no problem if files are moved or renamed within the same file system.
+
+Optionally (sumit_tree), files are tree hashed: the file is split into blocks of SUMIT_TREE_BLOCK_SIZE bytes, the blocks are sha1 hashed in parallel, and the output is the sha1 checksum of the concatenated (binary) block digests. This is not equal to the sha1sum of the file, so it must be labeled as a distinct kind of checksum wherever it is stored. It is cached separately (in /tmp/sumit/sha1tree.log).
 
 In the case of directories, outputs a unique sha1 checksum that depends only on the contents of the directory (not the name or location of the directory). The computation depends on the checksum of each and every file within the directory tree, but again checksums do not need to be recomputed for the files in subsequent calls.
 */
 
 QString sumit(const QString& path, int num_bytes, const QString& temporary_path);
+QString sumit_tree(const QString& path, const QString& temporary_path);
 QString sumit_dir(const QString& path, const QString& temporary_path);
+///sumit (or sumit_tree) of each of the files, computed concurrently, in the same order as paths
+QStringList sumit_files(const QStringList& paths, const QString& temporary_path, bool tree = false);
 
 #endif // SUMIT_H
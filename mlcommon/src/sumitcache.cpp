@@ -0,0 +1,243 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#include "sumitcache.h"
+
+#include <QDebug>
+#include <QFile>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+QString SumitFileKey::toString() const
+{
+    return QString("%1:%2:%3:%4").arg(device).arg(inode).arg(size).arg(modified_nsec);
+}
+
+bool SumitFileKey::fromFile(const QString& path, SumitFileKey& key)
+{
+    struct stat SS;
+    if (stat(path.toUtf8().data(), &SS) != 0)
+        return false;
+    key.device = SS.st_dev;
+    key.inode = SS.st_ino;
+    key.size = SS.st_size;
+#ifdef __APPLE__
+    key.modified_nsec = SS.st_mtimespec.tv_sec * (qint64)1000000000 + SS.st_mtimespec.tv_nsec;
+#else
+    key.modified_nsec = SS.st_mtim.tv_sec * (qint64)1000000000 + SS.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+SumitCache::SumitCache(const QString& log_path)
+    : m_log_path(log_path)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!open_log())
+        return;
+    read_new_records();
+    bool needs_compaction = (m_num_records > 2 * m_num_compacted_records + SUMIT_CACHE_COMPACT_MIN_RECORDS);
+    locker.unlock();
+    if (needs_compaction)
+        compact();
+}
+
+SumitCache::~SumitCache()
+{
+    close_log();
+}
+
+QString SumitCache::lookup(const SumitFileKey& key)
+{
+    QString key_str = key.toString();
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.contains(key_str))
+        return m_entries.value(key_str).checksum;
+    //another process may have recorded it since we last looked
+    read_new_records();
+    return m_entries.value(key_str).checksum;
+}
+
+void SumitCache::record(const SumitFileKey& key, const QString& path, const QString& checksum)
+{
+    QString key_str = key.toString();
+    QByteArray line = QString("%1\t%2\t%3\n").arg(key_str).arg(checksum).arg(path).toUtf8();
+    QMutexLocker locker(&m_mutex);
+    Entry E;
+    E.checksum = checksum;
+    E.path = path;
+    m_entries[key_str] = E;
+    if (m_fd < 0)
+        return;
+    //lock the log we have open, making sure it was not compacted (replaced) in the meantime
+    bool locked = false;
+    for (int attempt = 0; (attempt < 3) && (!locked); attempt++) {
+        if (flock(m_fd, LOCK_EX) != 0)
+            return;
+        if (log_was_replaced()) {
+            flock(m_fd, LOCK_UN);
+            read_new_records();
+            if (m_fd < 0)
+                return;
+        }
+        else {
+            locked = true;
+        }
+    }
+    if (!locked)
+        return;
+    //start on a new line, in case a writer died halfway through a record
+    off_t end = lseek(m_fd, 0, SEEK_END);
+    char last = '\n';
+    if ((end > 0) && (pread(m_fd, &last, 1, end - 1) == 1) && (last != '\n'))
+        line = "\n" + line;
+    if (write(m_fd, line.constData(), line.count()) != line.count())
+        qWarning() << "Problem writing to sumit cache:" << m_log_path;
+    flock(m_fd, LOCK_UN);
+}
+
+bool SumitCache::compact()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_fd < 0)
+        return false;
+    if (flock(m_fd, LOCK_EX) != 0)
+        return false;
+    if (log_was_replaced()) {
+        //someone else compacted it
+        flock(m_fd, LOCK_UN);
+        read_new_records();
+        return true;
+    }
+
+    //read the whole log (we hold the lock, so nobody is appending) and keep the records whose files are unchanged
+    m_entries.clear();
+    m_read_offset = 0;
+    m_num_records = 0;
+    read_records();
+    QHash<QString, Entry> live;
+    QByteArray txt;
+    foreach (QString key_str, m_entries.keys()) {
+        Entry E = m_entries.value(key_str);
+        SumitFileKey key;
+        if ((!SumitFileKey::fromFile(E.path, key)) || (key.toString() != key_str))
+            continue;
+        live[key_str] = E;
+        txt += QString("%1\t%2\t%3\n").arg(key_str).arg(E.checksum).arg(E.path).toUtf8();
+    }
+    txt = QString("#compacted\t%1\n").arg(live.count()).toUtf8() + txt;
+
+    //the new log is locked before it replaces the old one, so that nobody appends to it before we have taken it over
+    QString tmp_fname = m_log_path + QString(".compact.%1").arg(getpid());
+    int new_fd = open(tmp_fname.toUtf8().data(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0664);
+    bool ok = ((new_fd >= 0) && (flock(new_fd, LOCK_EX) == 0) && (write(new_fd, txt.constData(), txt.count()) == txt.count()));
+    if ((ok) && (::rename(tmp_fname.toUtf8().data(), m_log_path.toUtf8().data()) != 0))
+        ok = false;
+    flock(m_fd, LOCK_UN);
+    if (!ok) {
+        if (new_fd >= 0)
+            ::close(new_fd);
+        QFile::remove(tmp_fname);
+        qWarning() << "Unable to compact sumit cache:" << m_log_path;
+        return false;
+    }
+    close_log();
+    m_fd = new_fd;
+    m_entries = live;
+    m_read_offset = txt.count();
+    m_num_records = m_num_compacted_records = live.count();
+    flock(m_fd, LOCK_UN);
+    return true;
+}
+
+SumitCache* SumitCache::instance(const QString& log_path)
+{
+    static QHash<QString, SumitCache*> instances;
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if (!instances.contains(log_path))
+        instances[log_path] = new SumitCache(log_path);
+    return instances.value(log_path);
+}
+
+bool SumitCache::open_log()
+{
+    m_fd = open(m_log_path.toUtf8().data(), O_RDWR | O_CREAT | O_APPEND, 0664);
+    if (m_fd < 0) {
+        qWarning() << "Unable to open sumit cache:" << m_log_path;
+        return false;
+    }
+    return true;
+}
+
+void SumitCache::close_log()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+}
+
+bool SumitCache::log_was_replaced()
+{
+    struct stat SS1, SS2;
+    if (fstat(m_fd, &SS1) != 0)
+        return true;
+    if (stat(m_log_path.toUtf8().data(), &SS2) != 0)
+        return true;
+    return ((SS1.st_dev != SS2.st_dev) || (SS1.st_ino != SS2.st_ino));
+}
+
+void SumitCache::read_new_records()
+{
+    if (m_fd < 0)
+        return;
+    if (log_was_replaced()) {
+        //compacted by another process: start over with the new log
+        close_log();
+        if (!open_log())
+            return;
+        m_entries.clear();
+        m_read_offset = 0;
+        m_num_records = 0;
+    }
+    if (flock(m_fd, LOCK_SH) != 0)
+        return;
+    read_records();
+    flock(m_fd, LOCK_UN);
+}
+
+void SumitCache::read_records()
+{
+    //the caller holds a lock on the log
+    QByteArray txt;
+    char buf[65536];
+    ssize_t num_read;
+    while ((num_read = pread(m_fd, buf, sizeof(buf), m_read_offset + txt.count())) > 0)
+        txt.append(buf, num_read);
+    int pos = 0;
+    int ind;
+    while ((ind = txt.indexOf('\n', pos)) >= 0) {
+        //only complete lines are consumed; a partial one is left for next time
+        QByteArray line = txt.mid(pos, ind - pos);
+        pos = ind + 1;
+        if (line.startsWith("#compacted\t")) {
+            m_num_compacted_records = line.mid(QByteArray("#compacted\t").count()).toLongLong();
+            continue;
+        }
+        int i1 = line.indexOf('\t');
+        int i2 = (i1 >= 0) ? line.indexOf('\t', i1 + 1) : -1;
+        if (i2 < 0)
+            continue;
+        Entry E;
+        E.checksum = QString::fromUtf8(line.mid(i1 + 1, i2 - i1 - 1));
+        E.path = QString::fromUtf8(line.mid(i2 + 1));
+        m_entries[QString::fromUtf8(line.mid(0, i1))] = E;
+        m_num_records++;
+    }
+    m_read_offset += pos;
+}
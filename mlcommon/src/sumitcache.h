@@ -0,0 +1,75 @@
+/******************************************************
+** See the accompanying README and LICENSE files
+** Author(s): Jeremy Magland
+*******************************************************/
+
+#ifndef SUMITCACHE_H
+#define SUMITCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#define SUMIT_CACHE_COMPACT_MIN_RECORDS 1000 //compact once the log holds this many more records than live entries
+
+/*
+The store behind sumit's cache of file checksums: a single append-only log per kind of checksum (sumit/sha1.log,
+sumit/sha1tree.log), rather than one small file per hashed file.
+
+Each record is one line: the key of the file (device, inode, size and modification time in nanoseconds), the
+checksum, and the path the checksum was computed for. The key is taken before hashing, so a file modified while it is
+hashed is never recorded under its new key. A record is appended with a single write under an exclusive lock, and is
+only read once its terminating newline is there, so readers never see a partial record and a crashed writer costs
+at most that record.
+
+Each process reads the log once into memory, so a lookup is a stat and a hash table lookup. On a miss the log is read
+from where we left off, to pick up what other processes have recorded. When the log has accumulated enough dead
+records (the same key recorded twice, or files that have since changed), it is compacted: the live records are written
+to a new file, which is renamed over the log. Writers check for this before appending.
+*/
+
+struct SumitFileKey {
+    qint64 device = 0;
+    qint64 inode = 0;
+    qint64 size = 0;
+    qint64 modified_nsec = 0;
+
+    QString toString() const;
+    static bool fromFile(const QString& path, SumitFileKey& key);
+};
+
+class SumitCache {
+public:
+    SumitCache(const QString& log_path);
+    virtual ~SumitCache();
+
+    ///The checksum recorded for the key, or an empty string
+    QString lookup(const SumitFileKey& key);
+    void record(const SumitFileKey& key, const QString& path, const QString& checksum);
+    ///Rewrite the log with only the records whose files are unchanged
+    bool compact();
+
+    ///One instance per log, kept for the life of the process
+    static SumitCache* instance(const QString& log_path);
+
+private:
+    struct Entry {
+        QString checksum;
+        QString path;
+    };
+    QString m_log_path;
+    int m_fd = -1;
+    qint64 m_read_offset = 0;
+    qint64 m_num_records = 0;
+    qint64 m_num_compacted_records = 0; //live records at the last compaction
+    QHash<QString, Entry> m_entries; //by key
+    QMutex m_mutex;
+
+    bool open_log();
+    void close_log();
+    bool log_was_replaced();
+    void read_new_records();
+    void read_records();
+};
+
+#endif // SUMITCACHE_H
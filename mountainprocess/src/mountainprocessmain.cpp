@@ -111,6 +111,7 @@ struct run_script_opts {
     bool force_run;
     QString working_path;
     bool preserve_tempdir = false;
+    bool io_profile = false;
 };
 
 QJsonArray monitor_stats_to_json_array(const QList<MonitorStats>& stats);
@@ -300,6 +301,7 @@ int main(int argc, char* argv[])
         int parent_pid = CLP.named_parameters.value("_parent_pid", 0).toLongLong();
 
         bool preserve_tempdir = CLP.named_parameters.contains("_preserve_tempdir");
+        bool io_profile = CLP.named_parameters.contains("_io_profile"); // record per-file I/O of the processor, see mdaioprofile.h
 
         bool force_run = CLP.named_parameters.contains("_force_run"); // do not check for already computed
         int request_num_threads = CLP.named_parameters.value("_request_num_threads", 0).toInt(); // the processor may or may not respect this request. But mountainsort/omp does.
@@ -319,7 +321,7 @@ int main(int argc, char* argv[])
             else {
                 RequestProcessResources RPR;
                 RPR.request_num_threads = request_num_threads;
-                id = PM->startProcess(processor_name, process_parameters, RPR, exec_mode, preserve_tempdir); //start the process and retrieve a unique id
+                id = PM->startProcess(processor_name, process_parameters, RPR, exec_mode, preserve_tempdir, io_profile); //start the process and retrieve a unique id
                 if (id.isEmpty()) {
                     error_message = "Problem starting process: " + processor_name;
                     ret = -1;
@@ -349,6 +351,9 @@ int main(int argc, char* argv[])
             double cpu_avg = compute_avg_cpu_pct(info.monitor_stats);
             double sec = info.start_time.msecsTo(info.finish_time) * 1.0 / 1000;
             printf("Peak RAM: %d MB. Peak CPU: %g%%. Avg CPU: %g%%. Elapsed time: %g seconds.\n", mb, cpu, cpu_avg, sec);
+            if (!info.io_profile.isEmpty()) {
+                printf("I/O: %g MB read, %g MB written in %d files. %g seconds in I/O, %g seconds outside.\n", info.io_profile["bytes_read"].toDouble() / 1e6, info.io_profile["bytes_written"].toDouble() / 1e6, info.io_profile["files"].toObject().count(), info.io_profile["io_sec"].toDouble(), info.io_profile["outside_io_sec"].toDouble());
+            }
             printf("---------------------------------------------------------------\n");
         }
         QJsonObject obj; //the output info to be saved
@@ -370,6 +375,8 @@ int main(int argc, char* argv[])
         obj["avg_cpu_pct"] = compute_avg_cpu_pct(info.monitor_stats);
         obj["start_time"] = info.start_time.toString("yyyy-MM-dd:hh-mm-ss.zzz");
         obj["finish_time"] = info.finish_time.toString("yyyy-MM-dd:hh-mm-ss.zzz");
+        if (!info.io_profile.isEmpty())
+            obj["io_profile"] = info.io_profile;
         //obj["monitor_stats"]=monitor_stats_to_json_array(info.monitor_stats); -- at some point we can include this in the file. For now we only worry about the computed peak values
         if (!output_fname.isEmpty()) { //The user wants the results to go in this file
             QFile::remove(output_fname); //important -- added 9/9/16
@@ -467,6 +474,7 @@ int main(int argc, char* argv[])
         opts.force_run = CLP.named_parameters.contains("_force_run");
         opts.working_path = QDir::currentPath(); // this should get passed through to the processors
         opts.preserve_tempdir = CLP.named_parameters.contains("_preserve_tempdir");
+        opts.io_profile = CLP.named_parameters.contains("_io_profile");
         QJsonObject results;
         // actually run the script
         if (!run_script(script_fnames, params, opts, error_message, results)) {
@@ -1030,6 +1038,7 @@ bool run_script(const QStringList& script_fnames, const QVariantMap& params, con
     Controller2.setForceRun(opts.force_run);
     Controller2.setWorkingPath(opts.working_path);
     Controller2.setPreserveTempdir(opts.preserve_tempdir);
+    Controller2.setIOProfile(opts.io_profile);
     QJSValue MP2 = engine.newQObject(&Controller2);
     engine.globalObject().setProperty("_MP2", MP2);
 
@@ -1063,8 +1072,8 @@ bool run_script(const QStringList& script_fnames, const QVariantMap& params, con
 void print_usage()
 {
     printf("Usage:\n");
-    printf("mp-run-process [processor_name] --[param1]=[val1] --[param2]=[val2] ... [--_force_run] [--_request_num_threads=4]\n");
-    printf("mp-run-script [script1].js [script2.js] ... [file1].par [file2].par ... [--_force_run] [--_request_num_threads=4]\n");
+    printf("mp-run-process [processor_name] --[param1]=[val1] --[param2]=[val2] ... [--_force_run] [--_request_num_threads=4] [--_io_profile]\n");
+    printf("mp-run-script [script1].js [script2.js] ... [file1].par [file2].par ... [--_force_run] [--_request_num_threads=4] [--_io_profile]\n");
     printf("mp-list-daemons\n");
     printf("mp-daemon-start [some daemon id]\n");
     printf("mp-daemon-stop [some daemon id]\n");
@@ -1170,6 +1179,7 @@ bool queue_pript(PriptType prtype, const CLParams& CLP, QString working_path)
         // It is a process
         PP.output_fname = CLP.named_parameters["_process_output"].toString();
         PP.preserve_tempdir = CLP.named_parameters.contains("_preserve_tempdir");
+        PP.io_profile = CLP.named_parameters.contains("_io_profile");
         if (!PP.output_fname.isEmpty()) {
             PP.output_fname = QDir::current().absoluteFilePath(PP.output_fname); //make it absolute
             QFile::remove(PP.output_fname); //important, added 9/9/16
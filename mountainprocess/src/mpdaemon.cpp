@@ -151,6 +151,7 @@ QJsonObject pript_struct_to_obj(MPDaemonPript S, RecordType rt)
         ret["parameters"] = variantmap_to_json_obj(S.parameters);
         ret["output_fname"] = S.output_fname;
         ret["preserve_tempdir"] = S.preserve_tempdir;
+        ret["io_profile"] = S.io_profile;
         ret["stdout_fname"] = S.stdout_fname;
         ret["parent_pid"] = QString("%1").arg(S.parent_pid);
     }
@@ -194,6 +195,7 @@ MPDaemonPript pript_obj_to_struct(QJsonObject obj)
     ret.id = obj.value("id").toString();
     ret.output_fname = obj.value("output_fname").toString();
     ret.preserve_tempdir = obj.value("preserve_tempdir").toBool();
+    ret.io_profile = obj.value("io_profile").toBool();
     ret.stdout_fname = obj.value("stdout_fname").toString();
     ret.success = obj.value("success").toBool();
     ret.error = obj.value("error").toString();
@@ -878,6 +880,8 @@ bool MountainProcessServer::launch_pript(QString pript_id)
             args << "--_process_output=" + S->output_fname;
         if (S->preserve_tempdir)
             args << "--_preserve_tempdir";
+        if (S->io_profile)
+            args << "--_io_profile";
         args << QString("--_parent_pid=%1").arg(S->parent_pid);
         QStringList pkeys = S->parameters.keys();
         foreach (QString pkey, pkeys) {
@@ -182,6 +182,7 @@ struct MPDaemonPript {
     QString id;
     QString output_fname;
     bool preserve_tempdir = false;
+    bool io_profile = false;
     QString stdout_fname;
     QVariantMap parameters;
     bool is_running = false;
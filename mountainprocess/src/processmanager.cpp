@@ -16,6 +16,7 @@
 #include <QCryptographicHash>
 #include "mpdaemon.h"
 #include "mlcommon.h"
+#include "mdaioprofile.h"
 
 #include <QCoreApplication>
 #include <QThread>
@@ -28,6 +29,7 @@ struct PMProcess {
     QString tempdir = "";
     bool preserve_tempdir = true; // for debugging set to true, otherwise will clean up the tempdir when process has finished
     bool exec_mode = false;
+    QString io_profile_fname; //where the process writes its MdaIOProfile summary, empty if not profiled
     QProcess* qprocess;
 };
 
@@ -230,7 +232,7 @@ bool do_mkdir(QString path, int num_tries = 1)
     return true;
 }
 
-QString ProcessManager::startProcess(const QString& processor_name, const QVariantMap& parameters_in, const RequestProcessResources& RPR, bool exec_mode, bool preserve_tempdir)
+QString ProcessManager::startProcess(const QString& processor_name, const QVariantMap& parameters_in, const RequestProcessResources& RPR, bool exec_mode, bool preserve_tempdir, bool io_profile)
 {
     QVariantMap parameters = d->resolve_file_names_in_parameters(processor_name, parameters_in);
 
@@ -320,6 +322,12 @@ QString ProcessManager::startProcess(const QString& processor_name, const QVaria
     PP.exec_mode = exec_mode;
     PP.qprocess = new QProcess;
     PP.qprocess->setProcessChannelMode(QProcess::MergedChannels);
+    if (io_profile) {
+        PP.io_profile_fname = tempdir + "/io_profile.json";
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert(MDA_IO_PROFILE_ENV, PP.io_profile_fname);
+        PP.qprocess->setProcessEnvironment(env);
+    }
     //connect(PP.qprocess,SIGNAL(readyRead()),this,SLOT(slot_qprocess_output()));
     QObject::connect(PP.qprocess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(slot_process_finished()));
     printf("STARTING: %s.\n", PP.info.exe_command.toLatin1().data());
@@ -636,6 +644,12 @@ void ProcessManagerPrivate::update_process_info(QString id)
         PP->info.finished = true;
         PP->info.exit_code = qprocess->exitCode();
         PP->info.exit_status = qprocess->exitStatus();
+        if (!PP->io_profile_fname.isEmpty()) {
+            //written by the processor as it exits, and read before the tempdir is removed
+            PP->info.io_profile = QJsonDocument::fromJson(TextFile::read(PP->io_profile_fname).toUtf8()).object();
+            if (PP->info.io_profile.isEmpty())
+                qWarning() << "No I/O profile was written by the process (it may not use DiskReadMda/DiskWriteMda):" << PP->info.processor_name;
+        }
     }
     PP->info.standard_output += qprocess->readAll();
 }
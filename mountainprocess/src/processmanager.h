@@ -56,6 +56,7 @@ struct MLProcessInfo {
     QProcess::ExitStatus exit_status;
     QByteArray standard_output;
     QByteArray standard_error;
+    QJsonObject io_profile; //the summary of MdaIOProfile (see mdaioprofile.h), when the process was started with io_profile
 };
 
 class ProcessManagerPrivate;
@@ -78,7 +79,7 @@ public:
     bool checkParameters(const QString& processor_name, const QVariantMap& parameters);
     void setDefaultParameters(const QString& processor_name, QVariantMap& parameters);
     bool processAlreadyCompleted(const QString& processor_name, const QVariantMap& parameters, bool allow_rprv_inputs = true, bool allow_rprv_outputs = false);
-    QString startProcess(const QString& processor_name, const QVariantMap& parameters, const RequestProcessResources& RPR, bool exec_mode, bool preserve_tempdir); //returns the process id/handle (a random string)
+    QString startProcess(const QString& processor_name, const QVariantMap& parameters, const RequestProcessResources& RPR, bool exec_mode, bool preserve_tempdir, bool io_profile = false); //returns the process id/handle (a random string)
     bool waitForFinished(const QString& process_id, int parent_pid);
     MLProcessInfo processInfo(const QString& id);
     void clearProcess(const QString& id);
@@ -18,7 +18,9 @@
 #include <QTime>
 #include <QCoreApplication>
 #include <QDebug>
-#include <unistd.h> //for usleep
+#include <QEventLoop>
+#include <QQueue>
+#include <QVector>
 #include "mpdaemon.h"
 #include "mlcommon.h"
 
@@ -88,11 +90,18 @@ public:
     bool m_force_run = false;
     QString m_working_path;
     bool m_preserve_tempdir = false;
+    bool m_io_profile = false;
     QJsonObject m_results;
     int m_num_threads = 0;
 
     QList<PipelineNode2> m_pipeline_nodes;
 
+    //the dependency graph, by node index, set up by build_dependency_graph
+    QVector<QList<int>> m_dependents; //the nodes waiting on each node
+    QVector<int> m_num_unfinished_inputs; //the number of nodes each node is waiting on
+    QQueue<int> m_ready_queue; //nodes with nothing left to wait on
+    QList<int> m_running_nodes;
+
     QProcess* queue_process(QString processor_name, const QVariantMap& parameters, bool use_run, bool force_run, bool preserve_tempdir, QString process_output_fname, int request_num_threads);
     QProcess* run_process(QString processor_name, const QVariantMap& parameters, bool force_run, bool preserve_tempdir, QString process_output_fname, int request_num_threads);
 
@@ -101,10 +110,11 @@ public:
     QVariant make_absolute_path_variant(QVariant val);
 
     bool run_or_queue_node(PipelineNode2* node, const QMap<QString, int>& node_indices_for_outputs);
-    PipelineNode2* find_node_ready_to_run();
+    void build_dependency_graph(const QMap<QString, int>& node_indices_for_outputs);
+    void node_completed(int i);
     bool handle_running_processes();
+    void wait_for_running_processes();
     bool get_node_indices_for_outputs(QMap<QString, int>& node_indices_for_outputs);
-    bool okay_to_remove_intermediate_file(const QString& path);
     bool create_rprv(const QString& path);
 };
 
@@ -151,6 +161,11 @@ void ScriptController2::setPreserveTempdir(bool tempdir)
     d->m_preserve_tempdir = tempdir;
 }
 
+void ScriptController2::setIOProfile(bool val)
+{
+    d->m_io_profile = val;
+}
+
 QJsonObject ScriptController2::getResults()
 {
     return d->m_results;
@@ -296,41 +311,32 @@ bool ScriptController2::runPipeline()
         return false;
     }
 
-    bool done = false;
-    while (!done) {
-        bool found = true;
-        while (found) {
-            found = false;
-            PipelineNode2* node = d->find_node_ready_to_run();
-            if (node) {
-                if (!d->run_or_queue_node(node, node_indices_for_outputs)) {
-                    return false;
-                }
-                found = true;
+    //each node waits for a count of unfinished nodes; completing a node pushes those it unblocks onto the ready queue
+    d->build_dependency_graph(node_indices_for_outputs);
+    while (true) {
+        while (!d->m_ready_queue.isEmpty()) {
+            int i = d->m_ready_queue.dequeue();
+            PipelineNode2* node = &d->m_pipeline_nodes[i];
+            if (!d->run_or_queue_node(node, node_indices_for_outputs)) {
+                return false;
             }
+            if (node->completed)
+                d->node_completed(i);
+            else if (node->running)
+                d->m_running_nodes << i;
         }
 
         if (!d->handle_running_processes()) {
             return false;
         }
 
-        //check to see if we are done
-        if (!d->find_node_ready_to_run()) {
-            int num_running = 0;
-            for (int i = 0; i < d->m_pipeline_nodes.count(); i++) {
-                PipelineNode2* node = &d->m_pipeline_nodes[i];
-                if (node->running)
-                    num_running++;
-            }
-            if (num_running == 0)
-                done = true; //if nothing is ready to run, and nothing is running, then we are done
-        }
+        //if nothing is ready to run, and nothing is running, then we are done
+        if (!d->m_ready_queue.isEmpty())
+            continue;
+        if (d->m_running_nodes.isEmpty())
+            break;
 
-        if (!done) {
-            //            MPDaemon::wait(100);
-            usleep(100 * 1000);
-            qApp->processEvents(); //important I think for detecting when processes end.
-        }
+        d->wait_for_running_processes();
     }
 
     //check whether everything got run
@@ -469,6 +475,9 @@ QProcess* ScriptController2Private::queue_process(QString processor_name, const
     if (preserve_tempdir) {
         args << "--_preserve_tempdir";
     }
+    if (m_io_profile) {
+        args << "--_io_profile";
+    }
     if (!m_working_path.isEmpty()) {
         args << "--_working_path=" + m_working_path;
     }
@@ -701,47 +710,58 @@ bool ScriptController2Private::run_or_queue_node(PipelineNode2* node, const QMap
     }
 }
 
-PipelineNode2* ScriptController2Private::find_node_ready_to_run()
+void ScriptController2Private::build_dependency_graph(const QMap<QString, int>& node_indices_for_outputs)
 {
-    QSet<QString> file_paths_waiting_to_be_created;
-    for (int i = 0; i < m_pipeline_nodes.count(); i++) {
+    int N = m_pipeline_nodes.count();
+    m_dependents = QVector<QList<int>>(N);
+    m_num_unfinished_inputs = QVector<int>(N, 0);
+    m_ready_queue.clear();
+    m_running_nodes.clear();
+
+    //the nodes reading each path, which must finish before the path can be removed as an intermediate file
+    QMap<QString, QList<int>> node_indices_for_inputs;
+    for (int i = 0; i < N; i++) {
         PipelineNode2* node = &m_pipeline_nodes[i];
-        if (!node->completed) {
-            QStringList pnames = node->outputs.keys();
-            foreach (QString pname, pnames) {
-                QStringList paths0 = MLUtil::toStringList(node->outputs[pname]);
-                foreach (QString path0, paths0) {
-                    file_paths_waiting_to_be_created.insert(path0);
-                }
+        if (!node->remove_intermediate) {
+            foreach (QString path, node->input_paths()) {
+                node_indices_for_inputs[path] << i;
             }
         }
     }
-    for (int i = 0; i < m_pipeline_nodes.count(); i++) {
+
+    for (int i = 0; i < N; i++) {
         PipelineNode2* node = &m_pipeline_nodes[i];
-        if ((!node->completed) && (!node->running)) {
-            bool ready_to_run = true;
-            QStringList pnames = node->inputs.keys();
-            foreach (QString pname, pnames) {
-                QStringList input_paths = MLUtil::toStringList(node->inputs[pname]);
-                foreach (QString input_path, input_paths) {
-                    if (file_paths_waiting_to_be_created.contains(input_path)) {
-                        ready_to_run = false;
-                    }
-                }
+        if (node->completed)
+            continue;
+        QSet<int> inputs_from_nodes;
+        foreach (QString path, node->input_paths()) {
+            if (node_indices_for_outputs.contains(path))
+                inputs_from_nodes.insert(node_indices_for_outputs.value(path));
+        }
+        if (node->remove_intermediate) {
+            foreach (int j, node_indices_for_inputs.value(node->inputs["input"].toString())) {
+                inputs_from_nodes.insert(j);
             }
-            if (ready_to_run) {
-                if (node->remove_intermediate) {
-                    if (okay_to_remove_intermediate_file(node->inputs["input"].toString())) {
-                        return node;
-                    }
-                }
-                else {
-                    return node;
-                }
+        }
+        inputs_from_nodes.remove(i);
+        foreach (int j, inputs_from_nodes) {
+            if (!m_pipeline_nodes[j].completed) {
+                m_dependents[j] << i;
+                m_num_unfinished_inputs[i]++;
             }
         }
+        if (m_num_unfinished_inputs[i] == 0)
+            m_ready_queue.enqueue(i);
+    }
+}
+
+void ScriptController2Private::node_completed(int i)
+{
+    foreach (int j, m_dependents[i]) {
+        m_num_unfinished_inputs[j]--;
+        if (m_num_unfinished_inputs[j] == 0)
+            m_ready_queue.enqueue(j);
     }
-    return 0;
 }
 
 QString create_temporary_path_for_output(QString processor_name, QVariantMap inputs, QVariantMap parameters, QString output_pname, int output_index)
@@ -763,7 +783,7 @@ QString create_temporary_path_for_output(QString processor_name, QVariantMap inp
 
 bool ScriptController2Private::handle_running_processes()
 {
-    for (int i = 0; i < m_pipeline_nodes.count(); i++) {
+    foreach (int i, m_running_nodes) {
         PipelineNode2* node = &m_pipeline_nodes[i];
         if (node->running) {
             if (!node->qprocess) {
@@ -818,12 +838,28 @@ bool ScriptController2Private::handle_running_processes()
 
                 delete node->qprocess;
                 node->qprocess = 0;
+                m_running_nodes.removeAll(i);
+                node_completed(i);
             }
         }
     }
     return true;
 }
 
+void ScriptController2Private::wait_for_running_processes()
+{
+    //block until one of the running processes has output or finishes
+    QEventLoop loop;
+    foreach (int i, m_running_nodes) {
+        QProcess* P = m_pipeline_nodes[i].qprocess;
+        if ((P->state() == QProcess::NotRunning) || (P->bytesAvailable()))
+            return; //already something to handle
+        QObject::connect(P, SIGNAL(readyRead()), &loop, SLOT(quit()));
+        QObject::connect(P, SIGNAL(finished(int, QProcess::ExitStatus)), &loop, SLOT(quit()));
+    }
+    loop.exec();
+}
+
 bool ScriptController2Private::get_node_indices_for_outputs(QMap<QString, int>& node_indices_for_outputs)
 {
     for (int i = 0; i < m_pipeline_nodes.count(); i++) {
@@ -841,22 +877,6 @@ bool ScriptController2Private::get_node_indices_for_outputs(QMap<QString, int>&
     return true;
 }
 
-bool ScriptController2Private::okay_to_remove_intermediate_file(const QString& path)
-{
-    for (int i = 0; i < m_pipeline_nodes.count(); i++) {
-        PipelineNode2* node = &m_pipeline_nodes[i];
-        if (!node->completed) {
-            if ((!node->remove_intermediate) && (node->input_paths().contains(path))) {
-                return false;
-            }
-            if (node->output_paths().contains(path)) {
-                return false;
-            }
-        }
-    }
-    return true;
-}
-
 bool ScriptController2Private::create_rprv(const QString& path)
 {
     if (!QFile::exists(path)) {
@@ -22,6 +22,7 @@ public:
     void setForceRun(bool force_run);
     void setWorkingPath(QString working_path);
     void setPreserveTempdir(bool tempdir);
+    void setIOProfile(bool val);
     QJsonObject getResults();
 
     Q_INVOKABLE QString addProcess(QString processor_name, QString inputs_json, QString parameters_json, QString outputs_json); //returns json
@@ -18,6 +18,7 @@ bool mask_out_artifacts(const QString& timeseries_path, const QString& timeserie
     status_timer.start();
 
     DiskReadMda X(timeseries_path);
+    X.setDirectIO(true); //streaming passes over the whole file, so keep it out of the page cache
     int M = X.N1();
     int N = X.N2();
 
@@ -65,6 +66,7 @@ bool mask_out_artifacts(const QString& timeseries_path, const QString& timeserie
     int num_timepoints_used = 0;
     int num_timepoints_not_used = 0;
     DiskWriteMda Y;
+    Y.setDirectIO(true);
     Y.open(MDAIO_TYPE_FLOAT32, timeseries_out_path, M, N);
     for (int i = 0; i < N / interval_size; i++) {
         int timepoint = i * interval_size;
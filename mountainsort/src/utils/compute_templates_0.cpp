@@ -10,6 +10,7 @@
 #include <math.h>
 #include "get_sort_indices.h"
 #include "omp.h"
+#include "mdapool.h"
 
 Mda compute_templates_0(const DiskReadMda& X, Mda& firings, int clip_size)
 {
@@ -49,6 +50,7 @@ Mda compute_templates_0(const DiskReadMda& X, const QVector<double>& times, cons
     QList<int> counts;
     for (int k = 0; k < K; k++)
         counts << 0;
+    MdaPoolScope pool_scope; //one clip per event, all the same size
     for (int i = 0; i < L; i++) {
         int k = labels[i];
         int t0 = (int)(times[i] + 0.5);
@@ -84,6 +86,7 @@ void get_sums_and_counts_for_templates(Mda& sums, Mda& counts, const Mda32& X, b
     int Tmid = (int)((T + 1) / 2) - 1;
     sums.allocate(M, T, K);
     counts.allocate(1, K);
+    MdaPoolScope pool_scope;
     for (bigint i = 0; i < times.count(); i++) {
         bigint t = times[i] - t_offset;
         if ((t >= clip_size) && (t < N - clip_size)) {
@@ -160,6 +163,7 @@ Mda32 compute_templates_0(const DiskReadMda32& X, const QVector<double>& times,
     QList<int> counts;
     for (int k = 0; k < K; k++)
         counts << 0;
+    MdaPoolScope pool_scope;
     for (int i = 0; i < L; i++) {
         int k = labels[i];
         int t0 = (int)(times[i] + 0.5);
@@ -202,6 +206,7 @@ void compute_templates_stdevs(Mda& templates, Mda& stdevs, DiskReadMda& X, const
     QList<int> counts;
     for (int k = 0; k < K; k++)
         counts << 0;
+    MdaPoolScope pool_scope;
     for (int i = 0; i < L; i++) {
         int k = labels[i];
         int t0 = (int)(times[i] + 0.5);
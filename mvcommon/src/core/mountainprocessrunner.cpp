@@ -142,7 +142,7 @@ QJsonObject http_post(QString url, QJsonObject req)
         QJsonObject obj = QJsonDocument::fromJson(ret.toLatin1()).object();
         ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
         if (manager) {
-            IIntCounter* bytesDownloadedCounter = static_cast<IIntCounter*>(manager->counter("bytes_downloaded"));
+            IInt64Counter* bytesDownloadedCounter = static_cast<IInt64Counter*>(manager->counter("bytes_downloaded"));
             bytesDownloadedCounter->add(ret.count());
         }
         //        TaskManager::TaskProgressMonitor::globalInstance()->incrementQuantity("bytes_downloaded", ret.count());
@@ -280,7 +280,7 @@ void MountainProcessRunner::runProcess()
         QJsonObject resp = http_post(url, req);
         ICounterManager* manager = ObjectRegistry::getObject<ICounterManager>();
         if (manager) {
-            IIntCounter* remote_processing_time_counter = static_cast<IIntCounter*>(manager->counter("remote_processing_time"));
+            IInt64Counter* remote_processing_time_counter = static_cast<IInt64Counter*>(manager->counter("remote_processing_time"));
             remote_processing_time_counter->add(post_timer.elapsed());
         }
         if (MLUtil::threadInterruptRequested()) {
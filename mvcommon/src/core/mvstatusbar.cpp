@@ -107,17 +107,23 @@ void MVStatusBar::slot_update_quantities()
     {
         if (manager) {
             // TODO: Make the counters intelligent by using aggregate counters and labels for them.
-            IIntCounter* bytesReadCounter = static_cast<IIntCounter*>(manager->counter("bytes_read"));
+            IThreadCounter* bytesReadCounter = qobject_cast<IThreadCounter*>(manager->counter("bytes_read"));
             ICounterBase* bytesInUseCounter = manager->counter("bytes_in_use");
 
             double using_bytes = bytesInUseCounter ? bytesInUseCounter->value<int64_t>() : 0;
             double bytes_read = bytesReadCounter ? bytesReadCounter->value() : 0;
             QString txt = QString("%1 RAM | %2 Read").arg(format_num_bytes(using_bytes)).arg(format_num_bytes(bytes_read));
             d->m_bytes_allocated_label.setText(txt);
-            IIntCounter* allocatedCounter = static_cast<IIntCounter*>(manager->counter("allocated_bytes"));
-            IIntCounter* freedCounter = static_cast<IIntCounter*>(manager->counter("freed_bytes"));
+            IThreadCounter* allocatedCounter = qobject_cast<IThreadCounter*>(manager->counter("allocated_bytes"));
+            IThreadCounter* freedCounter = qobject_cast<IThreadCounter*>(manager->counter("freed_bytes"));
+            QString tooltip;
             if (allocatedCounter && freedCounter)
-                d->m_bytes_allocated_label.setToolTip(QString("Allocated: <b>%1</b><br>Freed: <b>%2</b>").arg(format_num_bytes(allocatedCounter->value())).arg(format_num_bytes(freedCounter->value())));
+                tooltip = QString("Allocated: <b>%1</b><br>Freed: <b>%2</b>").arg(format_num_bytes(allocatedCounter->value())).arg(format_num_bytes(freedCounter->value()));
+            if (ICounterBase* counter = manager->counter("read_latency"))
+                tooltip += QString("<br>Reads: <b>%1</b>").arg(counter->label());
+            if (ICounterBase* counter = manager->counter("write_latency"))
+                tooltip += QString("<br>Writes: <b>%1</b>").arg(counter->label());
+            d->m_bytes_allocated_label.setToolTip(tooltip);
         }
     }
 }
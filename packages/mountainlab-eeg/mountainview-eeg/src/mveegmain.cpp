@@ -133,15 +133,18 @@ int main(int argc, char* argv[])
     signal(SIGTERM, sig_handler);
 
     printf("Setting up object registry...\n");
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("allocated_bytes"));
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("freed_bytes"));
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("remote_processing_time"));
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("bytes_downloaded"));
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("bytes_read"));
-    ObjectRegistry::addAutoReleasedObject(new IIntCounter("bytes_written"));
+    ObjectRegistry::addAutoReleasedObject(new IThreadCounter("allocated_bytes"));
+    ObjectRegistry::addAutoReleasedObject(new IThreadCounter("freed_bytes"));
+    ObjectRegistry::addAutoReleasedObject(new IInt64Counter("remote_processing_time"));
+    ObjectRegistry::addAutoReleasedObject(new IInt64Counter("bytes_downloaded"));
+    ObjectRegistry::addAutoReleasedObject(new IThreadCounter("bytes_read"));
+    ObjectRegistry::addAutoReleasedObject(new IThreadCounter("bytes_written"));
+    ObjectRegistry::addAutoReleasedObject(new ILatencyCounter("read_latency"));
+    ObjectRegistry::addAutoReleasedObject(new ILatencyCounter("write_latency"));
 
     QList<ICounterBase*> counters = ObjectRegistry::getObjects<ICounterBase>();
     counterManager->setCounters(counters);
+    counterManager->setPublishInterval(COUNTER_PUBLISH_INTERVAL_MSEC);
     counterManager->connect(ObjectRegistry::instance(), &ObjectRegistry::objectAdded, [counterManager](QObject* o) {
       if (ICounterBase *cntr = qobject_cast<ICounterBase*>(o)) {
           counterManager->addCounter(cntr);
@@ -119,6 +119,7 @@ QJsonObject get_spec()
         X.addRequiredParameters("central_channel", "detect_threshold", "detect_interval", "sign");
         X.addOptionalParameter("subsample_factor", "", 1);
         X.addOptionalParameter("detect_rms_window", "", 0);
+        X.addOptionalParameter("use_channel_major_cache", "", 0);
         processors.push_back(X.get_spec());
     }
     {
@@ -412,6 +413,7 @@ int main(int argc, char* argv[])
         opts.detect_rms_window = CLP.named_parameters["detect_rms_window"].toDouble();
         opts.sign = CLP.named_parameters["sign"].toInt();
         opts.subsample_factor = CLP.named_parameters["subsample_factor"].toDouble();
+        opts.use_channel_major_cache = (CLP.named_parameters.value("use_channel_major_cache", 0).toInt() != 0);
         ret = p_detect_events(timeseries, event_times_out, opts);
     }
     else if (arg1 == "mountainsort.extract_clips") {
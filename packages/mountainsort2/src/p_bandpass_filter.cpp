@@ -3,6 +3,9 @@
 #include <QTime>
 #include <diskreadmda32.h>
 #include <diskwritemda.h>
+#include <mdaprefetcher.h>
+#include <mdapool.h>
+#include <QSharedPointer>
 #include "omp.h"
 #include "fftw3.h"
 #include <QFile>
@@ -106,6 +109,8 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
         X.setConcatDirectory(2, timeseries);
     else
         X.setPath(timeseries);
+    //a single pass over the whole file, so keep it out of the page cache
+    X.setDirectIO(true);
 
     const bigint M = X.N1();
     const bigint N = X.N2();
@@ -114,7 +119,9 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
     if (opts.quantization_unit) {
         dtype = MDAIO_TYPE_INT16;
     }
-    DiskWriteMda Y(dtype, timeseries_out, M, N);
+    DiskWriteMda Y;
+    Y.setDirectIO(true);
+    Y.open(dtype, timeseries_out, M, N);
 
     QTime timer_status;
     timer_status.start();
@@ -131,9 +138,18 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
     printf("************+++ Using chunk size / overlap size: %ld / %ld (num threads=%ld)\n", chunk_size, overlap_size, num_threads);
     qDebug().noquote() << "samplerate/freq_min/freq_max/freq_wid:" << opts.samplerate << opts.freq_min << opts.freq_max << opts.freq_wid;
 
-    bool ret = true;
+    //a stream (pipe or FIFO) has to be read in order, so its chunks are handed out by a prefetcher instead of the parallel for
+    QSharedPointer<MdaPrefetcher> prefetcher;
+    if (X.isStream()) {
+        prefetcher.reset(new MdaPrefetcher(X, chunk_size, overlap_size));
+        prefetcher->setNumBuffers(num_threads);
+    }
+
+    bool ret = true; //only set to false, in critical(lock_ret) within the parallel region
 #pragma omp parallel
     {
+        // chunks of the same size are created and dropped over and over, so recycle their memory within the thread
+        MdaPoolScope pool_scope;
         // one kernel runner for each parallel thread so they don't intersect
         P_bandpass_filter::Kernel_runner KR;
 #pragma omp critical(lock1)
@@ -141,16 +157,7 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
             KR.init(M, chunk_size + 2 * overlap_size, opts.samplerate, opts.freq_min, opts.freq_max, opts.freq_wid);
         }
         bigint num_timepoints_handled = 0;
-#pragma omp for
-        for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
-            Mda32 chunk;
-#pragma omp critical(lock1)
-            {
-                if (!X.readChunk(chunk, 0, timepoint - overlap_size, M, chunk_size + 2 * overlap_size)) {
-                    qWarning() << "Error reading chunk";
-                    ret = false;
-                }
-            }
+        auto process_chunk = [&](Mda32& chunk, bigint timepoint) {
             if (!opts.testcode.split(",").contains("nokernel")) {
                 QTime kernel_timer;
                 kernel_timer.start();
@@ -158,23 +165,30 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
                 //chunk = P_bandpass_filter::bandpass_filter_kernel(chunk, opts.samplerate, opts.freq_min, opts.freq_max, opts.freq_wid);
                 //qDebug().noquote() << "Kernel timer elapsed: " << kernel_timer.elapsed() << " for chunk at " << timepoint << " of " << N;
             }
-            Mda32 chunk2;
-            {
-                chunk.getChunk(chunk2, 0, overlap_size, M, chunk_size);
-            }
-#pragma omp critical(lock1)
-            {
+            //the part without the overlaps, in place
+            Mda32View chunk2;
+            if (!chunk.getChunk(chunk2, 0, overlap_size, M, chunk_size)) {
+                qWarning() << "Unexpected size of chunk" << chunk.N1() << chunk.N2();
+#pragma omp critical(lock_ret)
                 {
-                    if (do_write) {
-                        if (opts.quantization_unit) {
-                            P_bandpass_filter::multiply_by_factor(chunk2.totalSize(), chunk2.dataPtr(), 1.0 / opts.quantization_unit);
-                        }
-                        if (!Y.writeChunk(chunk2, 0, timepoint)) {
-                            qWarning() << "Error writing chunk";
-                            ret = false;
-                        }
+                    ret = false;
+                }
+                return;
+            }
+            if (do_write) {
+                if (opts.quantization_unit) {
+                    P_bandpass_filter::multiply_by_factor(chunk2.totalSize(), chunk2.dataPtr(), 1.0 / opts.quantization_unit);
+                }
+                if (!Y.writeChunk(chunk2, 0, timepoint)) {
+                    qWarning() << "Error writing chunk";
+#pragma omp critical(lock_ret)
+                    {
+                        ret = false;
                     }
                 }
+            }
+#pragma omp critical(lock1)
+            {
                 num_timepoints_handled += qMin((bigint)chunk_size, N - timepoint);
                 if ((timer_status.elapsed() > 5000) || (num_timepoints_handled == N) || (timepoint == 0)) {
                     printf("%ld/%ld (%d%%) -- using %d threads.\n",
@@ -184,7 +198,40 @@ bool p_bandpass_filter(QString timeseries, QString timeseries_out, Bandpass_filt
                     timer_status.restart();
                 }
             }
+        };
+        if (prefetcher) {
+            while (true) {
+                Mda32 chunk;
+                bigint timepoint;
+                bool got_chunk;
+#pragma omp critical(lock_next)
+                {
+                    got_chunk = prefetcher->next(chunk, timepoint);
+                }
+                if (!got_chunk)
+                    break;
+                process_chunk(chunk, timepoint);
+            }
         }
+        else {
+#pragma omp for
+            for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
+                Mda32 chunk;
+                //readChunk and writeChunk use positional I/O, so they do not need to be serialized
+                if (!X.readChunk(chunk, 0, timepoint - overlap_size, M, chunk_size + 2 * overlap_size)) {
+                    qWarning() << "Error reading chunk";
+#pragma omp critical(lock_ret)
+                    {
+                        ret = false;
+                    }
+                }
+                process_chunk(chunk, timepoint);
+            }
+        }
+    }
+    if ((prefetcher) && (prefetcher->hadError())) {
+        qWarning() << "Error reading chunk from stream";
+        ret = false;
     }
 
     return ret;
@@ -3,8 +3,47 @@
 #include <QTime>
 #include <diskreadmda.h>
 #include <diskreadmda32.h>
+#include <diskreadmda16.h>
+#include <mdapool.h>
 #include "mlcommon.h"
 
+namespace P_compute_templates {
+//Reader/ArrayType is DiskReadMda32/Mda32 or DiskReadMda16/Mda16. The sums are accumulated in double either way
+template <typename ArrayType, typename Reader>
+bool accumulate_templates(double* templates_ptr, QVector<double>& counts, const Reader& X, const QVector<double>& times, const QVector<bigint>& labels, const QVector<int>& label_map, bigint T)
+{
+    bigint M = X.N1();
+    bigint Tmid = (bigint)((T + 1) / 2) - 1;
+    QTime timer;
+    timer.start();
+    MdaPoolScope pool_scope;
+    for (bigint i = 0; i < times.count(); i++) {
+        bigint t1 = times[i] - Tmid;
+        //bigint t2 = t1 + T - 1;
+        int k = label_map[labels[i]];
+        if (timer.elapsed() > 3000) {
+            qDebug().noquote() << QString("Compute templates: processing event %1 of %2").arg(i).arg(times.count());
+            timer.restart();
+        }
+        {
+            ArrayType tmp;
+            tmp.allocate(M, T);
+            if (!X.readChunk(tmp, 0, t1, M, T)) {
+                qWarning() << "Problem reading chunk of timeseries list:" << t1;
+                return false;
+            }
+            const auto* tmp_ptr = tmp.constDataPtr();
+            bigint offset = M * T * k;
+            for (bigint aa = 0; aa < M * T; aa++) {
+                templates_ptr[offset + aa] += tmp_ptr[aa];
+            }
+            counts[k]++;
+        }
+    }
+    return true;
+}
+}
+
 bool p_compute_templates(QStringList timeseries_list, QString firings_path, QString templates_out, int clip_size, const QList<int>& clusters_in)
 {
     QList<int> clusters = clusters_in;
@@ -62,33 +101,18 @@ bool p_compute_templates(QStringList timeseries_list, QString firings_path, QStr
 
     double* templates_ptr = templates.dataPtr();
 
-    bigint Tmid = (bigint)((T + 1) / 2) - 1;
     printf("computing templates (M=%ld,T=%ld,K=%ld,L=%d)...\n", M, T, K0, times.count());
-    QTime timer;
-    timer.start();
-    for (bigint i = 0; i < times.count(); i++) {
-        bigint t1 = times[i] - Tmid;
-        //bigint t2 = t1 + T - 1;
-        int k = label_map[labels[i]];
-        if (timer.elapsed() > 3000) {
-            qDebug().noquote() << QString("Compute templates: processing event %1 of %2").arg(i).arg(times.count());
-            timer.restart();
-        }
-        {
-            Mda32 tmp;
-            tmp.allocate(M, T);
-            if (!X.readChunk(tmp, 0, t1, M, T)) {
-                qWarning() << "Problem reading chunk of timeseries list:" << t1;
-                return false;
-            }
-            float* tmp_ptr = tmp.dataPtr();
-            bigint offset = M * T * k;
-            for (bigint aa = 0; aa < M * T; aa++) {
-                templates_ptr[offset + aa] += tmp_ptr[aa];
-            }
-            counts[k]++;
-        }
+    //quantized timeseries are read as int16, at half the size of float
+    bool ok;
+    if (mda_is_int16(timeseries_list)) {
+        DiskReadMda16 X16(2, timeseries_list);
+        ok = P_compute_templates::accumulate_templates<Mda16>(templates_ptr, counts, X16, times, labels, label_map, T);
+    }
+    else {
+        ok = P_compute_templates::accumulate_templates<Mda32>(templates_ptr, counts, X, times, labels, label_map, T);
     }
+    if (!ok)
+        return false;
     bigint bb = 0;
     for (bigint k = 0; k < K0; k++) {
         for (bigint aa = 0; aa < M * T; aa++) {
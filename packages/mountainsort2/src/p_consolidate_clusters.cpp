@@ -10,7 +10,7 @@ QVector<int> read_labels(QString path);
 QVector<double> read_times(QString path);
 bool write_labels(QString path, const QVector<int>& labels);
 //Mda32 compute_template(QString clips_path, const QVector<int>& labels, int k);
-bool should_use_template(const Mda32& template0, Consolidate_clusters_opts opts);
+bool should_use_template(const Mda32ConstView& template0, Consolidate_clusters_opts opts);
 Mda32 compute_templates(const DiskReadMda32& X, const QVector<double>& times, const QVector<int>& labels, int clip_size);
 }
 
@@ -28,7 +28,7 @@ bool p_consolidate_clusters(QString timeseries, QString event_times_path, QStrin
     to_use.fill(0);
 
     for (int k = 1; k <= K; k++) {
-        Mda32 template0;
+        Mda32ConstView template0;
         templates.getChunk(template0, 0, 0, k - 1, templates.N1(), templates.N2(), 1);
         if (P_consolidate_clusters::should_use_template(template0, opts)) {
             to_use[k] = 1;
@@ -171,7 +171,7 @@ Mda32 compute_templates(const DiskReadMda32& X, const QVector<double>& times, co
     return templates;
 }
 
-bool should_use_template(const Mda32& template0, Consolidate_clusters_opts opts)
+bool should_use_template(const Mda32ConstView& template0, Consolidate_clusters_opts opts)
 {
     int peak_location_tolerance = 10;
 
@@ -1,6 +1,7 @@
 #include "p_detect_events.h"
 
 #include <diskreadmda32.h>
+#include <diskreadmda16.h>
 #include <mda.h>
 #include "mlcommon.h"
 
@@ -8,6 +9,40 @@ namespace P_detect_events {
     QVector<double> align_events(const QVector<double>& X, const QVector<double>& ptimes, int sign, double detect_interval);
     QVector<double> detect_events(const QVector<double>& X, double detect_threshold, double detect_interval, int sign);
     QVector<double> subsample_events(const QVector<double>& X, double subsample_factor);
+
+    //data[t] is the value at timepoint t on the channel with the largest (signed) value there
+    //Reader/ArrayType is DiskReadMda32/Mda32 or DiskReadMda16/Mda16
+    template <typename ArrayType, typename Reader>
+    bool collect_data_vector(QVector<double>& data, const Reader& X, int sign)
+    {
+        bigint M = X.N1();
+        bigint N = X.N2();
+        bigint chunk_size = 1e5;
+        for (bigint t = 0; t < N; t += chunk_size) {
+            bigint size = qMin(chunk_size, N - t);
+            ArrayType chunk;
+            if (!X.readChunk(chunk, 0, t, M, size))
+                return false;
+            const auto* ptr = chunk.constDataPtr();
+            for (bigint i = 0; i < size; i++) {
+                double best_value = 0;
+                bigint best_m = 0;
+                for (bigint m = 0; m < M; m++) {
+                    double val = ptr[m + M * i];
+                    if (sign < 0)
+                        val = -val;
+                    if (sign == 0)
+                        val = fabs(val);
+                    if (val > best_value) {
+                        best_value = val;
+                        best_m = m;
+                    }
+                }
+                data[t + i] = ptr[best_m + M * i];
+            }
+        }
+        return true;
+    }
 }
 
 bool p_detect_events(QString timeseries, QString event_times_out, P_detect_events_opts opts)
@@ -23,26 +58,33 @@ bool p_detect_events(QString timeseries, QString event_times_out, P_detect_event
             qWarning() << "Central channel is out of range:" << opts.central_channel << M;
             return false;
         }
-        for (bigint i = 0; i < N; i++) {
-            data[i] = X.value(opts.central_channel - 1, i);
+        //only the one channel is read, gathered from each chunk. On request, it comes from the channel-major cache
+        //instead, which is built on first use (a full pass and a copy of the file) and pays off when the file is read this way repeatedly
+        if (opts.use_channel_major_cache)
+            X.setUseTransposedCache(true);
+        QList<int> channels;
+        channels << opts.central_channel - 1;
+        bigint chunk_size = 1e6;
+        for (bigint t = 0; t < N; t += chunk_size) {
+            Mda32 chunk;
+            if (!X.readChunk(chunk, channels, t, qMin(chunk_size, N - t))) {
+                qWarning() << "Problem reading chunk of central channel";
+                return false;
+            }
+            for (bigint i = 0; i < chunk.N2(); i++)
+                data[t + i] = chunk.value(0, i);
         }
     }
     else {
-        for (bigint i = 0; i < N; i++) {
-            double best_value = 0;
-            bigint best_m = 0;
-            for (bigint m = 0; m < M; m++) {
-                double val = X.value(m, i);
-                if (opts.sign < 0)
-                    val = -val;
-                if (opts.sign == 0)
-                    val = fabs(val);
-                if (val > best_value) {
-                    best_value = val;
-                    best_m = m;
-                }
-            }
-            data[i] = X.value(best_m, i);
+        //read in chunks, and as int16 if the timeseries was quantized
+        bool ok;
+        if (mda_is_int16(QStringList(timeseries)))
+            ok = P_detect_events::collect_data_vector<Mda16>(data, DiskReadMda16(timeseries), opts.sign);
+        else
+            ok = P_detect_events::collect_data_vector<Mda32>(data, X, opts.sign);
+        if (!ok) {
+            qWarning() << "Problem reading chunk of timeseries";
+            return false;
         }
     }
     
@@ -11,6 +11,7 @@ struct P_detect_events_opts {
     int detect_rms_window = 0;
     int sign = 0;
     double subsample_factor = 1;
+    bool use_channel_major_cache = false; //see DiskReadMda32::setUseTransposedCache
 };
 
 bool p_detect_events(QString timeseries, QString event_times_out, P_detect_events_opts opts);
@@ -6,17 +6,47 @@
 
 #include "p_extract_clips.h"
 #include "diskreadmda32.h"
+#include "diskreadmda16.h"
 #include "diskreadmda.h"
 
 #include <diskwritemda.h>
+#include <mdapool.h>
 
 namespace P_extract_clips {
-Mda32 extract_channels_from_chunk(const Mda32& chunk, const QList<int>& channels);
+//Reader/ArrayType is DiskReadMda32/Mda32 or DiskReadMda16/Mda16
+template <typename ArrayType, typename Reader>
+bool extract_clips(const Reader& X, const DiskReadMda& ET, const QList<int>& channels0, DiskWriteMda& clips, bigint T)
+{
+    bigint M = X.N1();
+    bigint L = ET.totalSize();
+    bigint Tmid = (bigint)((T + 1) / 2) - 1;
+    MdaPoolScope pool_scope; //one clip per event, all the same size
+    for (bigint i = 0; i < L; i++) {
+        bigint t1 = ET.value(i) - Tmid;
+        //bigint t2 = t1 + T - 1;
+        ArrayType tmp;
+        bool ok;
+        if (channels0.isEmpty())
+            ok = X.readChunk(tmp, 0, t1, M, T);
+        else
+            ok = X.readChunk(tmp, channels0, t1, T);
+        if (!ok) {
+            qWarning() << "Problem reading chunk in extract_clips";
+            return false;
+        }
+        if (!clips.writeChunk(tmp, 0, 0, i)) {
+            qWarning() << "Problem writing chunk" << i;
+            return false;
+        }
+    }
+    return true;
+}
 }
 
 bool p_extract_clips(QStringList timeseries_list, QString event_times, const QList<int>& channels, QString clips_out, const QVariantMap& params)
 {
-    DiskReadMda32 X(2, timeseries_list);
+    //a single timeseries is read directly rather than as a concatenation of one
+    DiskReadMda32 X = (timeseries_list.count() == 1) ? DiskReadMda32(timeseries_list[0]) : DiskReadMda32(2, timeseries_list);
     DiskReadMda ET(event_times);
 
     bigint M = X.N1();
@@ -25,8 +55,11 @@ bool p_extract_clips(QStringList timeseries_list, QString event_times, const QLi
     bigint L = ET.totalSize();
 
     bigint M2 = M;
+    QList<int> channels0; //0-based, so only these channels are read
     if (!channels.isEmpty()) {
         M2 = channels.count();
+        foreach (int ch, channels)
+            channels0 << ch - 1;
     }
 
     if (!T) {
@@ -34,42 +67,14 @@ bool p_extract_clips(QStringList timeseries_list, QString event_times, const QLi
         return false;
     }
 
-    bigint Tmid = (bigint)((T + 1) / 2) - 1;
     printf("Extracting clips (%ld,%ld,%ld) (%ld)...\n", M, T, L, M2);
     DiskWriteMda clips;
+    clips.setAppendOnly(true); //the clips are written in order
     clips.open(MDAIO_TYPE_FLOAT32, clips_out, M2, T, L);
-    for (bigint i = 0; i < L; i++) {
-        bigint t1 = ET.value(i) - Tmid;
-        //bigint t2 = t1 + T - 1;
-        Mda32 tmp;
-        if (!X.readChunk(tmp, 0, t1, M, T)) {
-            qWarning() << "Problem reading chunk in extract_clips";
-            return false;
-        }
-        if (!channels.isEmpty()) {
-            tmp = P_extract_clips::extract_channels_from_chunk(tmp, channels);
-        }
-        if (!clips.writeChunk(tmp, 0, 0, i)) {
-            qWarning() << "Problem writing chunk" << i;
-            return false;
-        }
+    //quantized timeseries are read and handled as int16, at half the size of float
+    if (mda_is_int16(timeseries_list)) {
+        DiskReadMda16 X16(2, timeseries_list);
+        return P_extract_clips::extract_clips<Mda16>(X16, ET, channels0, clips, T);
     }
-
-    return true;
-}
-
-namespace P_extract_clips {
-Mda32 extract_channels_from_chunk(const Mda32& X, const QList<int>& channels)
-{
-    //int M=X.N1();
-    int T = X.N2();
-    int M2 = channels.count();
-    Mda32 ret(M2, T);
-    for (int t = 0; t < T; t++) {
-        for (int m2 = 0; m2 < M2; m2++) {
-            ret.set(X.value(channels[m2] - 1, t), m2, t);
-        }
-    }
-    return ret;
-}
+    return P_extract_clips::extract_clips<Mda32>(X, ET, channels0, clips, T);
 }
@@ -9,28 +9,27 @@
 #include <diskreadmda32.h>
 #include "diskwritemda.h"
 
-namespace P_extract_neighborhood_timeseries {
-Mda32 extract_neighborhood(const Mda32& X, QList<int> channels);
-}
-
 bool p_extract_neighborhood_timeseries(QString timeseries, QString timeseries_out, QList<int> channels)
 {
     DiskReadMda32 X(timeseries);
-    bigint M = X.N1();
     bigint N = X.N2();
     bigint M2 = channels.count();
 
     DiskWriteMda Y;
     Y.open(X.mdaioHeader().data_type, timeseries_out, M2, N);
 
+    QList<int> channels0; //0-based
+    foreach (int ch, channels)
+        channels0 << ch - 1;
+
     // TODO: don't load the whole thing into memory
+    //only the neighborhood channels are read
     Mda32 chunk;
-    if (!X.readChunk(chunk, 0, 0, M, N)) {
+    if (!X.readChunk(chunk, channels0, 0, N)) {
         qWarning() << "Problem reading chunk in extract_neighborhood_timeseries";
         return false;
     }
-    Mda32 chunk2 = P_extract_neighborhood_timeseries::extract_neighborhood(chunk, channels);
-    if (!Y.writeChunk(chunk2, 0, 0)) {
+    if (!Y.writeChunk(chunk, 0, 0)) {
         qWarning() << "Problem writing chunk in extract_neighborhood_timeseries";
         return false;
     }
@@ -52,19 +51,3 @@ bool p_extract_geom_channels(QString geom, QString geom_out, QList<int> channels
     }
     return X2.writeCsv(geom_out);
 }
-
-namespace P_extract_neighborhood_timeseries {
-Mda32 extract_neighborhood(const Mda32& X, QList<int> channels)
-{
-    bigint M2 = channels.count();
-    bigint N = X.N2();
-    Mda32 ret(M2, N);
-    for (bigint i = 0; i < N; i++) {
-        for (bigint m = 0; m < M2; m++) {
-            bigint m2 = channels[m] - 1;
-            ret.setValue(X.value(m2, i), m, i);
-        }
-    }
-    return ret;
-}
-}
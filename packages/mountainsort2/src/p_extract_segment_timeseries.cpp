@@ -25,12 +25,16 @@ bool p_extract_segment_timeseries(QString timeseries, QString timeseries_out, bi
     qDebug().noquote() << QString("Extracting segment timeseries M=%1, N2=%2").arg(M).arg(N2);
 
     bigint M2 = M;
+    QList<int> channels0; //0-based, so only these channels are read
     if (!channels.isEmpty()) {
         M2 = channels.count();
+        foreach (int ch, channels)
+            channels0 << ch - 1;
     }
 
     //do it this way so we can specify the datatype
     DiskWriteMda Y;
+    Y.setAppendOnly(true); //the chunks are written in order
     Y.open(X.mdaioHeader().data_type, timeseries_out, M2, N2);
 
     //conserve memory as of 3/1/17 -- jfm
@@ -40,13 +44,15 @@ bool p_extract_segment_timeseries(QString timeseries, QString timeseries_out, bi
         if (t + sz > N2)
             sz = N2 - t;
         Mda32 chunk;
-        if (!X.readChunk(chunk, 0, t1 + t, M, sz)) {
+        bool ok;
+        if (channels0.isEmpty())
+            ok = X.readChunk(chunk, 0, t1 + t, M, sz);
+        else
+            ok = X.readChunk(chunk, channels0, t1 + t, sz);
+        if (!ok) {
             qWarning() << "Problem reading chunk.";
             return false;
         }
-        if (!channels.isEmpty()) {
-            chunk = P_extract_segment_timeseries::extract_channels_from_chunk(chunk, channels);
-        }
         if (!Y.writeChunk(chunk, 0, t)) {
             qWarning() << "Problem writing chunk.";
             return false;
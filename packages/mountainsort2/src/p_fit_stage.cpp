@@ -14,13 +14,14 @@ namespace P_fit_stage {
 Mda sort_firings_by_time(const Mda& firings);
 void compute_templates(Mda32& templates_out, Mda32& templates_stdevs_out, const DiskReadMda32& X, const QVector<double>& times, const QVector<bigint>& labels, bigint clip_size);
 QVector<bigint> fit_stage_kernel(Mda32& X, Mda32& templates, QVector<double>& times, QVector<bigint>& labels, const Fit_stage_opts& opts, const QList<IntList>& time_channel_mask);
-QList<bigint> get_time_channel_mask(const Mda32& template0, const Mda32& template0_stdev, double thresh);
+QList<bigint> get_time_channel_mask(const Mda32ConstView& template0, const Mda32ConstView& template0_stdev, double thresh);
 }
 
 bool p_fit_stage(QString timeseries_path, QString firings_path, QString firings_out_path, Fit_stage_opts opts)
 {
     //The timeseries data and the dimensions
     DiskReadMda32 X(timeseries_path);
+    X.setMemoryMapped(true);
     bigint M = X.N1();
     bigint N = X.N2();
     bigint T = opts.clip_size;
@@ -64,7 +65,7 @@ bool p_fit_stage(QString timeseries_path, QString firings_path, QString firings_
     bigint K = MLCompute::max(labels);
     QList<IntList> time_channel_mask;
     for (bigint i = 0; i < K; i++) {
-        Mda32 template0, template0_stdev;
+        Mda32ConstView template0, template0_stdev;
         templates.getChunk(template0, 0, 0, i, M, T, 1);
         templates_stdev.getChunk(template0_stdev, 0, 0, i, M, T, 1);
         time_channel_mask << P_fit_stage::get_time_channel_mask(template0, template0_stdev, time_channel_mask_thresh); //use only the channels with highest maxval
@@ -88,15 +89,16 @@ bool p_fit_stage(QString timeseries_path, QString firings_path, QString firings_
             QList<bigint> local_inds; //the corresponding event indices
             Fit_stage_opts local_opts; //a local copy of the opts
             QList<IntList> local_time_channel_mask;
+            //readChunk is safe to call concurrently
+            if (!X.readChunk(chunk, 0, timepoint - overlap_size, M, chunk_size + 2 * overlap_size)) {
+                qWarning() << "Problem reading chunk in fit_stage";
+            }
 #pragma omp critical(lock1)
             {
                 //build the variables above
                 local_templates = templates;
                 local_opts = opts;
                 local_time_channel_mask = time_channel_mask;
-                if (!X.readChunk(chunk, 0, timepoint - overlap_size, M, chunk_size + 2 * overlap_size)) {
-                    qWarning() << "Problem reading chunk in fit_stage";
-                }
                 for (bigint jj = 0; jj < L; jj++) {
                     if ((timepoint - overlap_size <= times[jj]) && (times[jj] < timepoint - overlap_size + chunk_size + 2 * overlap_size)) {
                         local_times << times[jj] - (timepoint - overlap_size);
@@ -225,7 +227,7 @@ void compute_templates(Mda32& templates_out, Mda32& templates_stdevs_out, const
     }
 }
 
-QList<bigint> get_time_channel_mask(const Mda32& template0, const Mda32& template0_stdev, double thresh)
+QList<bigint> get_time_channel_mask(const Mda32ConstView& template0, const Mda32ConstView& template0_stdev, double thresh)
 {
     bigint M = template0.N1();
     bigint T = template0.N2();
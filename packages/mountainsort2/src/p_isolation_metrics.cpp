@@ -278,16 +278,16 @@ void regress_out_noise_shape(Mda32& clips, const Mda32& shape)
 {
     double shape_norm = MLCompute::norm(shape.totalSize(), shape.constDataPtr());
     for (bigint i = 0; i < clips.N3(); i++) {
-        Mda32 clip;
+        Mda32View clip; //modified in place
         clips.getChunk(clip, 0, 0, i, clips.N1(), clips.N2(), 1);
-        double inner_product = MLCompute::dotProduct(clip.totalSize(), clip.constDataPtr(), shape.constDataPtr());
+        float* clip_ptr = clip.dataPtr();
+        double inner_product = MLCompute::dotProduct(clip.totalSize(), clip_ptr, shape.constDataPtr());
         if (shape_norm) {
             double coef = inner_product / (shape_norm * shape_norm);
             for (bigint j = 0; j < clip.totalSize(); j++) {
-                clip.set(clip.get(j) - coef * shape.get(j), j);
+                clip_ptr[j] = clip_ptr[j] - coef * shape.get(j);
             }
         }
-        clips.setChunk(clip, 0, 0, i);
     }
 }
 
@@ -277,7 +277,7 @@ struct template_comparer {
             return false;
     }
 };
-template_comparer_struct compute_comparer(const Mda32& template0, int index)
+template_comparer_struct compute_comparer(const Mda32ConstView& template0, int index)
 {
     //QList<double> abs_peak_values;
     template_comparer_struct ret;
@@ -306,7 +306,7 @@ bool p_reorder_labels(QString templates_path, QString firings_path, QString firi
     qDebug().noquote() << "p_reorder_labels" << templates.N1() << templates.N2() << templates.N3() << firings.N1() << firings.N2();
     QList<P_reorder_labels::template_comparer_struct> list;
     for (int i = 0; i < templates.N3(); i++) {
-        Mda32 template0;
+        Mda32ConstView template0;
         templates.getChunk(template0, 0, 0, i, templates.N1(), templates.N2(), 1);
         list << P_reorder_labels::compute_comparer(template0, i);
     }
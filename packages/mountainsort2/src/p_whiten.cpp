@@ -3,6 +3,8 @@
 #include <QTime>
 #include <diskreadmda32.h>
 #include <diskwritemda.h>
+#include <mdaprefetcher.h>
+#include <QSharedPointer>
 #include <mda.h>
 #include "pca.h"
 #include "omp.h"
@@ -22,7 +24,6 @@ void quantize(bigint N, float* X, double unit)
         X[i] = quantize(X[i], unit);
     }
 }
-Mda32 extract_channels_from_chunk(const Mda32& X, const QList<int>& channels);
 }
 
 bool p_whiten(QString timeseries, QString timeseries_out, Whiten_opts opts)
@@ -30,6 +31,12 @@ bool p_whiten(QString timeseries, QString timeseries_out, Whiten_opts opts)
     (void)opts;
 
     DiskReadMda32 X(timeseries);
+    //streaming passes over the whole file, so keep it out of the page cache
+    X.setDirectIO(true);
+    if (X.isStream()) {
+        qWarning() << "Whitening needs two passes over the timeseries, so it cannot read from a pipe or FIFO:" << timeseries;
+        return false;
+    }
     bigint M = X.N1();
     bigint N = X.N2();
 
@@ -49,13 +56,10 @@ bool p_whiten(QString timeseries, QString timeseries_out, Whiten_opts opts)
 #pragma omp parallel for
         for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
             Mda32 chunk;
-#pragma omp critical(lock1)
-            {
-                if (!X.readChunk(chunk, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
-                    qWarning() << "Problem reading chunk in whiten (1)";
-                }
+            if (!X.readChunk(chunk, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
+                qWarning() << "Problem reading chunk in whiten (1)";
             }
-            float* chunkptr = chunk.dataPtr();
+            const float* chunkptr = chunk.constDataPtr();
             Mda XXt0(M, M);
             double* XXt0ptr = XXt0.dataPtr();
             for (bigint i = 0; i < chunk.N2(); i++) {
@@ -100,6 +104,7 @@ bool p_whiten(QString timeseries, QString timeseries_out, Whiten_opts opts)
     int dtype = MDAIO_TYPE_FLOAT32;
     if (opts.quantization_unit > 0)
         dtype = MDAIO_TYPE_INT16;
+    Y.setDirectIO(true);
     Y.open(dtype, timeseries_out, M, N);
     {
         QTime timer;
@@ -108,13 +113,10 @@ bool p_whiten(QString timeseries, QString timeseries_out, Whiten_opts opts)
 #pragma omp parallel for
         for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
             Mda32 chunk_in;
-#pragma omp critical(lock1)
-            {
-                if (!X.readChunk(chunk_in, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
-                    qWarning() << "Problem reading chunk in whiten (2)";
-                }
+            if (!X.readChunk(chunk_in, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
+                qWarning() << "Problem reading chunk in whiten (2)";
             }
-            float* chunk_in_ptr = chunk_in.dataPtr();
+            const float* chunk_in_ptr = chunk_in.constDataPtr();
             Mda32 chunk_out(M, chunk_in.N2());
             float* chunk_out_ptr = chunk_out.dataPtr();
             for (bigint i = 0; i < chunk_in.N2(); i++) { // explicitly do mat-mat mult ... TODO replace w/ BLAS3
@@ -173,20 +175,31 @@ bool p_compute_whitening_matrix(QStringList timeseries_list, const QList<int>& c
         chunk_size = N;
     }
 
-    bigint timepoint = 0;
-    while (timepoint < N) {
+    //the next batch of chunks is read on a background thread while the current batch is processed
+    MdaPrefetcher prefetcher(X0, chunk_size);
+    prefetcher.setTruncateLastChunk(true);
+    if (!channels.isEmpty()) {
+        QList<int> channels0; //0-based, so only these channels are read
+        foreach (int ch, channels)
+            channels0 << ch - 1;
+        prefetcher.setChannels(channels0);
+    }
+    prefetcher.setNumBuffers(omp_get_max_threads());
+    bool done = false;
+    while (!done) {
         QList<Mda32> chunks;
-        while ((timepoint < N) && (chunks.count() < omp_get_max_threads())) {
+        while (chunks.count() < omp_get_max_threads()) {
             Mda32 chunk0;
-            if (!X0.readChunk(chunk0, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
-                qWarning() << "Problem reading chunk in compute whiten matrix";
-                return false;
-            }
-            if (!channels.isEmpty()) {
-                chunk0 = P_whiten::extract_channels_from_chunk(chunk0, channels);
+            bigint timepoint;
+            if (!prefetcher.next(chunk0, timepoint)) {
+                done = true;
+                break;
             }
             chunks << chunk0;
-            timepoint += chunk_size;
+        }
+        if (prefetcher.hadError()) {
+            qWarning() << "Problem reading chunk in compute whiten matrix";
+            return false;
         }
         bigint num_chunks = chunks.count();
 #pragma omp parallel
@@ -225,6 +238,8 @@ bool p_compute_whitening_matrix(QStringList timeseries_list, const QList<int>& c
         }
     }
 
+    printf("Waited %.0f ms for data (%.0f ms spent reading)\n", prefetcher.stallTimeMsec(), prefetcher.readTimeMsec());
+
     if (N > 1) {
         for (bigint ii = 0; ii < M2 * M2; ii++) {
             XXtptr[ii] /= (N - 1);
@@ -305,6 +320,8 @@ bool p_apply_whitening_matrix(QString timeseries, QString whitening_matrix, QStr
     (void)opts;
 
     DiskReadMda32 X(timeseries);
+    //streaming passes over the whole file, so keep it out of the page cache
+    X.setDirectIO(true);
     bigint M = X.N1();
     bigint N = X.N2();
 
@@ -322,21 +339,23 @@ bool p_apply_whitening_matrix(QString timeseries, QString whitening_matrix, QStr
     int dtype = MDAIO_TYPE_FLOAT32;
     if (opts.quantization_unit > 0)
         dtype = MDAIO_TYPE_INT16;
+    Y.setDirectIO(true);
     Y.open(dtype, timeseries_out, M, N);
+
+    //a stream (pipe or FIFO) has to be read in order, so its chunks are handed out by a prefetcher instead of the parallel for
+    QSharedPointer<MdaPrefetcher> prefetcher;
+    if (X.isStream()) {
+        chunk_size = qMin(chunk_size, (bigint)1e5); //a chunk per thread is held in memory
+        prefetcher.reset(new MdaPrefetcher(X, chunk_size));
+        prefetcher->setTruncateLastChunk(true);
+        prefetcher->setNumBuffers(omp_get_max_threads());
+    }
     {
         QTime timer;
         timer.start();
         bigint num_timepoints_handled = 0;
-#pragma omp parallel for
-        for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
-            Mda32 chunk_in;
-#pragma omp critical(lock1)
-            {
-                if (!X.readChunk(chunk_in, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
-                    qWarning() << "Problem reading chunk in whiten (3)";
-                }
-            }
-            float* chunk_in_ptr = chunk_in.dataPtr();
+        auto process_chunk = [&](const Mda32& chunk_in, bigint timepoint) {
+            const float* chunk_in_ptr = chunk_in.constDataPtr();
             Mda32 chunk_out(M, chunk_in.N2());
             float* chunk_out_ptr = chunk_out.dataPtr();
             for (bigint i = 0; i < chunk_in.N2(); i++) { // explicitly do mat-mat mult ... TODO replace w/ BLAS3
@@ -366,6 +385,35 @@ bool p_apply_whitening_matrix(QString timeseries, QString whitening_matrix, QStr
                     timer.restart();
                 }
             }
+        };
+        if (prefetcher) {
+#pragma omp parallel
+            {
+                while (true) {
+                    Mda32 chunk_in;
+                    bigint timepoint;
+                    bool got_chunk;
+#pragma omp critical(lock_next)
+                    {
+                        got_chunk = prefetcher->next(chunk_in, timepoint);
+                    }
+                    if (!got_chunk)
+                        break;
+                    process_chunk(chunk_in, timepoint);
+                }
+            }
+            if (prefetcher->hadError())
+                qWarning() << "Problem reading chunk in whiten (3)";
+        }
+        else {
+#pragma omp parallel for
+            for (bigint timepoint = 0; timepoint < N; timepoint += chunk_size) {
+                Mda32 chunk_in;
+                if (!X.readChunk(chunk_in, 0, timepoint, M, qMin(chunk_size, N - timepoint))) {
+                    qWarning() << "Problem reading chunk in whiten (3)";
+                }
+                process_chunk(chunk_in, timepoint);
+            }
         }
     }
     Y.close();
@@ -374,20 +422,6 @@ bool p_apply_whitening_matrix(QString timeseries, QString whitening_matrix, QStr
 }
 
 namespace P_whiten {
-Mda32 extract_channels_from_chunk(const Mda32& X, const QList<int>& channels)
-{
-    //int M=X.N1();
-    int T = X.N2();
-    int M2 = channels.count();
-    Mda32 ret(M2, T);
-    for (int t = 0; t < T; t++) {
-        for (int m2 = 0; m2 < M2; m2++) {
-            ret.set(X.value(channels[m2] - 1, t), m2, t);
-        }
-    }
-    return ret;
-}
-
 void scale_for_quantization(Mda32& X, double quantization_unit)
 {
     bigint N = X.totalSize();
@@ -35,7 +35,7 @@ public:
     static void println(QString str);
     static QByteArray read_binary_file(const QString& fname);
     static bool write_binary_file(const QString& fname, const QByteArray& data);
-    QString find_file(bigint size, const QString& checksum, const QString& fcs_optional, const PrvFileLocateOptions& opts);
+    QString find_file(const QJsonObject& obj, const PrvFileLocateOptions& opts);
     QString find_remote_file(int size, const QString& checksum, const QString& fcs_optional, const PrvFileLocateOptions& opts);
     void copy_from(const PrvFile& other);
 };
@@ -110,7 +110,7 @@ bool PrvFile::representsFolder() const
 
 bool PrvFile::createFromFile(const QString& file_path, const PrvFileCreateOptions& opts)
 {
-    QJsonObject obj = MLUtil::createPrvObject(file_path);
+    QJsonObject obj = MLUtil::createPrvObject(file_path, opts.tree_checksum);
     /*
     obj["prv_version"] = PRV_VERSION;
     obj["original_path"] = file_path;
@@ -132,8 +132,7 @@ bool PrvFile::createFromFile(const QString& file_path, const PrvFileCreateOption
 
 bool PrvFile::createFromDirectory(const QString& dir_path, const PrvFileCreateOptions& opts)
 {
-    (void)opts;
-    QJsonObject obj = MLUtil::createPrvObject(dir_path);
+    QJsonObject obj = MLUtil::createPrvObject(dir_path, opts.tree_checksum);
     d->m_object = obj;
 
     return true;
@@ -221,10 +220,10 @@ QString PrvFile::locate(const PrvFileLocateOptions& opts)
         qWarning() << "Problem with prv object. Does not represent a file, so cannot attempt to locate.";
         return "";
     }
-    QString checksum = obj["original_checksum"].toString();
+    QString checksum = MLUtil::prvLocalChecksum(obj);
     QString fcs = obj["original_fcs"].toString();
     bigint original_size = obj["original_size"].toVariant().toLongLong();
-    QString fname_or_url = d->find_file(original_size, checksum, fcs, opts);
+    QString fname_or_url = d->find_file(obj, opts);
     if ((fname_or_url.isEmpty()) && (opts.search_locally)) {
         QString original_path = obj["original_path"].toString();
         if (opts.verbose) {
@@ -233,7 +232,7 @@ QString PrvFile::locate(const PrvFileLocateOptions& opts)
         if (QFile::exists(original_path)) {
             if (QFileInfo(original_path).size() == original_size) {
                 if (MLUtil::matchesFastChecksum(original_path, fcs)) {
-                    if (MLUtil::computeSha1SumOfFile(original_path) == checksum) {
+                    if (MLUtil::matchesChecksum(original_path, checksum)) {
                         return original_path;
                     }
                 }
@@ -286,7 +285,7 @@ bool PrvFile::recoverFile(const QString& dst_file_path, const PrvFileRecoverOpti
     QString checksum = d->m_object["original_checksum"].toString();
     QString fcs = d->m_object["original_fcs"].toString();
     bigint original_size = d->m_object["original_size"].toVariant().toLongLong();
-    QString fname_or_url = d->find_file(original_size, checksum, fcs, opts.locate_opts);
+    QString fname_or_url = d->find_file(d->m_object, opts.locate_opts);
     if (fname_or_url.isEmpty()) {
         d->println("Unable to find file: size=" + QString::number(original_size) + " checksum=" + checksum + " fcs=" + fcs);
         return false;
@@ -448,15 +447,17 @@ QString PrvFilePrivate::find_remote_file(int size, const QString& checksum, cons
     return "";
 }
 
-QString PrvFilePrivate::find_file(bigint size, const QString& checksum, const QString& fcs_optional, const PrvFileLocateOptions& opts)
+QString PrvFilePrivate::find_file(const QJsonObject& obj, const PrvFileLocateOptions& opts)
 {
+    bigint size = obj["original_size"].toVariant().toLongLong();
+    QString checksum = obj["original_checksum"].toString(); //the sha1, which is what servers know
+    QString fcs_optional = obj["original_fcs"].toString();
     if (opts.search_locally) {
         if (opts.verbose)
             printf("Searching locally......\n");
-        QJsonObject obj0;
-        obj0["original_checksum"] = checksum;
-        obj0["original_size"] = (long long)size;
-        obj0["original_fcs"] = fcs_optional;
+        //everything but the original path, which the caller checks last
+        QJsonObject obj0 = obj;
+        obj0.remove("original_path");
         QString local_fname = MLUtil::locatePrv(obj0, opts.local_search_paths);
         //QString local_fname = find_local_file(size, checksum, fcs_optional, opts);
         if (!local_fname.isEmpty()) {
@@ -16,6 +16,7 @@
 
 struct PrvFileCreateOptions {
     bool create_temporary_files = false;
+    bool tree_checksum = false; //also record a parallel tree checksum (sha1tree-...), next to the sha1 (which is still computed, for servers)
 };
 
 struct PrvFileLocateOptions {
@@ -431,6 +431,7 @@ public:
     {
         parser.addPositionalArgument("source", "Source file or directory name");
         parser.addPositionalArgument("dest", "Destination file or directory name", "[dest]");
+        parser.addOption(QCommandLineOption("tree-checksum", "Also record a parallel tree checksum (sha1tree) of each file, next to its sha1. Local copies are then checked against the tree checksum, which is much faster for large files. Creating the prv is not faster: the sha1 is still computed (alongside), since servers look files up by it."));
     }
     int execute(const QCommandLineParser& parser)
     {
@@ -457,6 +458,8 @@ public:
             return -1;
         }
         QVariantMap params;
+        if (parser.isSet("tree-checksum"))
+            params["tree-checksum"] = true;
         if (is_file(src_path)) {
             int ret = create_file_prv(src_path, dst_path, params);
             if (ret != 0)
@@ -479,6 +482,7 @@ private:
         PrvFile PF;
         PrvFileCreateOptions opts;
         opts.create_temporary_files = params.contains("create-temporary-files");
+        opts.tree_checksum = params.contains("tree-checksum");
         PF.createFromFile(src_path, opts);
         if (!PF.write(dst_path))
             return -1;
@@ -491,6 +495,7 @@ private:
         PrvFile PF;
         PrvFileCreateOptions opts;
         opts.create_temporary_files = params.contains("create-temporary-files");
+        opts.tree_checksum = params.contains("tree-checksum");
         PF.createFromDirectory(src_path, opts);
         if (!PF.write(dst_path))
             return -1;
@@ -552,6 +557,34 @@ public:
 };
 */
 
+class IndexCommand : public MLUtils::ApplicationCommand {
+public:
+    QString commandName() const { return "index"; }
+    QString description() const { return "Refresh the index of local files used by locate (stat only, nothing is hashed)"; }
+
+    void prepareParser(QCommandLineParser& parser)
+    {
+        parser.addPositionalArgument("search_path", "Directory to rescan (leave empty to rescan the default search locations)", "[search_path]");
+    }
+    int execute(const QCommandLineParser& parser)
+    {
+        QStringList args = parser.positionalArguments();
+        args.removeFirst(); // remove command name
+        QStringList search_paths = args;
+        if (search_paths.isEmpty())
+            search_paths = get_local_search_paths();
+        foreach (QString search_path, search_paths) {
+            if (!is_folder(search_path)) {
+                qWarning() << "No such directory: " + search_path;
+                return -1;
+            }
+            println("Rescanning: " + search_path);
+        }
+        MLUtil::rescanPrvIndex(search_paths);
+        return 0;
+    }
+};
+
 class LocateOrDownloadCommand : public MLUtils::ApplicationCommand {
 public:
     LocateOrDownloadCommand(const QString& cmd)
@@ -898,7 +931,7 @@ public:
             // is on the local machine.
             QString path1 = prv_file.originalPath();
             if (QFile::exists(path1)) {
-                if (MLUtil::computeSha1SumOfFile(path1) == prv_file.checksum()) {
+                if (MLUtil::matchesChecksum(path1, MLUtil::prvLocalChecksum(prv_file.object()))) {
                     if (QFile::exists(dst_path))
                         QFile::remove(dst_path);
                     if (QFile::copy(path1, dst_path)) {
@@ -1060,6 +1093,7 @@ int main(int argc, char* argv[])
     cmdParser.addCommand(new PrvCommands::CreateCommand);
     cmdParser.addCommand(new PrvCommands::LocateOrDownloadCommand("locate"));
     cmdParser.addCommand(new PrvCommands::LocateOrDownloadCommand("download"));
+    cmdParser.addCommand(new PrvCommands::IndexCommand);
     //cmdParser.addCommand(new PrvCommands::RecoverCommand);
     //cmdParser.addCommand(new PrvCommands::ListSubserversCommand);
     //cmdParser.addCommand(new PrvCommands::UploadCommand);
@@ -7,4 +7,8 @@ SUBDIRS =    mda mlcompute taskprogress \
 	     componentmanager \
     counters \
     processmanager \
-    signalhandler
+    signalhandler \
+    prvindex \
+    sumitcache \
+    sumit \
+    remotereadmda
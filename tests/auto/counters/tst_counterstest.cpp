@@ -2,6 +2,8 @@
 #include <QtTest>
 #include "icounter.h"
 #include "jscounter.h"
+#include <thread>
+#include <vector>
 
 class CountersTest : public QObject {
     Q_OBJECT
@@ -14,6 +16,8 @@ private Q_SLOTS:
     void testManager();
     void testIntCounter();
     void testDoubleCounter();
+    void testThreadCounter();
+    void testLatencyCounter();
     void testCustomCounter();
     void testAggregateCounter();
     void testJSCounter_expression();
@@ -85,6 +89,54 @@ void CountersTest::testDoubleCounter()
     QCOMPARE(counter.label(), QStringLiteral("42.5"));
 }
 
+void CountersTest::testThreadCounter()
+{
+    IThreadCounter counter("ThreadCounter");
+    QSignalSpy spy(&counter, SIGNAL(valueChanged()));
+    QCOMPARE(counter.value(), (int64_t)0);
+    std::vector<std::thread> threads;
+    for (int j = 0; j < 2 * ICOUNTER_NUM_SLOTS; j++) {
+        threads.push_back(std::thread([&counter]() {
+            for (int k = 0; k < 1000; k++)
+                counter.add((int64_t)1 << 22);
+        }));
+    }
+    for (size_t j = 0; j < threads.size(); j++)
+        threads[j].join();
+    // past 2^31, which would wrap an IIntCounter
+    QCOMPARE(counter.value(), (int64_t)(2 * ICOUNTER_NUM_SLOTS) * 1000 * ((int64_t)1 << 22));
+    QCOMPARE(counter.genericValue(), QVariant::fromValue<int64_t>(counter.value()));
+    QVERIFY2(spy.size() == 0, "valueChanged() emitted by add()");
+    counter.publish();
+    QCOMPARE(spy.size(), 1);
+    counter.publish();
+    QVERIFY2(spy.size() == 1, "valueChanged() emitted but the value didn't change");
+}
+
+void CountersTest::testLatencyCounter()
+{
+    ILatencyCounter counter("LatencyCounter");
+    QCOMPARE(counter.count(), (int64_t)0);
+    QCOMPARE(counter.percentile(0.5), (int64_t)0);
+    counter.record(500); // under 1 us
+    for (int j = 0; j < 98; j++)
+        counter.record(3000); // 3 us
+    counter.record(1000000); // 1 ms
+    QCOMPARE(counter.count(), (int64_t)100);
+    QCOMPARE(counter.totalNanoseconds(), (int64_t)(500 + 98 * 3000 + 1000000));
+    QVector<int64_t> H = counter.histogram();
+    QCOMPARE(H[0], (int64_t)1);
+    QCOMPARE(H[2], (int64_t)98);
+    QCOMPARE(H[10], (int64_t)1);
+    QCOMPARE(counter.percentile(0.5), (int64_t)4);
+    QCOMPARE(counter.percentile(1), (int64_t)1024);
+    {
+        ILatencyTimer timer(&counter);
+    }
+    QCOMPARE(counter.count(), (int64_t)101);
+    ILatencyTimer nothing(nullptr);
+}
+
 class BytesCounter : public IIntCounter {
 public:
     BytesCounter(const QString& name)
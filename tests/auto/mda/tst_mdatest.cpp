@@ -1,7 +1,19 @@
 #include <QString>
 #include <QtTest>
 #include "mda/mda.h"
+#include "mda/mda32.h"
+#include "mda/diskreadmda32.h"
+#include "mda/diskreadmda16.h"
+#include "mda/mdaprefetcher.h"
+#include "mda/diskwritemda.h"
+#include "mda/mdapool.h"
+#include "mda/mdaioprofile.h"
+#include "mda/mdaioconvert_p.h"
 #include <objectregistry.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 using VD = QVector<double>;
 
@@ -19,6 +31,23 @@ private Q_SLOTS:
     void get1();
     void get1_data();
     void invalid_readfile();
+    void diskreadmda32_mmap();
+    void mdaprefetcher();
+    void diskreadmda32_subblock();
+    void diskreadmda32_value_cache();
+    void diskreadmda32_mdaz();
+    void diskreadmda32_transposed();
+    void diskreadmda32_concat();
+    void diskreadmda32_concat_dims();
+    void diskreadmda32_direct_io();
+    void diskreadmda32_stream();
+    void diskreadmda32_concurrent();
+    void diskwritemda_preallocate();
+    void mdapool();
+    void mda32_view();
+    void mda16();
+    void mdaioprofile();
+    void mdaioconvert();
 
 private:
     ObjectRegistry m_registry; // prevent warnings about missing registry
@@ -223,6 +252,709 @@ void MdaTest::invalid_readfile()
     QCOMPARE(mda.N2(), bigint(1));
 }
 
+void MdaTest::diskreadmda32_mmap()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_mmap.mda";
+    Mda32 X(3, 50);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i * 0.5, i);
+    QVERIFY(X.write32(path));
+
+    DiskReadMda32 A(path);
+    DiskReadMda32 B(path);
+    B.setMemoryMapped(true);
+    QVERIFY(B.isMemoryMapped());
+
+    Mda32 chunkA, chunkB;
+    QVERIFY(A.readChunk(chunkA, 0, 10, 3, 20));
+    QVERIFY(B.readChunk(chunkB, 0, 10, 3, 20));
+    QVERIFY(chunkB.hasExternalData()); //same data type, so no copy
+    for (bigint i = 0; i < chunkA.totalSize(); i++)
+        QCOMPARE(chunkB.get(i), chunkA.get(i));
+
+    //writing to the view makes a private copy and leaves the file alone
+    chunkB.set(-1, 0);
+    QVERIFY(!chunkB.hasExternalData());
+    QCOMPARE(B.value(0, 10), X.get(0, 10));
+
+    //out of range reads are padded with zeros
+    QVERIFY(B.readChunk(chunkB, 0, -5, 3, 10));
+    QCOMPARE(chunkB.get(0, 0), 0.0f);
+    QCOMPARE(chunkB.get(1, 5), X.get(1, 0));
+
+    QFile::remove(path);
+}
+
+void MdaTest::mdaprefetcher()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_prefetch.mda";
+    Mda32 X(2, 95);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i, i);
+    QVERIFY(X.write32(path));
+
+    DiskReadMda32 A(path);
+    MdaPrefetcher P(A, 20, 3);
+    P.setNumBuffers(2);
+    QCOMPARE(P.numChunks(), (bigint)5);
+
+    Mda32 chunk, expected;
+    bigint timepoint;
+    bigint count = 0;
+    while (P.next(chunk, timepoint)) {
+        QCOMPARE(timepoint, count * 20);
+        QVERIFY(A.readChunk(expected, 0, timepoint - 3, 2, 26));
+        QCOMPARE(chunk.N2(), (bigint)26);
+        for (bigint i = 0; i < expected.totalSize(); i++)
+            QCOMPARE(chunk.get(i), expected.get(i));
+        count++;
+    }
+    QCOMPARE(count, (bigint)5);
+    QVERIFY(!P.hadError());
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_subblock()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_subblock.mda";
+    Mda32 X(6, 10, 4);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i, i);
+    QVERIFY(X.write32(path));
+
+    for (int pass = 0; pass < 2; pass++) {
+        DiskReadMda32 A(path);
+        A.setMemoryMapped(pass == 1);
+
+        //hyper-rectangle, partly outside the array
+        Mda32 chunk;
+        QVERIFY(A.readChunk(chunk, 2, 7, 1, 3, 5, 2));
+        for (bigint k = 0; k < 2; k++) {
+            for (bigint j = 0; j < 5; j++) {
+                for (bigint c = 0; c < 3; c++) {
+                    float expected = (7 + j < 10) ? X.get(2 + c, 7 + j, 1 + k) : 0;
+                    QCOMPARE(chunk.get(c, j, k), expected);
+                }
+            }
+        }
+
+        //gather of channels, including an out-of-range one
+        QList<int> channels;
+        channels << 4 << 5 << 0 << 9;
+        QVERIFY(A.readChunk(chunk, channels, 3, 4));
+        QCOMPARE(chunk.N1(), (bigint)4);
+        for (bigint j = 0; j < 4; j++) {
+            QCOMPARE(chunk.get(0, j), X.get(4, 3 + j, 0));
+            QCOMPARE(chunk.get(1, j), X.get(5, 3 + j, 0));
+            QCOMPARE(chunk.get(2, j), X.get(0, 3 + j, 0));
+            QCOMPARE(chunk.get(3, j), 0.0f);
+        }
+    }
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_value_cache()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_value_cache.mda";
+    Mda32 X(4, 1000);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i, i);
+    QVERIFY(X.write32(path));
+
+    DiskReadMda32 A(path);
+    A.setValueCacheSize(1e7);
+    QCOMPARE(A.valueCacheSize(), (bigint)1e7 / 1024 * 1024);
+    for (bigint i = 0; i < 1000; i++) {
+        for (bigint m = 0; m < 4; m++)
+            QCOMPARE(A.value(m, i), X.get(m, i));
+    }
+    QCOMPARE(A.valueCacheMisses(), (bigint)1);
+    QCOMPARE(A.valueCacheHits(), (bigint)3999);
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_mdaz()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_mdaz.mdaz";
+    Mda32 X(5, 40000);
+    for (bigint i = 0; i < X.N2(); i++) {
+        for (bigint m = 0; m < 5; m++)
+            X.set((m * 1000) + (i % 37) - 18, m, i);
+    }
+    {
+        DiskWriteMda W(MDAIO_TYPE_INT16, path, X.N1(), X.N2());
+        QVERIFY(W.isAppendOnly());
+        Mda32 chunk;
+        X.getChunk(chunk, 0, 0, X.N1(), 25000);
+        QVERIFY(W.writeChunk(chunk, 0, 0));
+        X.getChunk(chunk, 0, 25000, X.N1(), 15000);
+        QVERIFY(W.writeChunk(chunk, 0, 25000));
+    }
+    QVERIFY(QFileInfo(path).size() < X.totalSize() * 2);
+
+    DiskReadMda32 A(path);
+    QCOMPARE(A.N1(), X.N1());
+    QCOMPARE(A.N2(), X.N2());
+    Mda32 chunk;
+    QVERIFY(A.readChunk(chunk, 0, 39990, 5, 20));
+    for (bigint j = 0; j < 20; j++) {
+        for (bigint m = 0; m < 5; m++)
+            QCOMPARE(chunk.get(m, j), (39990 + j < X.N2()) ? X.get(m, 39990 + j) : 0.0f);
+    }
+    QList<int> channels;
+    channels << 3 << 1;
+    QVERIFY(A.readChunk(chunk, channels, 16000, 1000));
+    for (bigint j = 0; j < 1000; j++) {
+        QCOMPARE(chunk.get(0, j), X.get(3, 16000 + j));
+        QCOMPARE(chunk.get(1, j), X.get(1, 16000 + j));
+    }
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_transposed()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_transposed.mda";
+    Mda32 X(8, 70000);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i % 1000, i);
+    QVERIFY(X.write32(path));
+
+    DiskReadMda32 A(path);
+    A.setUseTransposedCache(true);
+    QList<int> channels;
+    channels << 6 << 1;
+    Mda32 chunk;
+    QVERIFY(A.readChunk(chunk, channels, 30000, 40010)); //spans blocks and the end of the array
+    for (bigint j = 0; j < 40010; j++) {
+        QCOMPARE(chunk.get(0, j), (30000 + j < X.N2()) ? X.get(6, 30000 + j) : 0.0f);
+        QCOMPARE(chunk.get(1, j), (30000 + j < X.N2()) ? X.get(1, 30000 + j) : 0.0f);
+    }
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_concat()
+{
+    QStringList paths;
+    QList<bigint> sizes;
+    sizes << 10 << 1 << 25;
+    Mda32 X(3, 36);
+    bigint t0 = 0;
+    for (int j = 0; j < sizes.count(); j++) {
+        Mda32 Y(3, sizes[j]);
+        for (bigint i = 0; i < Y.totalSize(); i++) {
+            Y.set(t0 * 3 + i, i);
+            X.set(t0 * 3 + i, t0 * 3 + i);
+        }
+        paths << QDir::tempPath() + QString("/tst_mdatest_concat_%1.mda").arg(j);
+        QVERIFY(Y.write32(paths[j]));
+        t0 += sizes[j];
+    }
+
+    DiskReadMda32 A(2, paths);
+    QCOMPARE(A.N2(), (bigint)36);
+    Mda32 chunk;
+    QVERIFY(A.readChunk(chunk, 0, -2, 3, 40)); //crosses both boundaries, padded at both ends
+    for (bigint j = 0; j < 40; j++) {
+        for (bigint m = 0; m < 3; m++)
+            QCOMPARE(chunk.get(m, j), ((j - 2 >= 0) && (j - 2 < 36)) ? X.get(m, j - 2) : 0.0f);
+    }
+    QCOMPARE(A.value(1, 10), X.get(1, 10));
+
+    foreach (QString path, paths)
+        QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_concat_dims()
+{
+    //two clips arrays of size 2 x 4 x L
+    QStringList paths;
+    QList<Mda32> arrays;
+    for (int j = 0; j < 2; j++) {
+        Mda32 Y(2, 4, 3 + j);
+        for (bigint i = 0; i < Y.totalSize(); i++)
+            Y.set(100 * j + i, i);
+        paths << QDir::tempPath() + QString("/tst_mdatest_concat_dims_%1.mda").arg(j);
+        QVERIFY(Y.write32(paths[j]));
+        arrays << Y;
+    }
+
+    DiskReadMda32 A(3, paths);
+    QCOMPARE(A.N3(), (bigint)7);
+    Mda32 chunk;
+    QVERIFY(A.readChunk(chunk, 0, 0, 2, 2, 4, 3)); //clips 2..4
+    for (bigint k = 0; k < 3; k++) {
+        const Mda32& Y = (k == 0) ? arrays[0] : arrays[1];
+        bigint kk = (k == 0) ? 2 : k - 1;
+        for (bigint t = 0; t < 4; t++) {
+            for (bigint m = 0; m < 2; m++)
+                QCOMPARE(chunk.get(m, t, k), Y.get(m, t, kk));
+        }
+    }
+
+    //stack the channels of a 2 x 4 and a 3 x 4 array
+    Mda32 Y1;
+    arrays[1].getChunk(Y1, 0, 0, 0, 2, 4, 1);
+    Y1.reshape(2, 4);
+    Mda32 Y2(3, 4);
+    for (bigint i = 0; i < Y2.totalSize(); i++)
+        Y2.set(-i, i);
+    QStringList paths2;
+    paths2 << paths[0] + ".ch0.mda" << paths[0] + ".ch1.mda";
+    QVERIFY(Y1.write32(paths2[0]));
+    QVERIFY(Y2.write32(paths2[1]));
+    DiskReadMda32 B(1, paths2);
+    QCOMPARE(B.N1(), (bigint)5);
+    QCOMPARE(B.N2(), (bigint)4);
+    QVERIFY(B.readChunk(chunk, 1, 1, 3, 2)); //rows 1..3 spans both members
+    for (bigint t = 0; t < 2; t++) {
+        QCOMPARE(chunk.get(0, t), Y1.get(1, 1 + t));
+        QCOMPARE(chunk.get(1, t), Y2.get(0, 1 + t));
+        QCOMPARE(chunk.get(2, t), Y2.get(1, 1 + t));
+    }
+
+
+    //channel gathers are passed on to the members: channel 1 and an out-of-range channel of clips 2..4
+    QVERIFY(A.readChunk(chunk, QList<int>() << 1 << 5, 1, 2, 2, 3));
+    for (bigint k = 0; k < 3; k++) {
+        const Mda32& Y = (k == 0) ? arrays[0] : arrays[1];
+        bigint kk = (k == 0) ? 2 : k - 1;
+        for (bigint t = 0; t < 2; t++) {
+            QCOMPARE(chunk.get(0, t, k), Y.get(1, 1 + t, kk));
+            QCOMPARE(chunk.get(1, t, k), 0.0f);
+        }
+    }
+    QVERIFY(B.readChunk(chunk, QList<int>() << 4 << 0, 1, 2));
+    for (bigint t = 0; t < 2; t++) {
+        QCOMPARE(chunk.get(0, t), Y2.get(2, 1 + t));
+        QCOMPARE(chunk.get(1, t), Y1.get(0, 1 + t));
+    }
+    Mda32 Y3(2, 3);
+    for (bigint i = 0; i < Y3.totalSize(); i++)
+        Y3.set(1000 + i, i);
+    paths2 << paths[0] + ".t1.mda";
+    QVERIFY(Y3.write32(paths2[2]));
+    DiskReadMda32 C(2, QStringList() << paths2[0] << paths2[2]);
+    QVERIFY(C.readChunk(chunk, QList<int>() << 1, 2, 4)); //timepoints 2..5 span both members
+    for (bigint t = 0; t < 4; t++)
+        QCOMPARE(chunk.get(0, t), (t < 2) ? Y1.get(1, 2 + t) : Y3.get(1, t - 2));
+
+    foreach (QString path, paths + paths2)
+        QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_direct_io()
+{
+    //int16 entries at an unaligned offset, so every chunk has partial pages at both ends
+    QString path = QDir::tempPath() + "/tst_mdatest_direct_io.mda";
+    Mda32 X(7, 500001);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i % 1000 - 500, i);
+    {
+        DiskWriteMda W;
+        W.setDirectIO(true);
+        QVERIFY(W.open(MDAIO_TYPE_INT16, path, X.N1(), X.N2()));
+        Mda32 chunk;
+        for (bigint t = 0; t < X.N2(); t += 300007) {
+            X.getChunk(chunk, 0, t, X.N1(), qMin((bigint)300007, X.N2() - t));
+            QVERIFY(W.writeChunk(chunk, 0, t));
+        }
+    }
+
+    DiskReadMda32 A(path);
+    A.setDirectIO(true);
+    Mda32 chunk;
+    QVERIFY(A.readChunk(chunk, 0, 123, X.N1(), X.N2())); //runs past the end of the array
+    for (bigint t = 0; t < X.N2(); t++) {
+        for (bigint m = 0; m < X.N1(); m++)
+            QCOMPARE(chunk.get(m, t), (123 + t < X.N2()) ? X.get(m, 123 + t) : 0.0f);
+    }
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_stream()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_stream.mda";
+    QFile::remove(path);
+    QVERIFY(mkfifo(path.toUtf8().data(), 0644) == 0);
+    Mda32 X(4, 50000);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i % 1000, i);
+
+    //the chunks are handed to the writer out of order, it holds them until the earlier ones arrive
+    std::thread writer([&]() {
+        DiskWriteMda W(MDAIO_TYPE_FLOAT32, path, X.N1(), X.N2());
+        Mda32 chunk;
+        for (bigint t = 0; t < X.N2(); t += 20000) {
+            bigint t2 = (t == 20000) ? 0 : ((t == 0) ? 20000 : t);
+            X.getChunk(chunk, 0, t2, X.N1(), qMin((bigint)20000, X.N2() - t2));
+            W.writeChunk(chunk, 0, t2);
+        }
+    });
+
+    DiskReadMda32 A(path);
+    QVERIFY(A.isStream());
+    QCOMPARE(A.N2(), X.N2());
+    MdaPrefetcher P(A, 7000, 100);
+    Mda32 chunk;
+    bigint timepoint;
+    bigint num_chunks = 0;
+    while (P.next(chunk, timepoint)) {
+        for (bigint j = 0; j < chunk.N2(); j++) {
+            bigint t = timepoint - 100 + j;
+            QCOMPARE(chunk.get(3, j), ((t >= 0) && (t < X.N2())) ? X.get(3, t) : 0.0f);
+        }
+        num_chunks++;
+    }
+    QCOMPARE(num_chunks, (bigint)8);
+    QVERIFY(!P.hadError());
+    writer.join();
+
+    QFile::remove(path);
+}
+
+void MdaTest::diskreadmda32_concurrent()
+{
+    //readChunk and writeChunk use positional I/O, so several threads share one reader and one writer
+    QString path = QDir::tempPath() + "/tst_mdatest_concurrent.mda";
+    QString path_out = QDir::tempPath() + "/tst_mdatest_concurrent_out.mda";
+    Mda32 X(5, 40000);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i % 10007, i);
+    QVERIFY(X.write32(path));
+
+    const int num_threads = 8;
+    const bigint chunk_size = 1000;
+    DiskReadMda32 A(path);
+    DiskWriteMda W;
+    QVERIFY(W.open(MDAIO_TYPE_FLOAT32, path_out, X.N1(), X.N2()));
+    std::atomic<int> num_errors(0);
+    std::vector<std::thread> threads;
+    for (int j = 0; j < num_threads; j++) {
+        threads.push_back(std::thread([&, j]() {
+            QList<int> channels;
+            channels << 4 << 1;
+            //each thread takes every num_threads-th chunk, with overlaps so that neighbouring reads hit the same pages
+            for (bigint t = j * chunk_size; t < X.N2(); t += num_threads * chunk_size) {
+                Mda32 chunk;
+                if (!A.readChunk(chunk, 0, t - 10, X.N1(), chunk_size + 20)) {
+                    num_errors++;
+                    continue;
+                }
+                for (bigint k = 0; k < chunk_size + 20; k++) {
+                    for (bigint m = 0; m < X.N1(); m++) {
+                        bigint t0 = t - 10 + k;
+                        if (chunk.get(m, k) != (((t0 >= 0) && (t0 < X.N2())) ? X.get(m, t0) : 0.0f))
+                            num_errors++;
+                    }
+                }
+                Mda32 chunk2;
+                if ((!A.readChunk(chunk2, channels, t, chunk_size)) || (chunk2.get(0, 0) != X.get(4, t)) || (chunk2.get(1, chunk_size - 1) != X.get(1, t + chunk_size - 1)))
+                    num_errors++;
+                //and write back the part without the overlaps
+                Mda32 chunk3;
+                chunk.getChunk(chunk3, 0, 10, X.N1(), chunk_size);
+                if (!W.writeChunk(chunk3, 0, t))
+                    num_errors++;
+            }
+        }));
+    }
+    for (int j = 0; j < num_threads; j++)
+        threads[j].join();
+    W.close();
+    QCOMPARE(num_errors.load(), 0);
+
+    Mda32 Y;
+    QVERIFY(Y.read(path_out));
+    QCOMPARE(Y.N1(), X.N1());
+    QCOMPARE(Y.N2(), X.N2());
+    for (bigint i = 0; i < X.totalSize(); i++)
+        QCOMPARE(Y.get(i), X.get(i));
+
+    QFile::remove(path);
+    QFile::remove(path_out);
+}
+
+void MdaTest::diskwritemda_preallocate()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_preallocate.mda";
+    const bigint header_size = 4 * 5; //data type, bytes per entry, number of dims, and the two dims
+    QList<int> data_types;
+    data_types << MDAIO_TYPE_BYTE << MDAIO_TYPE_FLOAT64;
+    foreach (int data_type, data_types) {
+        bigint num_bytes_per_entry = (data_type == MDAIO_TYPE_BYTE) ? 1 : 8;
+        DiskWriteMda W;
+        QVERIFY(W.open(data_type, path, 3, 1000));
+        //the file has its full size as soon as it is opened (it is written under a temporary name, renamed on close)
+        QCOMPARE(QFileInfo(path + ".tmp").size(), header_size + 3 * 1000 * num_bytes_per_entry);
+        Mda chunk(3, 100);
+        for (bigint i = 0; i < chunk.totalSize(); i++)
+            chunk.set(i % 100 + 1, i);
+        QVERIFY(W.writeChunk(chunk, 0, 500));
+        W.close();
+        QCOMPARE(QFileInfo(path).size(), header_size + 3 * 1000 * num_bytes_per_entry);
+        Mda Y;
+        QVERIFY(Y.read(path));
+        QCOMPARE(Y.N1(), (bigint)3);
+        QCOMPARE(Y.N2(), (bigint)1000);
+        for (bigint t = 0; t < 1000; t++) {
+            for (bigint m = 0; m < 3; m++)
+                QCOMPARE(Y.get(m, t), ((t >= 500) && (t < 600)) ? chunk.get(m, t - 500) : 0.0);
+        }
+    }
+
+    //append-only: chunks in order only, and padded with zeros on close
+    {
+        DiskWriteMda W;
+        W.setAppendOnly(true);
+        QVERIFY(W.open(MDAIO_TYPE_FLOAT64, path, 3, 1000));
+        Mda chunk(3, 100);
+        for (bigint i = 0; i < chunk.totalSize(); i++)
+            chunk.set(i + 1, i);
+        QVERIFY(W.writeChunk(chunk, 0, 0));
+        QVERIFY(!W.writeChunk(chunk, 0, 500));
+        QVERIFY(W.writeChunk(chunk, 0, 100));
+        W.close();
+        QCOMPARE(QFileInfo(path).size(), header_size + 3 * 1000 * 8);
+        Mda Y;
+        QVERIFY(Y.read(path));
+        for (bigint t = 0; t < 1000; t++) {
+            for (bigint m = 0; m < 3; m++)
+                QCOMPARE(Y.get(m, t), (t < 200) ? chunk.get(m, t % 100) : 0.0);
+        }
+    }
+
+    QFile::remove(path);
+}
+
+void MdaTest::mdapool()
+{
+    float* first = 0;
+    {
+        MdaPoolScope pool_scope;
+        for (int i = 0; i < 10; i++) {
+            Mda32 clip(4, 50);
+            if (!first)
+                first = clip.dataPtr();
+            QCOMPARE(clip.dataPtr(), first); //the block released by the previous iteration is reused
+            QCOMPARE(((quintptr)clip.dataPtr()) % MDAPOOL_ALIGNMENT, (quintptr)0);
+            QCOMPARE(clip.get(3, 49), 0.0f);
+            clip.set(i, 3, 49);
+        }
+        QVERIFY(MdaPool::threadCacheBytes() > 0);
+
+        //a copy made in the scope outlives it
+        Mda32 X(4, 50);
+        X.set(7, 1, 1);
+        Mda32 Y(X);
+        Y.set(8, 1, 1);
+        QCOMPARE(X.get(1, 1), 7.0f);
+        QCOMPARE(Y.get(1, 1), 8.0f);
+    }
+    QCOMPARE(MdaPool::threadCacheBytes(), (bigint)0);
+
+    //outside of a scope nothing is cached
+    {
+        Mda32 clip(4, 50);
+    }
+    QCOMPARE(MdaPool::threadCacheBytes(), (bigint)0);
+
+    //nor rounded up, so such a block is too small to be recycled by a scope
+    void* ptr = MdaPool::allocate(2100000);
+    {
+        MdaPoolScope pool_scope;
+        MdaPool::release(ptr, 2100000);
+        QCOMPARE(MdaPool::threadCacheBytes(), (bigint)0);
+    }
+}
+
+void MdaTest::mda32_view()
+{
+    Mda32 X(3, 4, 5);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        X.set(i, i);
+
+    //a slice of the third dimension is contiguous
+    Mda32ConstView slice;
+    QVERIFY(X.getChunk(slice, 0, 0, 2, 3, 4, 1));
+    QVERIFY(slice.isContiguous());
+    QCOMPARE(slice.dataPtr(), X.constDataPtr() + 2 * 12);
+    QCOMPARE(slice.get(1, 3), X.get(1, 3, 2));
+    QCOMPARE(slice.value(3, 0), 0.0f);
+
+    //a block of rows is strided, and matches the copying getChunk
+    Mda32ConstView block;
+    QVERIFY(X.getChunk(block, 1, 1, 1, 2, 3, 2));
+    QVERIFY(!block.isContiguous());
+    Mda32 copy, copy2;
+    X.getChunk(copy, 1, 1, 1, 2, 3, 2);
+    block.copyTo(copy2);
+    for (bigint i = 0; i < copy.totalSize(); i++) {
+        QCOMPARE(block.get(i), copy.get(i));
+        QCOMPARE(copy2.get(i), copy.get(i));
+    }
+
+    //writes go through to the array
+    Mda32View view;
+    QVERIFY(X.getChunk(view, 0, 1, 3, 2));
+    view.set(-1, 2, 1);
+    QCOMPARE(X.get(2, 2), -1.0f);
+
+    //no padding, unlike the copying getChunk
+    QVERIFY(!X.getChunk(view, 0, 3, 3, 2));
+    QVERIFY(view.isEmpty());
+}
+
+void MdaTest::mda16()
+{
+    QStringList paths;
+    Mda16 X(3, 30);
+    for (int j = 0; j < 2; j++) {
+        Mda16 Y(3, 15);
+        for (bigint i = 0; i < Y.totalSize(); i++) {
+            Y.set(-200 + 45 * j + i, i);
+            X.set(Y.get(i), 45 * j + i);
+        }
+        paths << QDir::tempPath() + QString("/tst_mdatest_int16_%1.mda").arg(j);
+        QVERIFY(Y.write16(paths[j]));
+    }
+    QVERIFY(mda_is_int16(paths));
+
+    DiskReadMda16 A(2, paths);
+    QCOMPARE(A.N2(), (bigint)30);
+    Mda16 chunk;
+    QVERIFY(A.readChunk(chunk, 1, -2, 2, 34)); //crosses the boundary, padded at both ends
+    for (bigint j = 0; j < 34; j++) {
+        for (bigint m = 0; m < 2; m++)
+            QCOMPARE(chunk.get(m, j), ((j - 2 >= 0) && (j - 2 < 30)) ? X.get(m + 1, j - 2) : (dtype16)0);
+    }
+    QCOMPARE(A.value(2, 20), X.get(2, 20));
+    QList<int> channels = QList<int>() << 2 << 0 << 5;
+    QVERIFY(A.readChunk(chunk, channels, 10, 12)); //crosses the boundary, an out-of-range channel gives zeros
+    for (bigint j = 0; j < 12; j++) {
+        for (int c = 0; c < channels.count(); c++)
+            QCOMPARE(chunk.get(c, j), (channels[c] < 3) ? X.get(channels[c], 10 + j) : (dtype16)0);
+    }
+    for (bigint i = 0; i < X.totalSize(); i++)
+        QCOMPARE(A.value(i), X.get(i));
+
+    //written to a float32 file without loss
+    QString path32 = QDir::tempPath() + "/tst_mdatest_int16_32.mda";
+    DiskWriteMda W(MDAIO_TYPE_FLOAT32, path32, 3, 30);
+    QVERIFY(W.writeChunk(X, 0, 0));
+    W.close();
+    QVERIFY(!mda_is_int16(QStringList(path32)));
+    Mda32 Z(path32);
+    for (bigint i = 0; i < X.totalSize(); i++)
+        QCOMPARE(Z.get(i), (float)X.get(i));
+
+    paths << path32;
+    foreach (QString path, paths)
+        QFile::remove(path);
+}
+
+void MdaTest::mdaioprofile()
+{
+    QString path = QDir::tempPath() + "/tst_mdatest_ioprofile.mda";
+    MdaIOProfile::clear();
+    MdaIOProfile::setEnabled(true);
+    {
+        Mda32 X(4, 1000);
+        DiskWriteMda W(MDAIO_TYPE_FLOAT32, path, 4, 1000);
+        QVERIFY(W.writeChunk(X, 0, 0));
+        W.close();
+    }
+    DiskReadMda32 A(path);
+    Mda32 chunk;
+    for (int j = 0; j < 10; j++)
+        QVERIFY(A.readChunk(chunk, 0, 10 * j, 4, 10)); //sequential
+    QVERIFY(A.readChunk(chunk, 0, 900, 4, 10)); //a seek forward of 12800 bytes
+    QVERIFY(A.readChunk(chunk, 0, 0, 4, 10)); //and back by 14560
+    MdaIOProfile::setEnabled(false);
+
+    QJsonObject summary = MdaIOProfile::summary();
+    QJsonObject F = summary["files"].toObject()[path].toObject();
+    QJsonObject R = F["read"].toObject();
+    QCOMPARE(R["calls"].toInt(), 12);
+    QCOMPARE(R["bytes"].toInt(), 12 * 160);
+    QCOMPARE(R["sequential_calls"].toInt(), 10);
+    QCOMPARE(R["backward_seeks"].toInt(), 1);
+    QJsonArray H = R["seek_log2_histogram"].toArray();
+    QCOMPARE(H.count(), 15);
+    QCOMPARE(H[14].toInt(), 2); //both between 2^13 and 2^14 bytes
+    QCOMPARE(F["write"].toObject()["bytes"].toInt(), 16000);
+    QCOMPARE(summary["bytes_written"].toInt(), 16000);
+
+    MdaIOProfile::clear();
+    QFile::remove(path);
+}
+
+void MdaTest::mdaioconvert()
+{
+    //each instruction set available here, including the scalar tails of odd lengths, against the scalar conversion
+    const float specials[] = { 0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 0.49999997f, 32766.5f, 32767.5f, 32768.0f, -32768.5f, -32769.0f,
+        65534.5f, 65535.5f, 65536.0f, 2147483520.0f, 2147483648.0f, -2147483648.0f, -2147483904.0f, 1e10f, -1e10f };
+    const bigint num_specials = sizeof(specials) / sizeof(specials[0]);
+    int num_tested = 0;
+    foreach (QString isa, QStringList() << "avx2" << "sse2" << "scalar") {
+        if (!mdaio_select_convert_isa(isa.toLatin1().data()))
+            continue;
+        num_tested++;
+        for (bigint n = 0; n < 70; n++) {
+            QVector<int16_t> a(n);
+            QVector<uint16_t> b(n);
+            QVector<int32_t> c(n);
+            QVector<float> f(n);
+            for (bigint i = 0; i < n; i++) {
+                a[i] = (i % 2) ? 32767 - i : -32768 + i;
+                b[i] = 65535 - 1000 * i;
+                c[i] = (i % 2) ? 2147483647 - i : -2147483647 + 1000 * i;
+                f[i] = specials[(7 * i) % num_specials] * (((i / num_specials) % 2) ? -1 : 1);
+            }
+            QVector<float> fa(n), fb(n), fc(n);
+            QVector<double> da(n), db(n), dc(n);
+            mdaio_convert(fa.data(), a.constData(), n);
+            mdaio_convert(fb.data(), b.constData(), n);
+            mdaio_convert(fc.data(), c.constData(), n);
+            mdaio_convert(da.data(), a.constData(), n);
+            mdaio_convert(db.data(), b.constData(), n);
+            mdaio_convert(dc.data(), c.constData(), n);
+            QVector<int16_t> qa(n);
+            QVector<uint16_t> qb(n);
+            QVector<int32_t> qc(n);
+            mdaio_convert(qa.data(), f.constData(), n);
+            mdaio_convert(qb.data(), f.constData(), n);
+            mdaio_convert(qc.data(), f.constData(), n);
+            for (bigint i = 0; i < n; i++) {
+                QCOMPARE(fa[i], (float)a[i]);
+                QCOMPARE(fb[i], (float)b[i]);
+                QCOMPARE(fc[i], (float)c[i]);
+                QCOMPARE(da[i], (double)a[i]);
+                QCOMPARE(db[i], (double)b[i]);
+                QCOMPARE(dc[i], (double)c[i]);
+                //round half to even, saturating at the limits of the type
+                QCOMPARE(qa[i], mdaio_round_saturate<int16_t>(f[i]));
+                QCOMPARE(qb[i], mdaio_round_saturate<uint16_t>(f[i]));
+                QCOMPARE(qc[i], mdaio_round_saturate<int32_t>(f[i]));
+            }
+        }
+    }
+    QVERIFY(mdaio_select_convert_isa(""));
+    QVERIFY(num_tested >= 1);
+    int16_t q[4];
+    const float halves[4] = { 0.5f, 1.5f, 2.5f, -2.5f };
+    mdaio_convert(q, halves, 4);
+    QCOMPARE((int)q[0], 0);
+    QCOMPARE((int)q[1], 2);
+    QCOMPARE((int)q[2], 2);
+    QCOMPARE((int)q[3], -2);
+}
+
 QTEST_APPLESS_MAIN(MdaTest)
 
 #include "tst_mdatest.moc"
@@ -0,0 +1,14 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_prvindextest
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+include(../../../mlcommon/mlcommon.pri)
+
+INCLUDEPATH += ../../../mlcommon/src
+SOURCES += tst_prvindextest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,167 @@
+#include <QString>
+#include <QtTest>
+#include "prvindex.h"
+#include <sys/stat.h>
+#include <utime.h>
+
+class PrvIndexTest : public QObject {
+    Q_OBJECT
+
+public:
+    PrvIndexTest();
+
+private Q_SLOTS:
+    void testHit();
+    void testStaleEntry();
+    void testPruning();
+    void testExcludedFiles();
+    void testIncrementalRescan();
+
+private:
+    QString m_dir;
+    void write_file(const QString& path, const QByteArray& content);
+    void set_old_modification_time(const QString& path);
+    qint64 inode_of(const QString& path);
+};
+
+PrvIndexTest::PrvIndexTest()
+{
+    m_dir = QDir::tempPath() + "/tst_prvindex";
+}
+
+void PrvIndexTest::write_file(const QString& path, const QByteArray& content)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+    f.write(content);
+}
+
+void PrvIndexTest::set_old_modification_time(const QString& path)
+{
+    //so that the rescan trusts the modification time of the directory
+    struct utimbuf times;
+    times.actime = times.modtime = QDateTime::currentDateTime().toTime_t() - 3600;
+    QVERIFY(utime(path.toUtf8().data(), &times) == 0);
+}
+
+qint64 PrvIndexTest::inode_of(const QString& path)
+{
+    struct stat SS;
+    if (stat(path.toUtf8().data(), &SS) != 0)
+        return -1;
+    return SS.st_ino;
+}
+
+void PrvIndexTest::testHit()
+{
+    QDir(m_dir).removeRecursively();
+    write_file(m_dir + "/data/a.dat", "aaaa");
+    write_file(m_dir + "/data/sub/b.dat", "bbbbb");
+    PrvIndex index(m_dir + "/" + PRV_INDEX_FILE_NAME);
+    index.rescan(m_dir + "/data/"); //trailing slash
+    QCOMPARE(index.fileCount(), 2);
+    QString a = m_dir + "/data/a.dat";
+    //found by size before its checksum is known, and by checksum afterwards
+    QCOMPARE(index.candidates(4, "checksum-a", "", QStringList(m_dir + "/data")), QStringList(a));
+    index.recordChecksum(a, "checksum-a");
+    QCOMPARE(index.candidates(4, "checksum-a", "", QStringList(m_dir + "/data/")), QStringList(a));
+    QVERIFY(index.candidates(4, "checksum-a", "", QStringList(m_dir + "/data/sub")).isEmpty());
+    //it survives a save and reload
+    QVERIFY(index.save());
+    PrvIndex index2(m_dir + "/" + PRV_INDEX_FILE_NAME);
+    QCOMPARE(index2.fileCount(), 2);
+    QCOMPARE(index2.candidates(4, "checksum-a", "", QStringList(m_dir + "/data")), QStringList(a));
+}
+
+void PrvIndexTest::testStaleEntry()
+{
+    QDir(m_dir).removeRecursively();
+    QString a = m_dir + "/data/a.dat";
+    write_file(a, "aaaa");
+    PrvIndex index(m_dir + "/" + PRV_INDEX_FILE_NAME);
+    index.rescan(m_dir + "/data");
+    index.recordChecksum(a, "checksum-a");
+    //the file changes: its checksum is forgotten once it is refreshed
+    write_file(a, "aaaaaa");
+    QVERIFY(index.refresh(a));
+    QVERIFY(index.candidates(4, "checksum-a", "", QStringList(m_dir + "/data")).isEmpty());
+    QCOMPARE(index.candidates(6, "checksum-a", "", QStringList(m_dir + "/data")), QStringList(a));
+    //the file disappears
+    QFile::remove(a);
+    QVERIFY(!index.refresh(a));
+    QCOMPARE(index.fileCount(), 0);
+}
+
+void PrvIndexTest::testPruning()
+{
+    QDir(m_dir).removeRecursively();
+    write_file(m_dir + "/data/a.dat", "aaaa");
+    write_file(m_dir + "/data/b.dat", "bbbb");
+    write_file(m_dir + "/other/c.dat", "cccc");
+    PrvIndex index(m_dir + "/" + PRV_INDEX_FILE_NAME);
+    index.rescan(m_dir + "/data");
+    index.rescan(m_dir + "/other");
+    QCOMPARE(index.fileCount(), 3);
+    //a relative search path, with a trailing slash, prunes the files that are gone from it (and only those)
+    QFile::remove(m_dir + "/data/b.dat");
+    QString cwd = QDir::currentPath();
+    QDir::setCurrent(m_dir);
+    index.rescan("./data/");
+    QDir::setCurrent(cwd);
+    QCOMPARE(index.fileCount(), 2);
+    QCOMPARE(index.candidates(4, "checksum", "", QStringList(m_dir + "/data")), QStringList(m_dir + "/data/a.dat"));
+    QCOMPARE(index.candidates(4, "checksum", "", QStringList(m_dir + "/other")), QStringList(m_dir + "/other/c.dat"));
+}
+
+void PrvIndexTest::testExcludedFiles()
+{
+    QDir(m_dir).removeRecursively();
+    write_file(m_dir + "/a.dat", "aaaa");
+    write_file(m_dir + "/sumit/sha1.log", "log");
+    write_file(m_dir + "/mountainprocess_log.1.abcd.txt", "log");
+    write_file(m_dir + "/out.mda.tmp", "partial");
+    PrvIndex index(m_dir + "/" + PRV_INDEX_FILE_NAME);
+    index.rescan(m_dir);
+    QVERIFY(index.save());
+    index.rescan(m_dir);
+    QCOMPARE(index.fileCount(), 1);
+    QCOMPARE(index.candidates(4, "checksum", "", QStringList(m_dir)), QStringList(m_dir + "/a.dat"));
+}
+
+void PrvIndexTest::testIncrementalRescan()
+{
+    QDir(m_dir).removeRecursively();
+    QString a = m_dir + "/data/a.dat";
+    write_file(a, "aaaa");
+    write_file(m_dir + "/data/sub/b.dat", "bbbbb");
+    set_old_modification_time(m_dir + "/data/sub");
+    set_old_modification_time(m_dir + "/data");
+    QString index_path = m_dir + "/" + PRV_INDEX_FILE_NAME;
+    PrvIndex index(index_path);
+    index.rescan(m_dir + "/data");
+    QCOMPARE(index.fileCount(), 2);
+    QVERIFY(index.save());
+    //nothing changed, so the index is not written again
+    qint64 inode = inode_of(index_path);
+    index.rescan(m_dir + "/data");
+    QVERIFY(index.save());
+    QCOMPARE(inode_of(index_path), inode);
+    //a file rewritten in place does not change its directory, but is still picked up
+    write_file(a, "aaaaaaa");
+    index.rescan(m_dir + "/data");
+    QCOMPARE(index.candidates(7, "checksum", "", QStringList(m_dir + "/data")), QStringList(a));
+    //a new file is found on the next rescan, with no wait
+    write_file(m_dir + "/data/sub/c.dat", "cccccc");
+    index.rescan(m_dir + "/data");
+    QCOMPARE(index.fileCount(), 3);
+    QCOMPARE(index.candidates(6, "checksum", "", QStringList(m_dir + "/data")), QStringList(m_dir + "/data/sub/c.dat"));
+    //and so is a removed directory
+    QDir(m_dir + "/data/sub").removeRecursively();
+    index.rescan(m_dir + "/data");
+    QCOMPARE(index.fileCount(), 1);
+}
+
+QTEST_MAIN(PrvIndexTest)
+
+#include "tst_prvindextest.moc"
@@ -0,0 +1,13 @@
+QT       += testlib network
+
+QT       -= gui
+
+TARGET = tst_remotereadmdatest
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+include(../../../mlcommon/mlcommon.pri)
+
+SOURCES += tst_remotereadmdatest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
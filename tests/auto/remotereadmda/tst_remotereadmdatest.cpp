@@ -0,0 +1,210 @@
+#include <QString>
+#include <QtTest>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QUrlQuery>
+#include "mda/remotereadmda.h"
+#include "cachemanager.h"
+#include "mlcommon.h"
+#include <objectregistry.h>
+
+/*
+ * A minimal mdaserver: "?a=info" gives the dimensions and checksum, "?a=readChunk" the url of the chunk, which is
+ * served as a float64 .mda file. Any readChunk request for /bad.mda fails.
+ */
+class MdaHttpServer : public QTcpServer {
+    Q_OBJECT
+public:
+    MdaHttpServer(const Mda& X, const QString& checksum, const QString& tmp_path, QAtomicInt* num_requests, QAtomicInt* num_chunk_downloads)
+        : m_X(X)
+        , m_checksum(checksum)
+        , m_tmp_path(tmp_path)
+        , m_num_requests(num_requests)
+        , m_num_chunk_downloads(num_chunk_downloads)
+    {
+    }
+
+protected:
+    void incomingConnection(qintptr handle) Q_DECL_OVERRIDE
+    {
+        QTcpSocket* socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(handle);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handle_request(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+
+private:
+    Mda m_X;
+    QString m_checksum;
+    QString m_tmp_path;
+    QAtomicInt* m_num_requests;
+    QAtomicInt* m_num_chunk_downloads;
+
+    void handle_request(QTcpSocket* socket)
+    {
+        QByteArray head = socket->peek(socket->bytesAvailable());
+        if (!head.contains("\r\n\r\n"))
+            return; //wait for the rest of the request
+        socket->readAll();
+        m_num_requests->ref();
+        QUrl url("http://localhost" + QString(head.split(' ').value(1)));
+        QUrlQuery query(url);
+        int status = 200;
+        QByteArray body;
+        if (query.queryItemValue("a") == "info") {
+            QString checksum = (url.path() == "/bad.mda") ? m_checksum + "-bad" : m_checksum;
+            body = QString("%1,%2,%3\n%4\n0\n").arg(m_X.N1()).arg(m_X.N2()).arg(m_X.N3()).arg(checksum).toLatin1();
+        }
+        else if ((query.queryItemValue("a") == "readChunk") && (url.path() != "/bad.mda")) {
+            body = QString("http://127.0.0.1:%1/chunk?index=%2&size=%3").arg(serverPort()).arg(query.queryItemValue("index")).arg(query.queryItemValue("size")).toLatin1();
+        }
+        else if (url.path() == "/chunk") {
+            m_num_chunk_downloads->ref();
+            bigint index = query.queryItemValue("index").toLongLong();
+            bigint size = query.queryItemValue("size").toLongLong();
+            Mda chunk(size, 1);
+            for (bigint j = 0; j < size; j++)
+                chunk.setValue(m_X.value(index + j), j);
+            QString fname = m_tmp_path + "/chunk-" + MLUtil::makeRandomId(10) + ".mda";
+            chunk.write64(fname);
+            QFile f(fname);
+            if (f.open(QFile::ReadOnly))
+                body = f.readAll();
+            f.close();
+            QFile::remove(fname);
+        }
+        else {
+            status = 500;
+        }
+        QByteArray header = QString("HTTP/1.1 %1 %2\r\nContent-Length: %3\r\nConnection: close\r\n\r\n").arg(status).arg(status == 200 ? "OK" : "Error").arg(body.count()).toLatin1();
+        socket->write(header + body);
+        socket->disconnectFromHost();
+    }
+};
+
+///Runs the server in its own event loop, since the reading thread blocks while it waits for the chunks
+class MdaHttpServerThread : public QThread {
+public:
+    Mda X;
+    QString checksum;
+    QString tmp_path;
+    quint16 port = 0;
+    QAtomicInt num_requests;
+    QAtomicInt num_chunk_downloads;
+    QSemaphore ready;
+
+    void run() Q_DECL_OVERRIDE
+    {
+        MdaHttpServer server(X, checksum, tmp_path, &num_requests, &num_chunk_downloads);
+        if (server.listen(QHostAddress::LocalHost))
+            port = server.serverPort();
+        ready.release();
+        exec();
+    }
+};
+
+class RemoteReadMdaTest : public QObject {
+    Q_OBJECT
+
+public:
+    RemoteReadMdaTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testMultiChunkRead();
+    void testCacheReuse();
+    void testFailedFetch();
+
+private:
+    ObjectRegistry m_registry; // prevent warnings about missing registry
+    QString m_dir;
+    MdaHttpServerThread m_server;
+    QString url(const QString& name) const;
+};
+
+RemoteReadMdaTest::RemoteReadMdaTest()
+{
+    m_dir = QDir::tempPath() + "/tst_remotereadmda";
+}
+
+QString RemoteReadMdaTest::url(const QString& name) const
+{
+    return QString("http://127.0.0.1:%1/%2").arg(m_server.port).arg(name);
+}
+
+void RemoteReadMdaTest::initTestCase()
+{
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+    CacheManager::globalInstance()->setLocalBasePath(m_dir + "/cache");
+    m_server.X.allocate(3, 1000);
+    for (bigint i = 0; i < m_server.X.totalSize(); i++)
+        m_server.X.setValue(i * 0.5 - 100, i);
+    m_server.checksum = "tst-" + MLUtil::makeRandomId(10); //so that nothing is cached from an earlier run
+    m_server.tmp_path = m_dir;
+    m_server.start();
+    m_server.ready.acquire();
+    QVERIFY(m_server.port != 0);
+}
+
+void RemoteReadMdaTest::cleanupTestCase()
+{
+    m_server.quit();
+    m_server.wait();
+    QDir(m_dir).removeRecursively();
+}
+
+void RemoteReadMdaTest::testMultiChunkRead()
+{
+    RemoteReadMda R(url("data.mda"));
+    R.setDownloadChunkSize(700);
+    R.setReadAheadChunks(0);
+    QCOMPARE(R.N1(), (bigint)3);
+    QCOMPARE(R.N2(), (bigint)1000);
+    QCOMPARE(R.N3(), (bigint)1);
+    Mda chunk;
+    QVERIFY(R.readChunk(chunk, 500, 1800)); //chunks 0 to 3, starting and ending partway
+    QCOMPARE(chunk.totalSize(), (bigint)1800);
+    for (bigint j = 0; j < 1800; j++)
+        QCOMPARE(chunk.value(j), m_server.X.value(500 + j));
+    QCOMPARE(m_server.num_chunk_downloads.load(), 4);
+}
+
+void RemoteReadMdaTest::testCacheReuse()
+{
+    int num_downloads = m_server.num_chunk_downloads.load();
+    //the chunks are cached under the checksum, so another reader of the same file gets them from the cache
+    RemoteReadMda R(url("data.mda"));
+    R.setDownloadChunkSize(700);
+    R.setReadAheadChunks(0);
+    Mda32 chunk;
+    QVERIFY(R.readChunk32(chunk, 600, 1500));
+    for (bigint j = 0; j < 1500; j++)
+        QCOMPARE(chunk.value(j), (float)m_server.X.value(600 + j));
+    QVERIFY(R.readChunk32(chunk, 600, 1500));
+    QCOMPARE(m_server.num_chunk_downloads.load(), num_downloads);
+    //the last chunk is shorter
+    QVERIFY(R.readChunk32(chunk, 2900, 100));
+    QCOMPARE(chunk.value(99), (float)m_server.X.value(2999));
+    QCOMPARE(m_server.num_chunk_downloads.load(), num_downloads + 1);
+}
+
+void RemoteReadMdaTest::testFailedFetch()
+{
+    RemoteReadMda R(url("bad.mda"));
+    R.setDownloadChunkSize(700);
+    R.setReadAheadChunks(0);
+    Mda chunk;
+    QVERIFY(!R.readChunk(chunk, 0, 10));
+    //once it has failed it does not try again
+    int num_requests = m_server.num_requests.load();
+    QVERIFY(!R.readChunk(chunk, 0, 10));
+    QCOMPARE(m_server.num_requests.load(), num_requests);
+}
+
+QTEST_MAIN(RemoteReadMdaTest)
+
+#include "tst_remotereadmdatest.moc"
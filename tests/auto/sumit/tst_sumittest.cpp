@@ -0,0 +1,169 @@
+#include <QString>
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QJsonObject>
+#include "sumit.h"
+#include "mlcommon.h"
+
+class SumitTest : public QObject {
+    Q_OBJECT
+
+public:
+    SumitTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testTreeMultiBlock();
+    void testTreeEmptyFile();
+    void testTreeChecksumOfLocalCopy();
+    void testDirMatchesSequential();
+
+private:
+    QString m_dir;
+    void write_file(const QString& path, const QByteArray& content);
+    QString sequential_dir_hash(const QString& path);
+};
+
+SumitTest::SumitTest()
+{
+    m_dir = QDir::tempPath() + "/tst_sumit";
+}
+
+void SumitTest::write_file(const QString& path, const QByteArray& content)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+    f.write(content);
+}
+
+QString SumitTest::sequential_dir_hash(const QString& path)
+{
+    //the construction from before the files were hashed concurrently: a "hash name" line for each subdirectory and then
+    //each file, in sorted-name order, hashed one at a time
+    QStringList files = QDir(path).entryList(QStringList("*"), QDir::Files, QDir::Name);
+    QStringList dirs = QDir(path).entryList(QStringList("*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    QString str = "";
+    foreach (QString dir, dirs) {
+        str += QString("%1 %2\n").arg(sequential_dir_hash(path + "/" + dir)).arg(dir);
+    }
+    foreach (QString file, files) {
+        QFile f(path + "/" + file);
+        if (!f.open(QFile::ReadOnly))
+            return "";
+        str += QString("%1 %2\n").arg(QString(QCryptographicHash::hash(f.readAll(), QCryptographicHash::Sha1).toHex())).arg(file);
+    }
+    return QString(QCryptographicHash::hash(str.toLatin1(), QCryptographicHash::Sha1).toHex());
+}
+
+void SumitTest::initTestCase()
+{
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+}
+
+void SumitTest::cleanupTestCase()
+{
+    QDir(m_dir).removeRecursively();
+}
+
+void SumitTest::testTreeMultiBlock()
+{
+    //a full block and part of a second, with different content
+    QString path = m_dir + "/multiblock.dat";
+    qint64 size = (qint64)SUMIT_TREE_BLOCK_SIZE + 12345;
+    QCryptographicHash full_hash(QCryptographicHash::Sha1);
+    QCryptographicHash block_hash(QCryptographicHash::Sha1);
+    QByteArray block_digests;
+    {
+        QFile f(path);
+        QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+        QByteArray buf(1024 * 1024, 0);
+        for (qint64 i = 0; i < size; i += buf.count()) {
+            qint64 n = qMin((qint64)buf.count(), size - i);
+            for (qint64 j = 0; j < n; j++)
+                buf[(int)j] = (char)(((i + j) * 7 + (i + j) / SUMIT_TREE_BLOCK_SIZE) & 0xff);
+            QByteArray part = buf.left((int)n);
+            QCOMPARE(f.write(part), n);
+            full_hash.addData(part);
+            //the block size is a multiple of the buffer size, so each part is within one block
+            block_hash.addData(part);
+            if (((i + n) % SUMIT_TREE_BLOCK_SIZE == 0) || (i + n == size)) {
+                block_digests += block_hash.result();
+                block_hash.reset();
+            }
+        }
+    }
+    QString expected = QString(QCryptographicHash::hash(block_digests, QCryptographicHash::Sha1).toHex());
+    QCOMPARE(block_digests.count(), 2 * 20);
+    QCOMPARE(sumit_tree(path, m_dir + "/tmp"), expected);
+    QCOMPARE(sumit(path, 0, m_dir + "/tmp"), QString(full_hash.result().toHex()));
+    //and again from the cache
+    QCOMPARE(sumit_tree(path, m_dir + "/tmp"), expected);
+    QFile::remove(path);
+}
+
+void SumitTest::testTreeEmptyFile()
+{
+    //no blocks, so the digest of nothing, which is also the sha1 of the file
+    QString path = m_dir + "/empty.dat";
+    write_file(path, QByteArray());
+    QString expected = QString(QCryptographicHash::hash(QByteArray(), QCryptographicHash::Sha1).toHex());
+    QCOMPARE(sumit_tree(path, m_dir + "/tmp"), expected);
+    QCOMPARE(sumit(path, 0, m_dir + "/tmp"), expected);
+}
+
+void SumitTest::testTreeChecksumOfLocalCopy()
+{
+    QString path = m_dir + "/original/a.dat";
+    QByteArray content(100000, 'a');
+    for (int i = 0; i < content.count(); i++)
+        content[i] = (char)(i % 251);
+    write_file(path, content);
+    QJsonObject obj = MLUtil::createPrvObject(path, true);
+    QString sha1 = QString(QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex());
+    QCOMPARE(obj["original_checksum"].toString(), sha1);
+    QVERIFY(obj["original_checksum_sha1tree"].toString().startsWith("sha1tree-"));
+    QCOMPARE(MLUtil::prvLocalChecksum(obj), obj["original_checksum_sha1tree"].toString());
+
+    //a copy elsewhere is verified by the tree checksum
+    QString copy_path = m_dir + "/copy/a.dat";
+    write_file(copy_path, content);
+    QVERIFY(MLUtil::matchesChecksum(copy_path, MLUtil::prvLocalChecksum(obj)));
+    //but not once it differs (in size too, so that the cached checksum of the copy is not reused)
+    content[50000] = (char)(content[50000] + 1);
+    write_file(copy_path, content + "b");
+    QVERIFY(!MLUtil::matchesChecksum(copy_path, MLUtil::prvLocalChecksum(obj)));
+
+    //without the tree checksum, the sha1 is used
+    QJsonObject obj2 = MLUtil::createPrvObject(path, false);
+    QVERIFY(!obj2.contains("original_checksum_sha1tree"));
+    QCOMPARE(MLUtil::prvLocalChecksum(obj2), sha1);
+}
+
+void SumitTest::testDirMatchesSequential()
+{
+    //more files than threads, spread over nested directories (one of them empty)
+    QString path = m_dir + "/tree";
+    for (int i = 0; i < 20; i++) {
+        QString subdir = (i % 3 == 0) ? "" : ((i % 3 == 1) ? "/b" : "/b/c");
+        write_file(path + subdir + QString("/file%1.dat").arg(i), QByteArray(100 + i * 37, (char)('a' + i)));
+    }
+    write_file(path + "/a.dat", "");
+    QDir().mkpath(path + "/b/empty");
+    QString expected = sequential_dir_hash(path);
+    QVERIFY(!expected.isEmpty());
+    QCOMPARE(sumit_dir(path, m_dir + "/tmp"), expected);
+    //and again, now with every file hash in the cache
+    for (int pass = 0; pass < 3; pass++)
+        QCOMPARE(sumit_dir(path, m_dir + "/tmp"), expected);
+    //a change deep down changes it
+    write_file(path + "/b/c/file2.dat", "changed");
+    QVERIFY(sumit_dir(path, m_dir + "/tmp") != expected);
+    QCOMPARE(sumit_dir(path, m_dir + "/tmp"), sequential_dir_hash(path));
+}
+
+QTEST_MAIN(SumitTest)
+
+#include "tst_sumittest.moc"
@@ -0,0 +1,152 @@
+#include <QString>
+#include <QtTest>
+#include <QCryptographicHash>
+#include "sumit.h"
+#include "sumitcache.h"
+
+class SumitCacheTest : public QObject {
+    Q_OBJECT
+
+public:
+    SumitCacheTest();
+
+private Q_SLOTS:
+    void testAppend();
+    void testTornFinalLine();
+    void testCompaction();
+    void testLegacyImport();
+
+private:
+    QString m_dir;
+    void write_file(const QString& path, const QByteArray& content);
+    SumitFileKey key_of(const QString& path);
+    QStringList log_lines();
+};
+
+SumitCacheTest::SumitCacheTest()
+{
+    m_dir = QDir::tempPath() + "/tst_sumitcache";
+}
+
+void SumitCacheTest::write_file(const QString& path, const QByteArray& content)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+    f.write(content);
+}
+
+SumitFileKey SumitCacheTest::key_of(const QString& path)
+{
+    SumitFileKey key;
+    SumitFileKey::fromFile(path, key);
+    return key;
+}
+
+QStringList SumitCacheTest::log_lines()
+{
+    QFile f(m_dir + "/sha1.log");
+    if (!f.open(QFile::ReadOnly))
+        return QStringList();
+    return QString::fromUtf8(f.readAll()).split("\n", QString::SkipEmptyParts);
+}
+
+void SumitCacheTest::testAppend()
+{
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+    QString a = m_dir + "/a.dat", b = m_dir + "/b.dat";
+    write_file(a, "aaaa");
+    write_file(b, "bbbbb");
+    SumitCache cache1(m_dir + "/sha1.log");
+    QVERIFY(cache1.lookup(key_of(a)).isEmpty());
+    cache1.record(key_of(a), a, "checksum-a");
+    QCOMPARE(cache1.lookup(key_of(a)), QString("checksum-a"));
+    //another instance (as in another process) reads it from the log, and what it records is picked up on a miss
+    SumitCache cache2(m_dir + "/sha1.log");
+    QCOMPARE(cache2.lookup(key_of(a)), QString("checksum-a"));
+    cache2.record(key_of(b), b, "checksum-b");
+    QCOMPARE(cache1.lookup(key_of(b)), QString("checksum-b"));
+    QCOMPARE(log_lines().count(), 2);
+}
+
+void SumitCacheTest::testTornFinalLine()
+{
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+    QString a = m_dir + "/a.dat", b = m_dir + "/b.dat";
+    write_file(a, "aaaa");
+    write_file(b, "bbbbb");
+    //a writer died halfway through its record
+    QByteArray txt = QString("%1\tchecksum-a\t%2\n").arg(key_of(a).toString()).arg(a).toUtf8();
+    txt += QString("%1\tchecksum-").arg(key_of(b).toString()).toUtf8();
+    write_file(m_dir + "/sha1.log", txt);
+    SumitCache cache1(m_dir + "/sha1.log");
+    QCOMPARE(cache1.lookup(key_of(a)), QString("checksum-a"));
+    QVERIFY(cache1.lookup(key_of(b)).isEmpty());
+    //the next record starts on a new line, and the partial one is dropped
+    cache1.record(key_of(b), b, "checksum-b");
+    SumitCache cache2(m_dir + "/sha1.log");
+    QCOMPARE(cache2.lookup(key_of(a)), QString("checksum-a"));
+    QCOMPARE(cache2.lookup(key_of(b)), QString("checksum-b"));
+    QCOMPARE(cache1.lookup(key_of(b)), QString("checksum-b"));
+}
+
+void SumitCacheTest::testCompaction()
+{
+    QDir(m_dir).removeRecursively();
+    QDir().mkpath(m_dir);
+    QString a = m_dir + "/a.dat", b = m_dir + "/b.dat", c = m_dir + "/c.dat";
+    write_file(a, "aaaa");
+    write_file(b, "bbbbb");
+    write_file(c, "cccccc");
+    SumitFileKey key_b0 = key_of(b);
+    SumitCache cache1(m_dir + "/sha1.log");
+    SumitCache cache2(m_dir + "/sha1.log");
+    cache1.record(key_of(a), a, "checksum-a");
+    cache1.record(key_of(a), a, "checksum-a"); //recorded twice
+    cache1.record(key_b0, b, "checksum-b0");
+    cache1.record(key_of(c), c, "checksum-c");
+    write_file(b, "bbbbbbb"); //changed since
+    QFile::remove(c); //and gone
+    QCOMPARE(log_lines().count(), 4);
+
+    QVERIFY(cache1.compact());
+    QCOMPARE(log_lines().count(), 2); //the header and a
+    QCOMPARE(cache1.lookup(key_of(a)), QString("checksum-a"));
+    //both instances go on using the new log
+    cache1.record(key_of(b), b, "checksum-b1");
+    QCOMPARE(cache2.lookup(key_of(b)), QString("checksum-b1"));
+    write_file(c, "cc");
+    cache2.record(key_of(c), c, "checksum-c1");
+    QCOMPARE(cache1.lookup(key_of(c)), QString("checksum-c1"));
+    QCOMPARE(log_lines().count(), 4);
+
+    SumitCache cache3(m_dir + "/sha1.log");
+    QCOMPARE(cache3.lookup(key_of(a)), QString("checksum-a"));
+    QVERIFY(cache3.lookup(key_b0).isEmpty());
+    QCOMPARE(cache3.lookup(key_of(b)), QString("checksum-b1"));
+    QCOMPARE(cache3.lookup(key_of(c)), QString("checksum-c1"));
+}
+
+void SumitCacheTest::testLegacyImport()
+{
+    QDir(m_dir).removeRecursively();
+    QString a = m_dir + "/data/a.dat";
+    write_file(a, "aaaa");
+    //the old cache was one file per hashed file, named by a hash of the path, size and modification time
+    QFileInfo info(a);
+    QString id_string = QString("%1:%2:%3:%4").arg(a).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size());
+    QString file_id = QString(QCryptographicHash::hash(id_string.toLatin1(), QCryptographicHash::Sha1).toHex());
+    QString legacy_checksum = QString(40, 'e'); //not the real checksum, so that we know where it came from
+    write_file(m_dir + "/tmp/sumit/sha1/" + file_id.mid(0, 4) + "/" + file_id, legacy_checksum.toLatin1());
+    QCOMPARE(sumit(a, 0, m_dir + "/tmp"), legacy_checksum);
+    //and it is now in the log
+    QFile::remove(m_dir + "/tmp/sumit/sha1/" + file_id.mid(0, 4) + "/" + file_id);
+    SumitCache cache(m_dir + "/tmp/sumit/sha1.log");
+    QCOMPARE(cache.lookup(key_of(a)), legacy_checksum);
+}
+
+QTEST_MAIN(SumitCacheTest)
+
+#include "tst_sumitcachetest.moc"